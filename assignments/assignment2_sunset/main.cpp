@@ -2,11 +2,14 @@
 //https://juejin.cn/post/6844904080779771918
 
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 #include <ew/external/glad.h>
 #include <ew/ewMath/ewMath.h>
 #include <zoo/shader.h>
+#include <ew/shader.h>
+#include <ew/programCache.h>
 #include <GLFW/glfw3.h>
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
@@ -21,6 +24,7 @@ unsigned int createShader(GLenum shaderType, const char* sourceCode);
 unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource);
 unsigned int createVAO(Vertex* vertexData, int numVertices, unsigned int* indicesData, int numIndices);
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
+void printShaderCacheTiming(ew::ProgramCache* cache, const char* vertexShaderPath, const char* fragmentShaderPath);
 
 const int SCREEN_WIDTH = 1080;
 const int SCREEN_HEIGHT = 720;
@@ -50,7 +54,7 @@ int manualPortal = 0;
 float portalColor[4] = { 1.0, 1.0, 1.0, 1.0 };
 float glowColor[4] = { 1.0, 1.0, 1.0, 1.0 };
 
-int main() {
+int main(int argc, char** argv) {
     printf("Initializing...");
     if (!glfwInit()) {
         printf("GLFW failed to init!");
@@ -76,7 +80,16 @@ int main() {
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init();
 
-    zoo::Shader shader("assets/vertexShader.vert", "assets/fragmentShader.frag"); // Update fragment shader file path
+    //The portal's noise shader is slow to compile, so its binary is cached between launches.
+    //Run with --shader-cache-timing to compare a cold and a warm cache
+    ew::ProgramCache programCache("shaderCache");
+    if (argc > 1 && strcmp(argv[1], "--shader-cache-timing") == 0) {
+        printShaderCacheTiming(&programCache, "assets/vertexShader.vert", "assets/fragmentShader.frag");
+    }
+    unsigned int cacheHits = programCache.getNumHits();
+    double shaderStartTime = glfwGetTime();
+    zoo::Shader shader("assets/vertexShader.vert", "assets/fragmentShader.frag", &programCache); // Update fragment shader file path
+    printf("Portal shader ready in %.2f ms (%s)\n", (glfwGetTime() - shaderStartTime) * 1000.0, programCache.getNumHits() > cacheHits ? "cached binary" : "compiled");
     shader.use();
 
     unsigned int vao = createVAO(vertices, 4, indices, 6); // Adjust vertex count
@@ -176,3 +189,30 @@ void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 	glViewport(0, 0, width, height);
 }
 
+//Creates the program from an empty cache, then again from the entry that stored
+void printShaderCacheTiming(ew::ProgramCache* cache, const char* vertexShaderPath, const char* fragmentShaderPath)
+{
+	if (!cache->isSupported()) {
+		printf("Program binaries are not supported by this driver\n");
+		return;
+	}
+	std::string vertexShaderSource = ew::loadShaderSourceFromFile(vertexShaderPath);
+	std::string fragmentShaderSource = ew::loadShaderSourceFromFile(fragmentShaderPath);
+	cache->clear();
+
+	double startTime = glfwGetTime();
+	unsigned int program = ew::createShaderProgram(vertexShaderSource.c_str(), fragmentShaderSource.c_str(), cache);
+	double coldTime = glfwGetTime() - startTime;
+	glDeleteProgram(program);
+
+	startTime = glfwGetTime();
+	program = ew::createShaderProgram(vertexShaderSource.c_str(), fragmentShaderSource.c_str(), cache);
+	double warmTime = glfwGetTime() - startTime;
+	glDeleteProgram(program);
+
+	printf("Shader cache timing for %s\n", fragmentShaderPath);
+	printf("  cold (compile, link, store): %.2f ms\n", coldTime * 1000.0);
+	printf("  warm (load binary):          %.2f ms\n", warmTime * 1000.0);
+	if (warmTime > 0.0)
+		printf("  speedup: %.1fx\n", coldTime / warmTime);
+}
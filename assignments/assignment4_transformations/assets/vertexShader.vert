@@ -1,16 +1,17 @@
 #version 450
 layout(location = 0) in vec3 vPos;
 layout(location = 1) in vec3 vNormal;
+//Per instance, see ew::InstanceBuffer
+layout(location = 3) in mat4 iModel;
 
 out vec3 Normal;
-uniform mat4 _Model;
 uniform mat4 _View;
 uniform mat4 _Projection;
 
 void main(){
     Normal = vNormal;
     // Apply model, view, and projection transformations
-    gl_Position = _Projection * _View * _Model * vec4(vPos, 1.0);
+    gl_Position = _Projection * _View * iModel * vec4(vPos, 1.0);
 
     // Convert from RHS to LHS
     gl_Position.z *= -1.0;
@@ -11,6 +11,7 @@
 #include <ew/shader.h>
 #include <ew/ewMath/vec3.h>
 #include <ew/procGen.h>
+#include <ew/instanceBuffer.h>
 #include <zoo/transformations.h>
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
@@ -60,6 +61,8 @@ int main() {
 	//Define transform
 	const int NUM_CUBES = 4;
 	zoo::Transform transform[NUM_CUBES];
+	//Model matrices of every cube, drawn with one call
+	ew::InstanceBuffer cubeInstances;
 	
 	
 	while (!glfwWindowShouldClose(window)) {
@@ -71,16 +74,13 @@ int main() {
 		//Set uniforms
 		shader.use();
 
-		//TODO: Set model matrix uniform
-		shader.use();
+		cubeInstances.clear();
 		for (int i = 0; i < NUM_CUBES; i++)
 		{
-			shader.setMat4("_Model", transform[i].getModelMatrix());
-			cubeMesh.draw();
+			cubeInstances.add(transform[i].getModelMatrix());
 		}
-		
-
-		cubeMesh.draw();
+		cubeInstances.upload();
+		cubeMesh.drawInstanced(cubeInstances);
 
 		//Render UI
 		{
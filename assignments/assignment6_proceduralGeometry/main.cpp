@@ -47,6 +47,22 @@ int manualPortal = 0;
 float portalColor[4] = { 1.0, 1.0, 1.0, 1.0 };
 ew::Vec2 portalPosition(0.5f, 0.25f);
 
+int planeSubdivisions = 10;
+bool animateWaves = false;
+
+//Writes a wave displaced copy of the plane into vertices
+void animatePlane(const ew::MeshData& planeMeshData, ew::Vertex* vertices, float time) {
+	for (size_t i = 0; i < planeMeshData.vertices.size(); i++) {
+		ew::Vertex v = planeMeshData.vertices[i];
+		float sx = sinf(v.pos.x * 2.0f + time), cx = cosf(v.pos.x * 2.0f + time);
+		float sz = sinf(v.pos.z * 2.0f + time), cz = cosf(v.pos.z * 2.0f + time);
+		v.pos.y = 0.1f * sx * cz;
+		//Normal from the height field's partial derivatives
+		v.normal = ew::Normalize(ew::Vec3(-0.2f * cx * cz, 1.0f, 0.2f * sx * sz));
+		vertices[i] = v;
+	}
+}
+
 int main() {
 	printf("Initializing...");
 	if (!glfwInit()) {
@@ -86,8 +102,9 @@ int main() {
 	unsigned int brickTexture = ew::loadTexture("assets/brick_color.jpg",GL_REPEAT,GL_LINEAR);
 
 	//Create plane
-	ew::MeshData planeMeshData = zoo::createPlane(10.0f, 10.0f, 10);
-	ew::Mesh planeMesh(planeMeshData);
+	//Regenerated by the UI, so its buffers are reused instead of reallocated
+	ew::MeshData planeMeshData = zoo::createPlane(10.0f, 10.0f, planeSubdivisions);
+	ew::Mesh planeMesh(planeMeshData, ew::MeshUsage::DYNAMIC);
 	ew::Transform planeTransform;
 	planeTransform.position = ew::Vec3(0.0f, -1.0f, 0.0f);
 
@@ -134,6 +151,9 @@ int main() {
 		shader.setVec3("_LightDir", lightF);
 
 		//Draw Mesh
+		if (animateWaves) {
+			animatePlane(planeMeshData, planeMesh.mapVertices(), time);
+		}
 		shader.setMat4("_Model", planeTransform.getModelMatrix());
 		planeMesh.draw((ew::DrawMode)appSettings.drawAsPoints);
 
@@ -183,6 +203,21 @@ int main() {
 						glDisable(GL_CULL_FACE);
 				}
 			}
+			if (ImGui::CollapsingHeader("Plane")) {
+				if (ImGui::SliderInt("Subdivisions", &planeSubdivisions, 1, 1000)) {
+					planeMeshData = zoo::createPlane(10.0f, 10.0f, planeSubdivisions);
+					planeMesh.load(planeMeshData);
+				}
+				//Waves rewrite every vertex each frame, which goes through a persistently mapped ring buffer
+				if (ImGui::Checkbox("Animate waves", &animateWaves)) {
+					planeMesh.setUsage(animateWaves ? ew::MeshUsage::STREAM : ew::MeshUsage::DYNAMIC);
+					planeMesh.load(planeMeshData);
+				}
+				ImGui::Text("Vertices: %d", planeMesh.getNumVertices());
+				if (animateWaves) {
+					ImGui::Text("Stream stalls: %u", planeMesh.getStreamStallCount());
+				}
+			}
 			ImGui::SliderInt("Manual Portal Color", &manualPortal, 0, 3);
 			ImGui::SliderFloat("Swirl Speed", &timeMultiplier, 0.0f, 50.0f);
 			ImGui::ColorEdit4("Portal Color", portalColor);
@@ -1,14 +1,15 @@
 #version 450
 out vec4 FragColor;
 
-struct Light
-{
-    vec3 position;
-    vec3 color;
-};
+#include "lightBlock.glsl"
+#include "frameBlock.glsl"
 
-#define MAX_LIGHTS 4
-uniform Light _Lights[MAX_LIGHTS];
+// Variants, see ew::ShaderVariantCache
+// LIGHTS: number of lights, fixed at compile time. Reads _NumLights when not defined
+// TEXTURED: 0 skips the texture fetch
+#ifndef TEXTURED
+#define TEXTURED 1
+#endif
 
 in Surface
 {
@@ -23,14 +24,25 @@ void main()
 {
     vec3 ambientColor = vec3(0.2, 0.2, 0.2);
 
-    vec3 resultColor = texture(_Texture, fs_in.UV).rgb * ambientColor;
-
-    for (int i = 0; i < MAX_LIGHTS; ++i)
+#if TEXTURED
+    vec3 albedo = texture(_Texture, fs_in.UV).rgb;
+#else
+    vec3 albedo = vec3(1.0);
+#endif
+    vec3 resultColor = albedo * ambientColor;
+
+#ifdef LIGHTS
+    // Constant trip count, the compiler can unroll the loop and drop it entirely for LIGHTS=0
+    const int numLights = LIGHTS;
+#else
+    int numLights = _NumLights;
+#endif
+    for (int i = 0; i < numLights; ++i)
     {
         vec3 lightDir = normalize(_Lights[i].position - fs_in.WorldPosition);
 
         // Calculate view direction correctly
-        vec3 viewDir = normalize(-fs_in.WorldPosition);
+        vec3 viewDir = normalize(_CameraPosition - fs_in.WorldPosition);
         vec3 halfDir = normalize(lightDir + viewDir);
 
         float diff = max(dot(fs_in.WorldNormal, lightDir), 0.0);
@@ -11,15 +11,15 @@ out Surface {
 } vs_out;
 
 uniform mat4 _Model;
-uniform mat4 _ViewProjection;
+uniform mat3 _NormalMatrix; //transpose(inverse(mat3(_Model))), computed on the CPU
+#include "frameBlock.glsl"
 
 void main() {
     vs_out.UV = vUV;
 
     vs_out.WorldPosition = vec3(_Model * vec4(vPos, 1.0));
 
-    mat3 normalMatrix = transpose(inverse(mat3(_Model)));
-    vs_out.WorldNormal = normalize(normalMatrix * vNormal);
+    vs_out.WorldNormal = normalize(_NormalMatrix * vNormal);
 
     gl_Position = _ViewProjection * _Model * vec4(vPos, 1.0);
 }
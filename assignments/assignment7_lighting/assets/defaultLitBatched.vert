@@ -0,0 +1,34 @@
+#version 460
+layout(location = 0) in vec3 vPos;
+layout(location = 1) in vec3 vNormal;
+layout(location = 2) in vec2 vUV;
+
+// Same as defaultLit.vert, with the model and normal matrix taken from ew::DrawBatch's instances.
+struct BatchInstance {
+    mat4 model;
+    vec4 color;
+    mat3 normalMatrix;
+};
+layout(std430, binding = 0) readonly buffer Instances {
+    BatchInstance instances[];
+};
+
+out Surface {
+    vec2 UV;
+    vec3 WorldPosition;
+    vec3 WorldNormal;
+} vs_out;
+
+#include "frameBlock.glsl"
+
+void main() {
+    BatchInstance instance = instances[gl_BaseInstance + gl_InstanceID];
+    mat4 model = instance.model;
+    vs_out.UV = vUV;
+
+    vs_out.WorldPosition = vec3(model * vec4(vPos, 1.0));
+
+    vs_out.WorldNormal = normalize(instance.normalMatrix * vNormal);
+
+    gl_Position = _ViewProjection * model * vec4(vPos, 1.0);
+}
@@ -0,0 +1,10 @@
+#version 450
+layout(location = 0) in vec3 vPos;
+
+// Drawn in place of shaders that are still compiling, so it only needs positions
+uniform mat4 _Model;
+#include "frameBlock.glsl"
+
+void main() {
+    gl_Position = _ViewProjection * _Model * vec4(vPos, 1.0);
+}
@@ -0,0 +1,10 @@
+// Shared by every program, see ew::SharedUniforms
+layout(std140) uniform FrameBlock {
+    mat4 _View;
+    mat4 _Projection;
+    mat4 _ViewProjection;
+    vec3 _CameraPosition;
+    vec2 _Resolution;
+    float _Time;
+    float _DeltaTime;
+};
@@ -0,0 +1,12 @@
+// Shared by every program, see ew::SharedUniforms
+struct Light
+{
+    vec3 position;
+    vec3 color;
+};
+
+#define MAX_LIGHTS 16
+layout(std140) uniform LightBlock {
+    Light _Lights[MAX_LIGHTS];
+    int _NumLights;
+};
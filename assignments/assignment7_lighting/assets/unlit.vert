@@ -2,10 +2,15 @@
 layout(location = 0) in vec3 vPos;
 layout(location = 1) in vec3 vNormal;
 layout(location = 2) in vec2 vUV;
+//Per instance, see ew::InstanceBuffer
+layout(location = 3) in mat4 iModel;
+layout(location = 7) in vec4 iColor;
 
-uniform mat4 _Model;
-uniform mat4 _ViewProjection;
+out vec4 Color;
+
+#include "frameBlock.glsl"
 
 void main(){
-	gl_Position = _ViewProjection * _Model * vec4(vPos,1.0);
+	Color = iColor;
+	gl_Position = _ViewProjection * iModel * vec4(vPos,1.0);
 }
@@ -9,11 +9,21 @@
 #include <imgui_impl_opengl3.h>
 
 #include <ew/shader.h>
+#include <ew/shaderCompiler.h>
+#include <ew/shaderVariants.h>
 #include <ew/texture.h>
 #include <ew/procGen.h>
+#include <ew/meshLOD.h>
+#include <ew/meshFile.h>
+#include <ew/meshPool.h>
+#include <ew/instanceBuffer.h>
+#include <ew/drawBatch.h>
+#include <ew/uniformBlocks.h>
 #include <ew/transform.h>
+#include <ew/cachedTransform.h>
 #include <ew/camera.h>
 #include <ew/cameraController.h>
+#include <ew/bvh.h>
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
 void resetCamera(ew::Camera& camera, ew::CameraController& cameraController);
@@ -35,6 +45,9 @@ struct Material {
 
 float prevTime;
 ew::Vec3 bgColor = ew::Vec3(0.1f);
+float lodPixelError = 1.0f; //Max simplification error on screen
+int numActiveLights = 4; //Lit shaders are specialized on this, see ew::ShaderVariantCache
+int lodTrianglesDrawn = 0;
 
 Light lights[4];
 
@@ -48,7 +61,16 @@ int main() {
 		return 1;
 	}
 
+	//Batched shapes need GLSL 4.60 for gl_BaseInstance. Drivers without 4.6 get the default context
+	//and draw the shapes one at a time instead
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 	GLFWwindow* window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Camera", NULL, NULL);
+	if (window == NULL) {
+		glfwDefaultWindowHints();
+		window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Camera", NULL, NULL);
+	}
 	if (window == NULL) {
 		printf("GLFW failed to create window");
 		return 1;
@@ -60,6 +82,10 @@ int main() {
 		printf("GLAD Failed to load GL headers");
 		return 1;
 	}
+	const bool multiDrawIndirect = GLAD_GL_VERSION_4_6 != 0;
+	if (!multiDrawIndirect) {
+		printf("OpenGL 4.6 is unavailable, shapes are drawn without batching\n");
+	}
 
 	//Initialize ImGUI
 	IMGUI_CHECKVERSION();
@@ -72,24 +98,98 @@ int main() {
 	glCullFace(GL_BACK);
 	glEnable(GL_DEPTH_TEST);
 
-	ew::Shader shader("assets/defaultLit.vert", "assets/defaultLit.frag");
-	ew::Shader unlitShader("assets/unlit.vert", "assets/unlit.frag");
+	//Only the fallback is compiled up front, the others compile in the background.
+	//The sphere draws with the fallback until its shader is ready. Batched shapes and light gizmos
+	//take their model matrices from buffers the fallback does not read, so they are skipped instead
+	ew::Shader fallbackShader("assets/fallback.vert", "assets/fallback.frag");
+	ew::ShaderCompiler shaderCompiler;
+	shaderCompiler.init(glfwGetProcAddress);
+	shaderCompiler.setFallback(&fallbackShader);
+	ew::Shader unlitShader;
+	shaderCompiler.add(&unlitShader, "assets/unlit.vert", "assets/unlit.frag");
+
+	//Lit shaders are compiled per light count, with the lighting loop's trip count fixed.
+	//When the count changes, the previous variant keeps drawing until the new one is ready
+	ew::ShaderVariantCache shaderVariants("assets");
+	shaderVariants.setCompiler(&shaderCompiler);
+	shaderVariants.addProgram("defaultLitBatched", "assets/defaultLitBatched.vert", "assets/defaultLit.frag");
+	ew::Shader* litShader = nullptr;
+	ew::Shader* batchedLitShader = nullptr;
+	ew::Shader* requestedLitShader = nullptr;
+	ew::Shader* requestedBatchedLitShader = nullptr;
+	int variantLights = -1;
 	unsigned int brickTexture = ew::loadTexture("assets/brick_color.jpg",GL_REPEAT,GL_LINEAR);
 
-	//Create cube
-	ew::Mesh cubeMesh(ew::createCube(1.0f));
-	ew::Mesh planeMesh(ew::createPlane(5.0f, 5.0f, 10));
-	ew::Mesh sphereMesh(ew::createSphere(0.5f, 64));
-	ew::Mesh cylinderMesh(ew::createCylinder(0.5f, 1.0f, 32));
+	//Create shapes. Static ones share one set of buffers, so they draw without rebinding
+	ew::MeshData cubeData = ew::createCube(1.0f);
+	ew::MeshData planeData = ew::createPlane(5.0f, 5.0f, 10);
+	ew::MeshData cylinderData = ew::createCylinder(0.5f, 1.0f, 32);
+	ew::MeshData sphereData = ew::createSphere(0.5f, 64);
+	ew::MeshPool meshPool;
+	ew::MeshHandle cubeMesh = meshPool.add(cubeData);
+	ew::MeshHandle planeMesh = meshPool.add(planeData);
+	ew::MeshHandle cylinderMesh = meshPool.add(cylinderData);
+	//Spheres pick a simplified level by their size on screen
+	//The LOD chain is cached on disk after the first run and mapped straight into the buffers after that.
+	//The cache is regenerated when the sphere or the LOD settings change
+	ew::MeshLODSet sphereLODs;
+	{
+		const unsigned int sphereLODLevels = 4;
+		const float sphereLODReduction = 0.25f;
+		const uint64_t sphereHash = ew::hashMeshSource(sphereData, { (float)sphereLODLevels, sphereLODReduction });
+		ew::MeshFile sphereFile;
+		if (!sphereFile.open("meshCache/sphere.ewmesh", sphereHash)) {
+			ew::writeMeshFile("meshCache/sphere.ewmesh", ew::generateLODChain(sphereData, sphereLODLevels, sphereLODReduction), sphereHash);
+			sphereFile.open("meshCache/sphere.ewmesh", sphereHash);
+		}
+		if (sphereFile.isOpen()) {
+			sphereLODs.load(sphereFile);
+		}
+		else {
+			sphereLODs.load(sphereData);
+		}
+	}
 
 	//Initialize transforms
-	ew::Transform cubeTransform;
-	ew::Transform planeTransform;
-	ew::Transform sphereTransform;
-	ew::Transform cylinderTransform;
-	planeTransform.position = ew::Vec3(0, -1.0, 0);
-	sphereTransform.position = ew::Vec3(-1.5f, 0.0f, 0.0f);
-	cylinderTransform.position = ew::Vec3(1.5f, 0.0f, 0.0f);
+	//Shapes never move, so their matrices are only composed once
+	ew::CachedTransform cubeTransform;
+	ew::CachedTransform planeTransform(ew::Vec3(0, -1.0, 0));
+	ew::CachedTransform sphereTransform(ew::Vec3(-1.5f, 0.0f, 0.0f));
+	ew::CachedTransform cylinderTransform(ew::Vec3(1.5f, 0.0f, 0.0f));
+
+	//Every visible pooled shape is drawn by one indirect call. They never move, so the batch is only
+	//uploaded again when the set of visible shapes changes. Without 4.6 they are drawn one at a time
+	ew::DrawBatch shapeBatch(&meshPool);
+	const ew::CachedTransform* pooledTransforms[] = { &cubeTransform, &planeTransform, &cylinderTransform };
+	const ew::MeshHandle pooledMeshes[] = { cubeMesh, planeMesh, cylinderMesh };
+	const ew::MeshData* pooledData[] = { &cubeData, &planeData, &cylinderData };
+	unsigned int batchedShapes = ~0u; //Bit per pooled shape, none uploaded yet
+
+	//Every object is culled against the camera each frame. DrawItem ids: pooled shapes, then the sphere, then the lights
+	const unsigned int SPHERE_ID = 3;
+	const unsigned int FIRST_LIGHT_ID = 4;
+	std::vector<ew::DrawItem> drawItems;
+	std::vector<ew::DrawItem> visibleItems;
+	ew::CullStats cullStats;
+
+	//Shapes are picked with the mouse by ray casting against their full detail triangles
+	ew::MeshBVH cubeBVH(cubeData), planeBVH(planeData), sphereBVH(sphereData), cylinderBVH(cylinderData);
+	ew::SceneBVH sceneBVH;
+	sceneBVH.add(&cubeBVH, *cubeTransform.getModelMatrix());
+	sceneBVH.add(&planeBVH, *planeTransform.getModelMatrix());
+	sceneBVH.add(&sphereBVH, *sphereTransform.getModelMatrix());
+	sceneBVH.add(&cylinderBVH, *cylinderTransform.getModelMatrix());
+	sceneBVH.build();
+	const char* shapeNames[] = { "Cube", "Plane", "Sphere", "Cylinder" };
+	ew::RayHit pickedHit;
+
+	//Camera, frame and light data shared by every shader, uploaded once per frame
+	ew::SharedUniforms sharedUniforms;
+	sharedUniforms.create();
+
+	//Light gizmos are refilled every frame
+	ew::InstanceBuffer lightInstances;
+	std::vector<size_t> lightLevelEnds(sphereLODs.getNumLevels());
 
 	lights[0].position = ew::Vec3(3.0f, 2.0f, 0.0f);
 	lights[0].color = ew::Vec3(1.0f, 0.0f, 0.0f);
@@ -107,6 +207,7 @@ int main() {
 
 	while (!glfwWindowShouldClose(window)) {
 		glfwPollEvents();
+		shaderCompiler.poll();
 
 		float time = (float)glfwGetTime();
 		float deltaTime = time - prevTime;
@@ -116,39 +217,150 @@ int main() {
 		camera.aspectRatio = (float)SCREEN_WIDTH / SCREEN_HEIGHT;
 		cameraController.Move(window, &camera, deltaTime);
 
+		//Left click picks the shape under the cursor. Cursor positions are in window coordinates, not framebuffer pixels
+		if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_1) == GLFW_PRESS && !ImGui::GetIO().WantCaptureMouse) {
+			double cursorX, cursorY;
+			int windowWidth, windowHeight;
+			glfwGetCursorPos(window, &cursorX, &cursorY);
+			glfwGetWindowSize(window, &windowWidth, &windowHeight);
+			pickedHit = ew::RayHit();
+			sceneBVH.intersect(ew::ScreenPointToRay(camera, (float)cursorX, (float)cursorY, (float)windowWidth, (float)windowHeight), &pickedHit);
+		}
+
+		if (variantLights != numActiveLights) {
+			variantLights = numActiveLights;
+			std::vector<ew::ShaderDefine> defines = { { "LIGHTS", std::to_string(numActiveLights) } };
+			requestedLitShader = shaderVariants.get("defaultLit", defines);
+			if (multiDrawIndirect)
+				requestedBatchedLitShader = shaderVariants.get("defaultLitBatched", defines);
+		}
+		if (!litShader || requestedLitShader->isReady())
+			litShader = requestedLitShader;
+		if (requestedBatchedLitShader && (!batchedLitShader || requestedBatchedLitShader->isReady()))
+			batchedLitShader = requestedBatchedLitShader;
+
+		//Shared uniforms, before any draw
+		{
+			ew::FrameBlock& frame = sharedUniforms.getFrame();
+			sharedUniforms.setCamera(camera);
+			frame.resolution = ew::Vec2((float)SCREEN_WIDTH, (float)SCREEN_HEIGHT);
+			frame.time = time;
+			frame.deltaTime = deltaTime;
+			ew::LightBlock& lightBlock = sharedUniforms.getLights();
+			lightBlock.numLights = numActiveLights;
+			for (int i = 0; i < numActiveLights; ++i) {
+				lightBlock.lights[i].position = lights[i].position;
+				lightBlock.lights[i].color = lights[i].color;
+			}
+			sharedUniforms.upload();
+		}
+
 		//RENDER
 		glClearColor(bgColor.x, bgColor.y,bgColor.z,1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		shader.use();
 		glBindTexture(GL_TEXTURE_2D, brickTexture);
-		shader.setInt("_Texture", 0);
-		shader.setMat4("_ViewProjection", camera.ProjectionMatrix() * camera.ViewMatrix());
 
-		//Draw shapes
-		shader.setMat4("_Model", cubeTransform.getModelMatrix());
-		cubeMesh.draw();
-
-		shader.setMat4("_Model", planeTransform.getModelMatrix());
-		planeMesh.draw();
+		//Cull
+		drawItems.clear();
+		for (unsigned int i = 0; i < 3; i++) {
+			ew::DrawItem item;
+			item.model = *pooledTransforms[i]->getModelMatrix();
+			item.worldBounds = ew::TransformBoundingSphere(pooledData[i]->boundingSphere, item.model);
+			item.id = i;
+			drawItems.push_back(item);
+		}
+		{
+			ew::DrawItem item;
+			item.mesh = &sphereLODs.getLevel(0);
+			item.model = *sphereTransform.getModelMatrix();
+			item.worldBounds = ew::TransformBoundingSphere(sphereData.boundingSphere, item.model);
+			item.id = SPHERE_ID;
+			drawItems.push_back(item);
+		}
+		for (int i = 0; i < numActiveLights; ++i) {
+			ew::DrawItem item;
+			item.mesh = &sphereLODs.getLevel(0);
+			item.model = ew::Translate(lights[i].position);
+			item.worldBounds = ew::TransformBoundingSphere(sphereData.boundingSphere, item.model);
+			item.id = FIRST_LIGHT_ID + i;
+			drawItems.push_back(item);
+		}
+		cullStats = ew::CullDrawList(camera.ViewFrustum(), drawItems, &visibleItems);
+		unsigned int visibleShapes = 0;
+		bool sphereVisible = false;
+		bool lightVisible[4] = {};
+		for (const ew::DrawItem& item : visibleItems) {
+			if (item.id < 3)
+				visibleShapes |= 1u << item.id;
+			else if (item.id == SPHERE_ID)
+				sphereVisible = true;
+			else
+				lightVisible[item.id - FIRST_LIGHT_ID] = true;
+		}
+		if (multiDrawIndirect && visibleShapes != batchedShapes) {
+			batchedShapes = visibleShapes;
+			shapeBatch.clear();
+			for (int i = 0; i < 3; i++) {
+				if (visibleShapes & (1u << i))
+					shapeBatch.add(pooledMeshes[i], *pooledTransforms[i]->getModelMatrix());
+			}
+			shapeBatch.upload();
+		}
 
-		shader.setMat4("_Model", sphereTransform.getModelMatrix());
-		sphereMesh.draw();
+		//Draw shapes
+		if (multiDrawIndirect && batchedLitShader->isReady()) {
+			batchedLitShader->use();
+			batchedLitShader->setInt("_Texture", 0);
+			shapeBatch.draw();
+		}
 
-		shader.setMat4("_Model", cylinderTransform.getModelMatrix());
-		cylinderMesh.draw();
+		litShader->use();
+		litShader->setInt("_Texture", 0);
+		if (!multiDrawIndirect) {
+			meshPool.bind();
+			for (int i = 0; i < 3; i++) {
+				if (!(visibleShapes & (1u << i)))
+					continue;
+				litShader->setMat4("_Model", *pooledTransforms[i]->getModelMatrix());
+				litShader->setMat3("_NormalMatrix", *pooledTransforms[i]->getNormalMatrix());
+				meshPool.draw(pooledMeshes[i]);
+			}
+		}
+		lodTrianglesDrawn = 0;
+		if (sphereVisible) {
+			litShader->setMat4("_Model", *sphereTransform.getModelMatrix());
+			litShader->setMat3("_NormalMatrix", *sphereTransform.getNormalMatrix());
+			int sphereLevel = sphereLODs.selectLevel(camera, sphereTransform.getPosition(), 1.0f, (float)SCREEN_HEIGHT, lodPixelError);
+			sphereLODs.draw(sphereLevel);
+			lodTrianglesDrawn = sphereLODs.getLevel(sphereLevel).getNumIndices() / 3;
+		}
 
 		//Render point lights
-		unlitShader.use();
-		unlitShader.setMat4("_ViewProjection", camera.ProjectionMatrix() * camera.ViewMatrix());
+		if (unlitShader.isReady()) {
+			unlitShader.use();
 
-		for (int i = 0; i < 4; ++i) {
-			unlitShader.setVec3("_Color", lights[i].color);
-
-			// Set the model matrix as a translation matrix for each light
-			unlitShader.setMat4("_Model", ew::Translate(lights[i].position));
-
-			sphereMesh.draw();
+			//Lights are grouped by LOD level, so each level is one instanced draw
+			int lightLevels[4];
+			for (int i = 0; i < numActiveLights; ++i) {
+				lightLevels[i] = sphereLODs.selectLevel(camera, lights[i].position, 1.0f, (float)SCREEN_HEIGHT, lodPixelError);
+			}
+			lightInstances.clear();
+			for (int level = 0; level < sphereLODs.getNumLevels(); level++) {
+				for (int i = 0; i < numActiveLights; ++i) {
+					if (lightVisible[i] && lightLevels[i] == level) {
+						lightInstances.add(ew::Translate(lights[i].position), ew::Vec4(lights[i].color, 1.0f));
+					}
+				}
+				lightLevelEnds[level] = lightInstances.getNumInstances();
+			}
+			lightInstances.upload();
+			for (int level = 0, first = 0; level < sphereLODs.getNumLevels(); level++) {
+				int count = (int)lightLevelEnds[level] - first;
+				sphereLODs.drawInstanced(level, lightInstances, first, count);
+				lodTrianglesDrawn += sphereLODs.getLevel(level).getNumIndices() / 3 * count;
+				first = (int)lightLevelEnds[level];
+			}
 		}
 
 		//Render UI
@@ -177,6 +389,30 @@ int main() {
 				}
 			}
 
+			if (ImGui::CollapsingHeader("Lights")) {
+				ImGui::SliderInt("Active Lights", &numActiveLights, 0, 4);
+				ImGui::Text("Shader variants: %d", (int)shaderVariants.getNumVariants());
+			}
+
+			if (ImGui::CollapsingHeader("LOD")) {
+				ImGui::SliderFloat("Max Pixel Error", &lodPixelError, 0.0f, 10.0f);
+				ImGui::Text("Sphere triangles: %d", lodTrianglesDrawn);
+			}
+
+			if (ImGui::CollapsingHeader("Culling")) {
+				ImGui::Text("Visible: %d", (int)cullStats.visible);
+				ImGui::Text("Culled: %d", (int)cullStats.culled);
+			}
+
+			if (ImGui::CollapsingHeader("Picking")) {
+				if (pickedHit.hit()) {
+					ImGui::Text("%s, triangle %u, %.2f units away", shapeNames[pickedHit.instance], pickedHit.triangle, pickedHit.distance);
+				}
+				else {
+					ImGui::Text("Left click a shape");
+				}
+			}
+
 			ImGui::ColorEdit3("BG color", &bgColor.x);
 			ImGui::End();
 			
@@ -0,0 +1,173 @@
+#include "benchHarness.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace bench {
+	static volatile const void* g_sink;
+	void doNotOptimize(const void* p)
+	{
+		g_sink = p;
+	}
+
+	static double sampleNs(const BenchFn& fn, uint64_t iterations) {
+		auto start = std::chrono::steady_clock::now();
+		fn(iterations);
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::nano>(end - start).count();
+	}
+
+	static double percentile(const std::vector<double>& sorted, double p) {
+		double idx = p * (sorted.size() - 1);
+		size_t lo = (size_t)idx;
+		size_t hi = std::min(lo + 1, sorted.size() - 1);
+		double t = idx - lo;
+		return sorted[lo] * (1.0 - t) + sorted[hi] * t;
+	}
+
+	std::vector<Result> run(const std::vector<Benchmark>& benchmarks, const Settings& settings)
+	{
+		std::vector<Result> results;
+		for (const Benchmark& b : benchmarks)
+		{
+			if (!settings.filter.empty() && b.name.find(settings.filter) == std::string::npos)
+				continue;
+
+			//Calibrate iterations per sample
+			uint64_t iterations = 1;
+			while (sampleNs(b.fn, iterations) < settings.minSampleMs * 1e6 && iterations < (1ull << 30)) {
+				iterations *= 2;
+			}
+			for (int i = 0; i < settings.warmupSamples; i++) {
+				sampleNs(b.fn, iterations);
+			}
+			std::vector<double> perOp(settings.samples);
+			double sum = 0;
+			for (int i = 0; i < settings.samples; i++) {
+				perOp[i] = sampleNs(b.fn, iterations) / iterations;
+				sum += perOp[i];
+			}
+			std::sort(perOp.begin(), perOp.end());
+
+			Result r;
+			r.name = b.name;
+			r.iterations = iterations;
+			r.samples = settings.samples;
+			r.minNs = perOp.front();
+			r.maxNs = perOp.back();
+			r.meanNs = sum / settings.samples;
+			r.p50Ns = percentile(perOp, 0.5);
+			r.p90Ns = percentile(perOp, 0.9);
+			r.p99Ns = percentile(perOp, 0.99);
+			results.push_back(r);
+			printf("  %-36s %14.1f ns\n", r.name.c_str(), r.p50Ns);
+		}
+		return results;
+	}
+
+	void printTable(const std::vector<Result>& results)
+	{
+		printf("\n%-36s %12s %12s %12s %12s %12s %12s\n", "benchmark", "min ns", "mean ns", "p50 ns", "p90 ns", "p99 ns", "iters");
+		for (const Result& r : results) {
+			printf("%-36s %12.1f %12.1f %12.1f %12.1f %12.1f %12llu\n", r.name.c_str(), r.minNs, r.meanNs, r.p50Ns, r.p90Ns, r.p99Ns, (unsigned long long)r.iterations);
+		}
+	}
+
+	bool writeJson(const std::string& path, const std::vector<Result>& results)
+	{
+		FILE* file = fopen(path.c_str(), "w");
+		if (!file) {
+			printf("Failed to open %s for writing\n", path.c_str());
+			return false;
+		}
+		fprintf(file, "{\n  \"benchmarks\": [\n");
+		for (size_t i = 0; i < results.size(); i++) {
+			const Result& r = results[i];
+			fprintf(file, "    {\"name\": \"%s\", \"iterations\": %llu, \"samples\": %d, \"min_ns\": %.3f, \"mean_ns\": %.3f, \"p50_ns\": %.3f, \"p90_ns\": %.3f, \"p99_ns\": %.3f, \"max_ns\": %.3f}%s\n",
+				r.name.c_str(), (unsigned long long)r.iterations, r.samples, r.minNs, r.meanNs, r.p50Ns, r.p90Ns, r.p99Ns, r.maxNs,
+				i + 1 < results.size() ? "," : "");
+		}
+		fprintf(file, "  ]\n}\n");
+		fclose(file);
+		return true;
+	}
+
+	//Finds "key": value inside one benchmark object
+	static bool readNumber(const std::string& obj, const char* key, double* out) {
+		std::string pattern = std::string("\"") + key + "\":";
+		size_t pos = obj.find(pattern);
+		if (pos == std::string::npos)
+			return false;
+		*out = strtod(obj.c_str() + pos + pattern.size(), nullptr);
+		return true;
+	}
+
+	//Reads files produced by writeJson. Not a general JSON parser
+	bool readJson(const std::string& path, std::vector<Result>* results)
+	{
+		std::ifstream fstream(path);
+		if (!fstream.is_open()) {
+			printf("Failed to load file %s\n", path.c_str());
+			return false;
+		}
+		std::stringstream buffer;
+		buffer << fstream.rdbuf();
+		std::string text = buffer.str();
+
+		//Every object after the outer one is a benchmark entry
+		size_t pos = text.find('{');
+		while (pos != std::string::npos && (pos = text.find('{', pos + 1)) != std::string::npos) {
+			size_t end = text.find('}', pos);
+			if (end == std::string::npos)
+				break;
+			std::string obj = text.substr(pos, end - pos);
+			size_t nameKey = obj.find("\"name\":");
+			if (nameKey != std::string::npos) {
+				size_t q0 = obj.find('"', nameKey + 7);
+				size_t q1 = obj.find('"', q0 + 1);
+				Result r;
+				r.name = obj.substr(q0 + 1, q1 - q0 - 1);
+				double v = 0;
+				if (readNumber(obj, "iterations", &v)) r.iterations = (uint64_t)v;
+				if (readNumber(obj, "samples", &v)) r.samples = (int)v;
+				readNumber(obj, "min_ns", &r.minNs);
+				readNumber(obj, "mean_ns", &r.meanNs);
+				readNumber(obj, "p50_ns", &r.p50Ns);
+				readNumber(obj, "p90_ns", &r.p90Ns);
+				readNumber(obj, "p99_ns", &r.p99Ns);
+				readNumber(obj, "max_ns", &r.maxNs);
+				results->push_back(r);
+			}
+			pos = end;
+		}
+		return true;
+	}
+
+	int compare(const std::vector<Result>& baseline, const std::vector<Result>& current, double threshold)
+	{
+		int regressions = 0;
+		printf("\n%-36s %12s %12s %9s\n", "benchmark", "base p50", "p50", "delta");
+		for (const Result& r : current) {
+			auto it = std::find_if(baseline.begin(), baseline.end(), [&](const Result& b) { return b.name == r.name; });
+			if (it == baseline.end()) {
+				printf("%-36s %12s %12.1f %9s\n", r.name.c_str(), "-", r.p50Ns, "new");
+				continue;
+			}
+			double delta = (r.p50Ns - it->p50Ns) / it->p50Ns;
+			const char* flag = "";
+			if (delta > threshold) {
+				flag = "  REGRESSION";
+				regressions++;
+			}
+			else if (delta < -threshold) {
+				flag = "  faster";
+			}
+			printf("%-36s %12.1f %12.1f %+8.1f%%%s\n", r.name.c_str(), it->p50Ns, r.p50Ns, delta * 100.0, flag);
+		}
+		return regressions;
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+#include <stdint.h>
+
+namespace bench {
+	//Runs the measured operation `iterations` times
+	using BenchFn = std::function<void(uint64_t iterations)>;
+
+	struct Benchmark {
+		std::string name;
+		BenchFn fn;
+	};
+
+	struct Settings {
+		int warmupSamples = 3;
+		int samples = 30;
+		double minSampleMs = 2.0; //Iterations per sample are doubled until a sample takes at least this long
+		std::string filter; //Only run benchmarks whose name contains this
+	};
+
+	//Per operation timings in nanoseconds
+	struct Result {
+		std::string name;
+		uint64_t iterations = 0; //Per sample
+		int samples = 0;
+		double minNs = 0, meanNs = 0, p50Ns = 0, p90Ns = 0, p99Ns = 0, maxNs = 0;
+	};
+
+	std::vector<Result> run(const std::vector<Benchmark>& benchmarks, const Settings& settings);
+	void printTable(const std::vector<Result>& results);
+
+	bool writeJson(const std::string& path, const std::vector<Result>& results);
+	bool readJson(const std::string& path, std::vector<Result>* results);
+
+	/// <summary>
+	/// Compares medians against a baseline. Prints a diff table and returns the number of benchmarks
+	/// that got slower by more than threshold (0.1 = 10%)
+	/// </summary>
+	int compare(const std::vector<Result>& baseline, const std::vector<Result>& current, double threshold);
+
+	//Keeps the compiler from optimizing away a result
+	void doNotOptimize(const void* p);
+}
@@ -0,0 +1,646 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include <ew/ewMath/ewMath.h>
+#include <ew/ewMath/transformations.h>
+#include <ew/procGen.h>
+#include <ew/transformArray.h>
+#include <ew/instanceBuffer.h>
+#include <ew/vertexPacking.h>
+#include <ew/meshOptimizer.h>
+#include <ew/meshSimplifier.h>
+#include <ew/meshlet.h>
+#include <ew/meshBounds.h>
+#include <ew/frustum.h>
+#include <ew/objLoader.h>
+#include <ew/bvh.h>
+#include <ew/uniformTable.h>
+#include <zoo/procGen.h>
+
+#include "benchHarness.h"
+
+//Inputs are generated once so every benchmark works on the same data
+struct BenchData {
+	std::vector<ew::Mat4> matrices;
+	std::vector<ew::Vec3> vectors;
+	BenchData() {
+		srand(1234);
+		matrices.resize(256);
+		vectors.resize(256);
+		for (size_t i = 0; i < matrices.size(); i++) {
+			for (int c = 0; c < 4; c++) {
+				for (int r = 0; r < 4; r++) {
+					matrices[i][c][r] = ew::RandomRange(-2.0f, 2.0f);
+				}
+			}
+			vectors[i] = ew::Vec3(ew::RandomRange(-10.0f, 10.0f), ew::RandomRange(-10.0f, 10.0f), ew::RandomRange(-10.0f, 10.0f));
+		}
+	}
+};
+
+/// <summary>
+/// OBJ text for a mesh, with separate position/uv/normal indices like exporters write them
+/// </summary>
+static std::string toObjText(const ew::MeshData& mesh) {
+	std::string text;
+	char line[256];
+	for (const ew::Vertex& v : mesh.vertices) {
+		snprintf(line, sizeof(line), "v %f %f %f\nvt %f %f\nvn %f %f %f\n", v.pos.x, v.pos.y, v.pos.z, v.uv.x, v.uv.y, v.normal.x, v.normal.y, v.normal.z);
+		text += line;
+	}
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+		unsigned int a = mesh.indices[i] + 1, b = mesh.indices[i + 1] + 1, c = mesh.indices[i + 2] + 1;
+		snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c);
+		text += line;
+	}
+	return text;
+}
+
+//Rays from in front of the origin through a size x size grid covering a unit sphere, neighbours are coherent
+static std::vector<ew::Ray> createRayGrid(int size) {
+	std::vector<ew::Ray> rays(size * size);
+	for (int y = 0; y < size; y++) {
+		for (int x = 0; x < size; x++) {
+			ew::Ray& ray = rays[y * size + x];
+			ray.origin = ew::Vec3(0.0f, 0.0f, 2.0f);
+			ray.direction = ew::Vec3((x + 0.5f) / size - 0.5f, (y + 0.5f) / size - 0.5f, -2.0f);
+		}
+	}
+	return rays;
+}
+
+//Bounds scattered around a camera at the origin looking down -z, about half of them inside its frustum
+struct CullScene {
+	ew::Frustum frustum;
+	std::vector<ew::BoundingSphere> spheres;
+	std::vector<ew::AABB> boxes;
+};
+static CullScene createCullScene(size_t count) {
+	CullScene scene;
+	scene.frustum = ew::ExtractFrustum(ew::Perspective(ew::Radians(60.0f), 1.77f, 0.1f, 100.0f)
+		* ew::LookAt(ew::Vec3(0.0f), ew::Vec3(0.0f, 0.0f, -1.0f), ew::Vec3(0, 1, 0)));
+	scene.spheres.resize(count);
+	scene.boxes.resize(count);
+	srand(5678);
+	for (size_t i = 0; i < count; i++) {
+		ew::Vec3 center = ew::Vec3(ew::RandomRange(-60.0f, 60.0f), ew::RandomRange(-40.0f, 40.0f), ew::RandomRange(-110.0f, 10.0f));
+		ew::Vec3 extents = ew::Vec3(ew::RandomRange(0.1f, 3.0f), ew::RandomRange(0.1f, 3.0f), ew::RandomRange(0.1f, 3.0f));
+		scene.spheres[i].center = center;
+		scene.spheres[i].radius = extents.x;
+		scene.boxes[i].min = center - extents;
+		scene.boxes[i].max = center + extents;
+	}
+	return scene;
+}
+
+//Signed distance of the bounds to the frustum, negative outside. Near 0 the SIMD and scalar tests may round differently
+static float cullMargin(const ew::Frustum& frustum, const ew::BoundingSphere& sphere) {
+	float margin = 1e30f;
+	for (const ew::Plane& p : frustum.planes) {
+		margin = std::min(margin, ew::Dot(p.normal, sphere.center) + p.d + sphere.radius);
+	}
+	return margin;
+}
+static float cullMargin(const ew::Frustum& frustum, const ew::AABB& box) {
+	float margin = 1e30f;
+	ew::Vec3 c = box.center(), e = box.extents();
+	for (const ew::Plane& p : frustum.planes) {
+		float r = e.x * fabsf(p.normal.x) + e.y * fabsf(p.normal.y) + e.z * fabsf(p.normal.z);
+		margin = std::min(margin, ew::Dot(p.normal, c) + p.d + r);
+	}
+	return margin;
+}
+
+static std::vector<bench::Benchmark> createBenchmarks(BenchData& data) {
+	std::vector<bench::Benchmark> benchmarks;
+	const size_t mask = data.matrices.size() - 1;
+
+	//ewMath
+	benchmarks.push_back({ "mat4_multiply", [&data, mask](uint64_t n) {
+		ew::Mat4 acc = ew::IdentityMatrix();
+		for (uint64_t i = 0; i < n; i++) {
+			acc = data.matrices[i & mask] * data.matrices[(i + 1) & mask];
+			bench::doNotOptimize(&acc);
+		}
+	} });
+	benchmarks.push_back({ "mat4_vec4_multiply", [&data, mask](uint64_t n) {
+		ew::Vec4 v(1.0f, 2.0f, 3.0f, 1.0f);
+		for (uint64_t i = 0; i < n; i++) {
+			v = data.matrices[i & mask] * ew::Vec4(data.vectors[i & mask], 1.0f);
+			bench::doNotOptimize(&v);
+		}
+	} });
+	benchmarks.push_back({ "mat4_transpose", [&data, mask](uint64_t n) {
+		for (uint64_t i = 0; i < n; i++) {
+			ew::Mat4 t = ew::Transpose(data.matrices[i & mask]);
+			bench::doNotOptimize(&t);
+		}
+	} });
+	benchmarks.push_back({ "mat4_inverse", [&data, mask](uint64_t n) {
+		for (uint64_t i = 0; i < n; i++) {
+			ew::Mat4 inv = ew::Inverse(data.matrices[i & mask]);
+			bench::doNotOptimize(&inv);
+		}
+	} });
+	benchmarks.push_back({ "normal_matrix", [&data, mask](uint64_t n) {
+		for (uint64_t i = 0; i < n; i++) {
+			ew::Mat3 m = ew::NormalMatrix(data.matrices[i & mask]);
+			bench::doNotOptimize(&m);
+		}
+	} });
+	benchmarks.push_back({ "lookat", [&data, mask](uint64_t n) {
+		for (uint64_t i = 0; i < n; i++) {
+			ew::Mat4 m = ew::LookAt(data.vectors[i & mask], data.vectors[(i + 7) & mask], ew::Vec3(0, 1, 0));
+			bench::doNotOptimize(&m);
+		}
+	} });
+	benchmarks.push_back({ "perspective", [](uint64_t n) {
+		for (uint64_t i = 0; i < n; i++) {
+			ew::Mat4 m = ew::Perspective(ew::Radians(60.0f + (i & 15)), 1.77f, 0.1f, 100.0f);
+			bench::doNotOptimize(&m);
+		}
+	} });
+	benchmarks.push_back({ "normalize_cross", [&data, mask](uint64_t n) {
+		for (uint64_t i = 0; i < n; i++) {
+			ew::Vec3 v = ew::Normalize(ew::Cross(data.vectors[i & mask], data.vectors[(i + 1) & mask]));
+			bench::doNotOptimize(&v);
+		}
+	} });
+	benchmarks.push_back({ "transform_getModelMatrix", [&data, mask](uint64_t n) {
+		ew::Transform t;
+		for (uint64_t i = 0; i < n; i++) {
+			t.position = data.vectors[i & mask];
+			t.rotation = data.vectors[(i + 3) & mask] * 36.0f;
+			ew::Mat4 m = t.getModelMatrix();
+			bench::doNotOptimize(&m);
+		}
+	} });
+	benchmarks.push_back({ "transformArray_100k", [&data, mask](uint64_t n) {
+		static ew::TransformArray transforms(100000);
+		for (size_t i = 0; i < transforms.size(); i++) {
+			transforms.setRotation(i, data.vectors[i & mask] * 36.0f);
+		}
+		for (uint64_t i = 0; i < n; i++) {
+			transforms.computeModelMatrices();
+			bench::doNotOptimize(transforms.modelMatrices());
+		}
+	} });
+	//CPU side of drawing 100k objects with one Mesh::drawInstanced call
+	benchmarks.push_back({ "instanceBuffer_fill_100k", [](uint64_t n) {
+		static ew::TransformArray transforms(100000);
+		static ew::InstanceBuffer instances;
+		transforms.computeModelMatrices();
+		for (uint64_t i = 0; i < n; i++) {
+			instances.clear();
+			instances.add(transforms.modelMatrices(), transforms.size());
+			bench::doNotOptimize(instances.data());
+		}
+	} });
+
+	//What a Shader setter costs on the CPU now that it no longer calls glGetUniformLocation
+	benchmarks.push_back({ "uniformTable_find_16", [](uint64_t n) {
+		static ew::UniformTable table;
+		if (table.size() == 0) {
+			const char* names[] = { "_Model", "_NormalMatrix", "_ViewProjection", "_Texture", "_CameraPosition", "_Time" };
+			for (int i = 0; i < 6; i++) {
+				table.insert(names[i], i);
+			}
+			for (int i = 0; i < 8; i++) {
+				table.insert("_Lights[" + std::to_string(i) + "].position", 6 + i * 2);
+				table.insert("_Lights[" + std::to_string(i) + "].color", 7 + i * 2);
+			}
+		}
+		for (uint64_t i = 0; i < n; i++) {
+			int sum = table.find("_Model") + table.find("_NormalMatrix") + table.find("_ViewProjection") + table.find("_Texture");
+			sum += table.find("_Lights[0].position") + table.find("_Lights[0].color") + table.find("_Lights[1].position") + table.find("_Lights[1].color");
+			sum += table.find("_Lights[2].position") + table.find("_Lights[2].color") + table.find("_Lights[3].position") + table.find("_Lights[3].color");
+			sum += table.find("_CameraPosition") + table.find("_Time") + table.find("_Missing") + table.find("_Lights[7].color");
+			bench::doNotOptimize(&sum);
+		}
+	} });
+
+	//procGen
+	const int subdivisions[] = { 8, 64, 256 };
+	for (int s : subdivisions) {
+		std::string suffix = "_" + std::to_string(s);
+		benchmarks.push_back({ "createSphere" + suffix, [s](uint64_t n) {
+			for (uint64_t i = 0; i < n; i++) {
+				ew::MeshData mesh = ew::createSphere(0.5f, s);
+				bench::doNotOptimize(mesh.vertices.data());
+			}
+		} });
+		benchmarks.push_back({ "createPlane" + suffix, [s](uint64_t n) {
+			for (uint64_t i = 0; i < n; i++) {
+				ew::MeshData mesh = ew::createPlane(5.0f, 5.0f, s);
+				bench::doNotOptimize(mesh.vertices.data());
+			}
+		} });
+		benchmarks.push_back({ "createCylinder" + suffix, [s](uint64_t n) {
+			for (uint64_t i = 0; i < n; i++) {
+				ew::MeshData mesh = ew::createCylinder(0.5f, 1.0f, s);
+				bench::doNotOptimize(mesh.vertices.data());
+			}
+		} });
+	}
+
+	//meshOptimizer, meshSimplifier, meshlet
+	benchmarks.push_back({ "optimizeMesh_sphere_64", [](uint64_t n) {
+		ew::MeshData source = ew::createSphere(0.5f, 64);
+		for (uint64_t i = 0; i < n; i++) {
+			ew::MeshData mesh = source;
+			ew::optimizeMesh(&mesh);
+			bench::doNotOptimize(mesh.indices.data());
+		}
+	} });
+	benchmarks.push_back({ "simplifyMesh_sphere_64_10pct", [](uint64_t n) {
+		ew::MeshData source = ew::createSphere(0.5f, 64);
+		for (uint64_t i = 0; i < n; i++) {
+			ew::MeshData mesh = ew::simplifyMesh(source, source.indices.size() / 30 * 3);
+			bench::doNotOptimize(mesh.indices.data());
+		}
+	} });
+	benchmarks.push_back({ "cullMeshlets_sphere_256", [](uint64_t n) {
+		static ew::MeshData mesh = ew::createSphere(0.5f, 256);
+		static std::vector<ew::Meshlet> meshlets = ew::buildMeshlets(&mesh);
+		ew::Vec3 cameraPosition = ew::Vec3(0.0f, 0.0f, 5.0f);
+		ew::Frustum frustum = ew::ExtractFrustum(ew::Perspective(ew::Radians(60.0f), 1.77f, 0.1f, 100.0f) * ew::LookAt(cameraPosition, ew::Vec3(0.0f), ew::Vec3(0, 1, 0)));
+		std::vector<ew::IndexRange> ranges;
+		for (uint64_t i = 0; i < n; i++) {
+			ew::cullMeshlets(meshlets, ew::IdentityMatrix(), frustum, cameraPosition, &ranges);
+			bench::doNotOptimize(ranges.data());
+		}
+	} });
+
+	//frustum. Batched culls against the per element tests they fall back to
+	benchmarks.push_back({ "CullSpheres_4096", [](uint64_t n) {
+		static CullScene scene = createCullScene(4096);
+		static std::vector<uint8_t> visible(scene.spheres.size());
+		for (uint64_t i = 0; i < n; i++) {
+			size_t numVisible = ew::CullSpheres(scene.frustum, scene.spheres.data(), scene.spheres.size(), visible.data());
+			bench::doNotOptimize(&numVisible);
+		}
+	} });
+	benchmarks.push_back({ "SphereInFrustum_4096", [](uint64_t n) {
+		static CullScene scene = createCullScene(4096);
+		for (uint64_t i = 0; i < n; i++) {
+			size_t numVisible = 0;
+			for (const ew::BoundingSphere& sphere : scene.spheres) {
+				numVisible += ew::SphereInFrustum(scene.frustum, sphere) ? 1 : 0;
+			}
+			bench::doNotOptimize(&numVisible);
+		}
+	} });
+	benchmarks.push_back({ "CullAABBs_4096", [](uint64_t n) {
+		static CullScene scene = createCullScene(4096);
+		static std::vector<uint8_t> visible(scene.boxes.size());
+		for (uint64_t i = 0; i < n; i++) {
+			size_t numVisible = ew::CullAABBs(scene.frustum, scene.boxes.data(), scene.boxes.size(), visible.data());
+			bench::doNotOptimize(&numVisible);
+		}
+	} });
+	benchmarks.push_back({ "AABBInFrustum_4096", [](uint64_t n) {
+		static CullScene scene = createCullScene(4096);
+		for (uint64_t i = 0; i < n; i++) {
+			size_t numVisible = 0;
+			for (const ew::AABB& box : scene.boxes) {
+				numVisible += ew::AABBInFrustum(scene.frustum, box) ? 1 : 0;
+			}
+			bench::doNotOptimize(&numVisible);
+		}
+	} });
+
+	benchmarks.push_back({ "computeBounds_sphere_256", [](uint64_t n) {
+		static ew::MeshData mesh = ew::createSphere(0.5f, 256);
+		for (uint64_t i = 0; i < n; i++) {
+			ew::computeBounds(&mesh);
+			bench::doNotOptimize(&mesh.boundingSphere);
+		}
+	} });
+
+	//objLoader. Same parser on one thread and on all hardware threads
+	for (unsigned int threads : { 1u, 0u }) {
+		std::string name = threads == 1 ? "parseObj_sphere_128_1thread" : "parseObj_sphere_128_threads";
+		benchmarks.push_back({ name, [threads](uint64_t n) {
+			static std::string text = toObjText(ew::createSphere(0.5f, 128));
+			for (uint64_t i = 0; i < n; i++) {
+				ew::MeshData mesh = ew::parseObj(text.data(), text.size(), threads);
+				bench::doNotOptimize(mesh.vertices.data());
+			}
+		} });
+	}
+	//bvh. Build on all hardware threads, then 1024 coherent rays one at a time and in packets of 4
+	benchmarks.push_back({ "bvh_build_sphere_256", [](uint64_t n) {
+		static ew::MeshData mesh = ew::createSphere(0.5f, 256);
+		for (uint64_t i = 0; i < n; i++) {
+			ew::MeshBVH bvh(mesh);
+			bench::doNotOptimize(bvh.getNodes().data());
+		}
+	} });
+	for (bool packets : { false, true }) {
+		benchmarks.push_back({ packets ? "bvh_raycast_packet_1k_sphere_256" : "bvh_raycast_1k_sphere_256", [packets](uint64_t n) {
+			static ew::MeshBVH bvh(ew::createSphere(0.5f, 256));
+			static std::vector<ew::Ray> rays = createRayGrid(32);
+			std::vector<ew::RayHit> hits(rays.size());
+			for (uint64_t i = 0; i < n; i++) {
+				std::fill(hits.begin(), hits.end(), ew::RayHit());
+				if (packets) {
+					bvh.intersect(rays.data(), hits.data(), rays.size());
+				}
+				else {
+					for (size_t r = 0; r < rays.size(); r++) {
+						bvh.intersect(rays[r], &hits[r]);
+					}
+				}
+				bench::doNotOptimize(hits.data());
+			}
+		} });
+	}
+	return benchmarks;
+}
+
+/// <summary>
+/// Bytes per vertex and quantization error of every packed vertex layout on the procedural meshes
+/// </summary>
+static void printVertexFormatReport() {
+	struct NamedMesh { const char* name; ew::MeshData mesh; };
+	NamedMesh meshes[] = {
+		{ "sphere_64", ew::createSphere(0.5f, 64) },
+		{ "plane_256", ew::createPlane(5.0f, 5.0f, 256) },
+		{ "cylinder_64", ew::createCylinder(0.5f, 1.0f, 64) },
+	};
+	const char* positionNames[] = { "f32", "half", "unorm16" };
+	const char* normalNames[] = { "f32", "10_10_10_2", "oct16" };
+	const char* uvNames[] = { "f32", "unorm16" };
+	printf("\n%-12s %-8s %-11s %-8s %6s %12s %12s %10s %10s %10s\n",
+		"mesh", "pos", "normal", "uv", "bytes", "max pos err", "mean pos", "max n deg", "mean n deg", "max uv err");
+	for (NamedMesh& m : meshes) {
+		for (int p = 0; p < 3; p++) {
+			for (int n = 0; n < 3; n++) {
+				for (int u = 0; u < 2; u++) {
+					ew::VertexLayout layout;
+					layout.position = (ew::PositionFormat)p;
+					layout.normal = (ew::NormalFormat)n;
+					layout.uv = (ew::UVFormat)u;
+					ew::PackingError e = ew::measurePackingError(m.mesh, ew::packMeshData(m.mesh, layout));
+					printf("%-12s %-8s %-11s %-8s %6u %12.3g %12.3g %10.4f %10.4f %10.3g\n", m.name, positionNames[p], normalNames[n], uvNames[u],
+						e.bytesPerVertex, e.maxPositionError, e.meanPositionError, e.maxNormalErrorDegrees, e.meanNormalErrorDegrees, e.maxUVError);
+				}
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Simulated vertex cache and fetch efficiency of the procedural meshes before and after optimizeMesh
+/// </summary>
+static void printMeshOptimizerReport() {
+	struct NamedMesh { const char* name; ew::MeshData mesh; };
+	NamedMesh meshes[] = {
+		{ "sphere_64", ew::createSphere(0.5f, 64) },
+		{ "plane_256", ew::createPlane(5.0f, 5.0f, 256) },
+		{ "cylinder_64", ew::createCylinder(0.5f, 1.0f, 64) },
+	};
+	printf("\n%-12s %8s %8s %8s %8s %10s %10s %8s\n", "mesh", "acmr", "acmr opt", "atvr", "atvr opt", "overfetch", "fetch opt", "applied");
+	for (NamedMesh& m : meshes) {
+		ew::VertexCacheStats cacheBefore = ew::analyzeVertexCache(m.mesh.indices, m.mesh.vertices.size());
+		ew::VertexFetchStats fetchBefore = ew::analyzeVertexFetch(m.mesh.indices, m.mesh.vertices.size());
+		bool applied = ew::optimizeMesh(&m.mesh);
+		ew::VertexCacheStats cacheAfter = ew::analyzeVertexCache(m.mesh.indices, m.mesh.vertices.size());
+		ew::VertexFetchStats fetchAfter = ew::analyzeVertexFetch(m.mesh.indices, m.mesh.vertices.size());
+		printf("%-12s %8.3f %8.3f %8.3f %8.3f %10.3f %10.3f %8s\n", m.name, cacheBefore.acmr, cacheAfter.acmr,
+			cacheBefore.atvr, cacheAfter.atvr, fetchBefore.overfetch, fetchAfter.overfetch, applied ? "yes" : "no");
+	}
+}
+
+/// <summary>
+/// Load time of an OBJ file on one thread and on every hardware thread. The first load warms the page cache
+/// </summary>
+static void printObjLoadReport(const char* filePath) {
+	ew::loadObj(filePath, 1);
+	const unsigned int hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	for (unsigned int threads : { 1u, hardwareThreads }) {
+		auto start = std::chrono::steady_clock::now();
+		ew::MeshData mesh = ew::loadObj(filePath, threads);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		FILE* file = fopen(filePath, "rb");
+		double megabytes = 0.0;
+		if (file) {
+			fseek(file, 0, SEEK_END);
+			megabytes = ftell(file) / (1024.0 * 1024.0);
+			fclose(file);
+		}
+		printf("%2u thread(s): %9.1f ms %8.1f MB/s  %zu vertices %zu triangles\n", threads, ms, megabytes / (ms / 1000.0),
+			mesh.vertices.size(), mesh.indices.size() / 3);
+	}
+}
+
+/// <summary>
+/// Vertices and triangles removed by weldVertices from the ew and zoo procedural meshes
+/// </summary>
+static void printWeldReport() {
+	struct NamedMesh { const char* name; ew::MeshData mesh; };
+	NamedMesh meshes[] = {
+		{ "ew sphere_64", ew::createSphere(0.5f, 64) },
+		{ "ew cylinder_64", ew::createCylinder(0.5f, 1.0f, 64) },
+		{ "ew cube", ew::createCube(1.0f) },
+		{ "zoo sphere_64", zoo::createSphere(0.5f, 64) },
+		{ "zoo cylinder_64", zoo::createCylinder(1.0f, 0.5f, 64) },
+		{ "zoo plane_64", zoo::createPlane(5.0f, 5.0f, 64) },
+	};
+	printf("\n%-16s %9s %9s %9s %9s %10s\n", "mesh", "vertices", "welded", "tris", "tris kept", "reduction");
+	for (NamedMesh& m : meshes) {
+		ew::WeldStats stats = ew::weldVertices(&m.mesh);
+		printf("%-16s %9zu %9zu %9zu %9zu %9.1f%%\n", m.name, stats.verticesBefore, stats.verticesAfter,
+			stats.trianglesBefore, stats.trianglesAfter, stats.vertexReduction * 100.0f);
+	}
+}
+
+/// <summary>
+/// BVH build time on one and on every hardware thread, and rays per second for coherent and random rays,
+/// single and in packets of 4
+/// </summary>
+static void printBVHReport() {
+	ew::MeshData mesh = ew::createSphere(0.5f, 256);
+	const unsigned int hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	ew::MeshBVH bvh;
+	for (unsigned int threads : { 1u, hardwareThreads }) {
+		auto start = std::chrono::steady_clock::now();
+		bvh.build(mesh, threads);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		printf("build %2u thread(s): %8.2f ms  %zu triangles %zu nodes\n", threads, ms, bvh.getNumTriangles(), bvh.getNodes().size());
+	}
+
+	std::vector<ew::Ray> coherent = createRayGrid(512);
+	std::vector<ew::Ray> random(coherent.size());
+	srand(1);
+	for (ew::Ray& ray : random) {
+		ray.origin = ew::Vec3(rand() / (float)RAND_MAX - 0.5f, rand() / (float)RAND_MAX - 0.5f, 2.0f);
+		ray.direction = ew::Vec3(rand() / (float)RAND_MAX - 0.5f, rand() / (float)RAND_MAX - 0.5f, -2.0f);
+	}
+	struct NamedRays { const char* name; const std::vector<ew::Ray>* rays; };
+	NamedRays raySets[] = { { "coherent", &coherent }, { "random", &random } };
+	printf("\n%-10s %14s %14s %8s\n", "rays", "single Mray/s", "packet Mray/s", "hit %");
+	for (NamedRays& set : raySets) {
+		const std::vector<ew::Ray>& rays = *set.rays;
+		std::vector<ew::RayHit> hits(rays.size());
+		auto start = std::chrono::steady_clock::now();
+		for (size_t r = 0; r < rays.size(); r++) {
+			bvh.intersect(rays[r], &hits[r]);
+		}
+		double singleSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		size_t numHits = std::count_if(hits.begin(), hits.end(), [](const ew::RayHit& hit) { return hit.hit(); });
+		std::fill(hits.begin(), hits.end(), ew::RayHit());
+		start = std::chrono::steady_clock::now();
+		bvh.intersect(rays.data(), hits.data(), rays.size());
+		double packetSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		printf("%-10s %14.2f %14.2f %7.1f%%\n", set.name, rays.size() / singleSeconds / 1e6, rays.size() / packetSeconds / 1e6,
+			numHits * 100.0 / rays.size());
+	}
+}
+
+/// <summary>
+/// Checks CullSpheres and CullAABBs against SphereInFrustum and AABBInFrustum element by element and times both.
+/// Disagreements within CULL_TOLERANCE of a plane are rounding, anything else is a bug. Returns false on bugs
+/// </summary>
+static bool printCullReport() {
+	const float CULL_TOLERANCE = 1e-4f;
+	CullScene scene = createCullScene(100000);
+	const size_t count = scene.spheres.size();
+	std::vector<uint8_t> visible(count);
+	bool passed = true;
+	printf("\n%-8s %10s %10s %10s %12s %12s\n", "bounds", "visible", "rounding", "mismatches", "batched ns", "scalar ns");
+	for (int type = 0; type < 2; type++) {
+		const bool spheres = type == 0;
+		auto start = std::chrono::steady_clock::now();
+		size_t numVisible = spheres ? ew::CullSpheres(scene.frustum, scene.spheres.data(), count, visible.data())
+			: ew::CullAABBs(scene.frustum, scene.boxes.data(), count, visible.data());
+		double batchedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+
+		std::vector<uint8_t> reference(count);
+		start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < count; i++) {
+			reference[i] = (spheres ? ew::SphereInFrustum(scene.frustum, scene.spheres[i]) : ew::AABBInFrustum(scene.frustum, scene.boxes[i])) ? 1 : 0;
+		}
+		double scalarNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+
+		size_t numRounding = 0, numMismatches = 0, numFlagged = 0;
+		for (size_t i = 0; i < count; i++) {
+			numFlagged += visible[i];
+			if (visible[i] == reference[i])
+				continue;
+			float margin = spheres ? cullMargin(scene.frustum, scene.spheres[i]) : cullMargin(scene.frustum, scene.boxes[i]);
+			if (fabsf(margin) <= CULL_TOLERANCE) {
+				numRounding++;
+			}
+			else {
+				numMismatches++;
+			}
+		}
+		//The returned count must agree with the flags written
+		if (numVisible != numFlagged) {
+			numMismatches++;
+		}
+		printf("%-8s %10zu %10zu %10zu %12.2f %12.2f\n", spheres ? "spheres" : "aabbs", numVisible, numRounding, numMismatches, batchedNs, scalarNs);
+		passed = passed && numMismatches == 0;
+	}
+	printf(passed ? "Batched culling matches the scalar tests\n" : "FAILED: batched culling disagrees with the scalar tests\n");
+	return passed;
+}
+
+static void printUsage() {
+	printf("Usage: core_bench [options]\n"
+		"  --filter <text>      Only run benchmarks whose name contains text\n"
+		"  --samples <n>        Measured samples per benchmark (default 30)\n"
+		"  --warmup <n>         Warmup samples per benchmark (default 3)\n"
+		"  --min-sample-ms <n>  Minimum duration of one sample (default 2)\n"
+		"  --json <file>        Write results as JSON\n"
+		"  --compare <file>     Diff p50 timings against a baseline JSON file\n"
+		"  --threshold <f>      Relative slowdown counted as a regression (default 0.10)\n"
+		"  --vertex-formats     Print size and error of the packed vertex layouts and exit\n"
+		"  --mesh-optimizer     Print vertex cache and fetch stats before and after optimizeMesh and exit\n"
+		"  --weld               Print vertices and triangles removed by weldVertices from the procedural meshes and exit\n"
+		"  --obj-load <file>    Print load time of an OBJ file single and multi threaded and exit\n"
+		"  --bvh                Print BVH build time and ray cast throughput and exit\n"
+		"  --cull               Check batched frustum culling against the scalar tests, print timings and exit\n"
+		"Exits with 1 when --compare finds regressions or --cull finds mismatches\n");
+}
+
+int main(int argc, char** argv) {
+	bench::Settings settings;
+	std::string jsonPath, comparePath;
+	double threshold = 0.10;
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(arg, "--filter") && hasValue) settings.filter = argv[++i];
+		else if (!strcmp(arg, "--samples") && hasValue) settings.samples = atoi(argv[++i]);
+		else if (!strcmp(arg, "--warmup") && hasValue) settings.warmupSamples = atoi(argv[++i]);
+		else if (!strcmp(arg, "--min-sample-ms") && hasValue) settings.minSampleMs = atof(argv[++i]);
+		else if (!strcmp(arg, "--json") && hasValue) jsonPath = argv[++i];
+		else if (!strcmp(arg, "--compare") && hasValue) comparePath = argv[++i];
+		else if (!strcmp(arg, "--threshold") && hasValue) threshold = atof(argv[++i]);
+		else if (!strcmp(arg, "--vertex-formats")) {
+			printVertexFormatReport();
+			return 0;
+		}
+		else if (!strcmp(arg, "--mesh-optimizer")) {
+			printMeshOptimizerReport();
+			return 0;
+		}
+		else if (!strcmp(arg, "--weld")) {
+			printWeldReport();
+			return 0;
+		}
+		else if (!strcmp(arg, "--bvh")) {
+			printBVHReport();
+			return 0;
+		}
+		else if (!strcmp(arg, "--cull")) {
+			return printCullReport() ? 0 : 1;
+		}
+		else if (!strcmp(arg, "--obj-load") && hasValue) {
+			printObjLoadReport(argv[++i]);
+			return 0;
+		}
+		else {
+			printUsage();
+			return strcmp(arg, "--help") ? 1 : 0;
+		}
+	}
+	if (settings.samples < 1) {
+		settings.samples = 1;
+	}
+
+#if defined(EW_MATH_AVX)
+	printf("ewMath backend: AVX\n");
+#elif defined(EW_MATH_SSE)
+	printf("ewMath backend: SSE\n");
+#else
+	printf("ewMath backend: scalar\n");
+#endif
+
+	BenchData data;
+	std::vector<bench::Benchmark> benchmarks = createBenchmarks(data);
+	std::vector<bench::Result> results = bench::run(benchmarks, settings);
+	bench::printTable(results);
+
+	if (!jsonPath.empty()) {
+		bench::writeJson(jsonPath, results);
+	}
+	if (!comparePath.empty()) {
+		std::vector<bench::Result> baseline;
+		if (!bench::readJson(comparePath, &baseline)) {
+			return 1;
+		}
+		int regressions = bench::compare(baseline, results, threshold);
+		printf("%d regression(s) over %.0f%%\n", regressions, threshold * 100.0);
+		return regressions > 0 ? 1 : 0;
+	}
+	return 0;
+}
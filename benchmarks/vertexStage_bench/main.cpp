@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <chrono>
+#include <algorithm>
+
+#include <ew/external/glad.h>
+#include <ew/ewMath/ewMath.h>
+#include <ew/ewMath/transformations.h>
+#include <GLFW/glfw3.h>
+
+#include <ew/shader.h>
+#include <ew/mesh.h>
+#include <ew/procGen.h>
+
+//Both shaders output the normal, so the compiler can't drop its computation
+const char* PER_VERTEX_SHADER = R"(#version 450
+layout(location = 0) in vec3 vPos;
+layout(location = 1) in vec3 vNormal;
+uniform mat4 _Model;
+uniform mat4 _ViewProjection;
+out vec3 Normal;
+void main(){
+	Normal = transpose(inverse(mat3(_Model))) * vNormal;
+	gl_Position = _ViewProjection * _Model * vec4(vPos, 1.0);
+}
+)";
+
+const char* UNIFORM_SHADER = R"(#version 450
+layout(location = 0) in vec3 vPos;
+layout(location = 1) in vec3 vNormal;
+uniform mat4 _Model;
+uniform mat4 _ViewProjection;
+uniform mat3 _NormalMatrix;
+out vec3 Normal;
+void main(){
+	Normal = _NormalMatrix * vNormal;
+	gl_Position = _ViewProjection * _Model * vec4(vPos, 1.0);
+}
+)";
+
+const char* FRAGMENT_SHADER = R"(#version 450
+in vec3 Normal;
+out vec4 FragColor;
+void main(){
+	FragColor = vec4(normalize(Normal) * 0.5 + 0.5, 1.0);
+}
+)";
+
+const int NUM_DRAWS = 50; //Per sample
+const int NUM_SAMPLES = 10;
+
+/// <summary>
+/// Milliseconds per draw, the fastest of NUM_SAMPLES. glFinish brackets each sample so the GPU (or driver thread) work is counted
+/// </summary>
+static double timeDraws(unsigned int program, const ew::Mesh& mesh, bool normalMatrixUniform)
+{
+	ew::Mat4 model = ew::Translate(ew::Vec3(0.1f, 0.0f, 0.0f)) * ew::RotateY(0.5f) * ew::Scale(ew::Vec3(1.0f, 2.0f, 0.5f));
+	ew::Mat4 viewProjection = ew::Identity();
+	glUseProgram(program);
+	glUniformMatrix4fv(glGetUniformLocation(program, "_Model"), 1, GL_FALSE, &model[0][0]);
+	glUniformMatrix4fv(glGetUniformLocation(program, "_ViewProjection"), 1, GL_FALSE, &viewProjection[0][0]);
+	if (normalMatrixUniform) {
+		ew::Mat3 normalMatrix = ew::NormalMatrix(model);
+		glUniformMatrix3fv(glGetUniformLocation(program, "_NormalMatrix"), 1, GL_FALSE, &normalMatrix[0].x);
+	}
+	//Warm up, the first draw may compile the driver's vertex pipeline
+	mesh.draw();
+	glFinish();
+
+	double best = 1e30;
+	for (int sample = 0; sample < NUM_SAMPLES; sample++) {
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < NUM_DRAWS; i++) {
+			mesh.draw();
+		}
+		glFinish();
+		auto end = std::chrono::high_resolution_clock::now();
+		best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count() / NUM_DRAWS);
+	}
+	return best;
+}
+
+int main() {
+	if (!glfwInit()) {
+		printf("GLFW failed to init!");
+		return 1;
+	}
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	GLFWwindow* window = glfwCreateWindow(64, 64, "Vertex stage benchmark", NULL, NULL);
+	if (window == NULL) {
+		printf("GLFW failed to create window");
+		return 1;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGL(glfwGetProcAddress)) {
+		printf("GLAD Failed to load GL headers");
+		return 1;
+	}
+	printf("Renderer: %s\n", (const char*)glGetString(GL_RENDERER));
+	printf("Run with LIBGL_ALWAYS_SOFTWARE=1 to measure a software driver\n\n");
+
+	//A single pixel keeps rasterization and fragment shading out of the timings
+	glViewport(0, 0, 1, 1);
+	glDisable(GL_CULL_FACE);
+
+	unsigned int perVertexProgram = ew::createShaderProgram(PER_VERTEX_SHADER, FRAGMENT_SHADER);
+	unsigned int uniformProgram = ew::createShaderProgram(UNIFORM_SHADER, FRAGMENT_SHADER);
+
+	printf("%-10s %10s %22s %22s %8s\n", "sphere", "vertices", "per vertex ms (ns/v)", "uniform ms (ns/v)", "speedup");
+	int subdivisions[] = { 64, 256, 512 };
+	for (int subdivision : subdivisions) {
+		ew::MeshData sphereData = ew::createSphere(0.5f, subdivision);
+		ew::Mesh sphere(sphereData);
+		//Vertices are shaded once per index at worst, but the post transform cache makes the unique count the better measure
+		double numVertices = (double)sphereData.vertices.size();
+		double perVertexMs = timeDraws(perVertexProgram, sphere, false);
+		double uniformMs = timeDraws(uniformProgram, sphere, true);
+		printf("%-10d %10zu %12.3f (%7.2f) %12.3f (%7.2f) %7.2fx\n", subdivision, sphereData.vertices.size(),
+			perVertexMs, perVertexMs * 1e6 / numVertices,
+			uniformMs, uniformMs * 1e6 / numVertices,
+			perVertexMs / uniformMs);
+	}
+
+	glDeleteProgram(perVertexProgram);
+	glDeleteProgram(uniformProgram);
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return 0;
+}
@@ -0,0 +1,588 @@
+#include "bvh.h"
+#include <math.h>
+#include <memory>
+#include <thread>
+#include <algorithm>
+#include <numeric>
+
+namespace ew {
+	const unsigned int SAH_BINS = 16;
+	const float TRAVERSAL_COST = 1.0f;
+	const float INTERSECTION_COST = 1.0f;
+	//Ranges with fewer primitives than this are built on the calling thread
+	const unsigned int MIN_PARALLEL_PRIMITIVES = 4096;
+	//Deeper ranges become leaves, so traversal stacks can be fixed size
+	const unsigned int MAX_DEPTH = 60;
+	const unsigned int MESH_LEAF_SIZE = 4;
+	const unsigned int SCENE_LEAF_SIZE = 2;
+
+	Ray ScreenPointToRay(const Camera& camera, float cursorX, float cursorY, float screenWidth, float screenHeight)
+	{
+		//Cursor to NDC, y points up
+		float x = cursorX / screenWidth * 2.0f - 1.0f;
+		float y = 1.0f - cursorY / screenHeight * 2.0f;
+		ew::Mat4 inverseViewProjection = ew::Inverse(camera.ProjectionMatrix() * camera.ViewMatrix());
+		ew::Vec4 nearPoint = inverseViewProjection * ew::Vec4(x, y, -1.0f, 1.0f);
+		ew::Vec4 farPoint = inverseViewProjection * ew::Vec4(x, y, 1.0f, 1.0f);
+		Ray ray;
+		ray.origin = nearPoint.toVec3() / nearPoint.w;
+		ray.direction = ew::Normalize(farPoint.toVec3() / farPoint.w - ray.origin);
+		return ray;
+	}
+
+	static inline ew::AABB emptyBox()
+	{
+		ew::AABB box;
+		box.min = ew::Vec3(FLT_MAX);
+		box.max = ew::Vec3(-FLT_MAX);
+		return box;
+	}
+
+	static inline void growBox(ew::AABB* box, const ew::Vec3& min, const ew::Vec3& max)
+	{
+		box->min = ew::Vec3(std::min(box->min.x, min.x), std::min(box->min.y, min.y), std::min(box->min.z, min.z));
+		box->max = ew::Vec3(std::max(box->max.x, max.x), std::max(box->max.y, max.y), std::max(box->max.z, max.z));
+	}
+
+	static inline float surfaceArea(const ew::AABB& box)
+	{
+		ew::Vec3 d = box.max - box.min;
+		if (d.x < 0.0f)
+			return 0.0f;
+		return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+	}
+
+	static inline float component(const ew::Vec3& v, int axis)
+	{
+		return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+	}
+
+	struct BuildNode {
+		ew::AABB bounds;
+		unsigned int first = 0;
+		unsigned int count = 0;
+		std::unique_ptr<BuildNode> left, right;
+	};
+
+	struct BuildInput {
+		const ew::AABB* boxes;
+		const ew::Vec3* centroids;
+		unsigned int* order; //Partitioned in place, ends up in leaf order
+		unsigned int maxLeafSize;
+	};
+
+	/// <summary>
+	/// Binned SAH: centroids are sorted into SAH_BINS bins per axis, and the cheapest of the planes between
+	/// bins is used. Ranges that cost less as a leaf stay one. The two halves are built in parallel
+	/// while parallelDepth allows it, each thread working on its own part of order
+	/// </summary>
+	static std::unique_ptr<BuildNode> buildRange(const BuildInput& input, unsigned int first, unsigned int count, unsigned int depth, unsigned int parallelDepth)
+	{
+		std::unique_ptr<BuildNode> node(new BuildNode());
+		node->first = first;
+		node->count = count;
+		ew::AABB bounds = emptyBox(), centroidBounds = emptyBox();
+		for (unsigned int i = first; i < first + count; i++) {
+			const ew::AABB& box = input.boxes[input.order[i]];
+			growBox(&bounds, box.min, box.max);
+			growBox(&centroidBounds, input.centroids[input.order[i]], input.centroids[input.order[i]]);
+		}
+		node->bounds = bounds;
+		if (count <= 1 || depth >= MAX_DEPTH)
+			return node;
+
+		int bestAxis = -1;
+		unsigned int bestSplit = 0;
+		float bestCost = FLT_MAX, bestLow = 0.0f, bestScale = 0.0f;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float low = component(centroidBounds.min, axis);
+			float high = component(centroidBounds.max, axis);
+			if (high <= low)
+				continue;
+			float scale = SAH_BINS / (high - low);
+			unsigned int binCounts[SAH_BINS] = {};
+			ew::AABB binBoxes[SAH_BINS];
+			for (ew::AABB& box : binBoxes) {
+				box = emptyBox();
+			}
+			for (unsigned int i = first; i < first + count; i++) {
+				unsigned int p = input.order[i];
+				unsigned int bin = std::min((unsigned int)((component(input.centroids[p], axis) - low) * scale), SAH_BINS - 1);
+				binCounts[bin]++;
+				growBox(&binBoxes[bin], input.boxes[p].min, input.boxes[p].max);
+			}
+			//Sweep from the left, then evaluate every plane sweeping from the right
+			float leftAreas[SAH_BINS - 1];
+			unsigned int leftCounts[SAH_BINS - 1];
+			ew::AABB accumulated = emptyBox();
+			unsigned int accumulatedCount = 0;
+			for (unsigned int b = 0; b < SAH_BINS - 1; b++) {
+				growBox(&accumulated, binBoxes[b].min, binBoxes[b].max);
+				accumulatedCount += binCounts[b];
+				leftAreas[b] = surfaceArea(accumulated);
+				leftCounts[b] = accumulatedCount;
+			}
+			accumulated = emptyBox();
+			accumulatedCount = 0;
+			for (unsigned int b = SAH_BINS - 1; b > 0; b--) {
+				growBox(&accumulated, binBoxes[b].min, binBoxes[b].max);
+				accumulatedCount += binCounts[b];
+				if (leftCounts[b - 1] == 0 || accumulatedCount == 0)
+					continue;
+				float cost = leftAreas[b - 1] * leftCounts[b - 1] + surfaceArea(accumulated) * accumulatedCount;
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = b;
+					bestLow = low;
+					bestScale = scale;
+				}
+			}
+		}
+
+		unsigned int middle;
+		if (bestAxis >= 0) {
+			float area = surfaceArea(bounds);
+			float splitCost = TRAVERSAL_COST + INTERSECTION_COST * (area > 0.0f ? bestCost / area : 0.0f);
+			if (splitCost >= INTERSECTION_COST * count && count <= input.maxLeafSize)
+				return node;
+			unsigned int* split = std::partition(input.order + first, input.order + first + count, [&](unsigned int p) {
+				return std::min((unsigned int)((component(input.centroids[p], bestAxis) - bestLow) * bestScale), SAH_BINS - 1) < bestSplit;
+			});
+			middle = (unsigned int)(split - input.order);
+		}
+		else {
+			//Every centroid is the same point, there is nothing to split by
+			if (count <= input.maxLeafSize)
+				return node;
+			middle = first + count / 2;
+		}
+
+		node->count = 0;
+		if (parallelDepth > 0 && count >= MIN_PARALLEL_PRIMITIVES) {
+			std::thread worker([&]() {
+				node->left = buildRange(input, first, middle - first, depth + 1, parallelDepth - 1);
+			});
+			node->right = buildRange(input, middle, first + count - middle, depth + 1, parallelDepth - 1);
+			worker.join();
+		}
+		else {
+			node->left = buildRange(input, first, middle - first, depth + 1, 0);
+			node->right = buildRange(input, middle, first + count - middle, depth + 1, 0);
+		}
+		return node;
+	}
+
+	//Depth first, so a left child always directly follows its parent
+	static void flatten(const BuildNode* node, std::vector<BVHNode>* nodes)
+	{
+		size_t index = nodes->size();
+		BVHNode flat;
+		flat.min = node->bounds.min;
+		flat.max = node->bounds.max;
+		flat.offset = node->first;
+		flat.count = node->count;
+		nodes->push_back(flat);
+		if (node->count > 0)
+			return;
+		flatten(node->left.get(), nodes);
+		(*nodes)[index].offset = (unsigned int)nodes->size();
+		flatten(node->right.get(), nodes);
+	}
+
+	static void buildHierarchy(const std::vector<ew::AABB>& boxes, const std::vector<ew::Vec3>& centroids, unsigned int numThreads, unsigned int maxLeafSize,
+		std::vector<BVHNode>* nodes, std::vector<unsigned int>* order)
+	{
+		nodes->clear();
+		order->resize(boxes.size());
+		std::iota(order->begin(), order->end(), 0u);
+		if (boxes.empty())
+			return;
+		unsigned int parallelDepth = 0;
+		while ((1u << parallelDepth) < numThreads)
+			parallelDepth++;
+		BuildInput input = { boxes.data(), centroids.data(), order->data(), maxLeafSize };
+		std::unique_ptr<BuildNode> root = buildRange(input, 0, (unsigned int)boxes.size(), 0, parallelDepth);
+		nodes->reserve(boxes.size() * 2);
+		flatten(root.get(), nodes);
+	}
+
+	//Axis aligned directions get a huge finite inverse, 0 * inf would make the slab test NaN for origins on a box face
+	static inline float safeInverse(float d)
+	{
+		return fabsf(d) > 1e-20f ? 1.0f / d : (d < 0.0f ? -1e20f : 1e20f);
+	}
+
+	static inline bool intersectBox(const BVHNode& node, const ew::Vec3& origin, const ew::Vec3& inverseDirection, float maxDistance, float* entry)
+	{
+		float tx1 = (node.min.x - origin.x) * inverseDirection.x, tx2 = (node.max.x - origin.x) * inverseDirection.x;
+		float ty1 = (node.min.y - origin.y) * inverseDirection.y, ty2 = (node.max.y - origin.y) * inverseDirection.y;
+		float tz1 = (node.min.z - origin.z) * inverseDirection.z, tz2 = (node.max.z - origin.z) * inverseDirection.z;
+		float tMin = std::max(std::max(std::min(tx1, tx2), std::min(ty1, ty2)), std::min(tz1, tz2));
+		float tMax = std::min(std::min(std::max(tx1, tx2), std::max(ty1, ty2)), std::max(tz1, tz2));
+		*entry = tMin;
+		return tMax >= tMin && tMax >= 0.0f && tMin < maxDistance;
+	}
+
+	//Moller-Trumbore, both faces
+	static inline bool intersectTriangle(const ew::Vec3& v0, const ew::Vec3& edge1, const ew::Vec3& edge2, const Ray& ray, float maxDistance,
+		float* distance, float* u, float* v)
+	{
+		ew::Vec3 p = ew::Cross(ray.direction, edge2);
+		float det = ew::Dot(edge1, p);
+		if (det == 0.0f)
+			return false;
+		float inverseDet = 1.0f / det;
+		ew::Vec3 s = ray.origin - v0;
+		*u = ew::Dot(s, p) * inverseDet;
+		if (*u < 0.0f || *u > 1.0f)
+			return false;
+		ew::Vec3 q = ew::Cross(s, edge1);
+		*v = ew::Dot(ray.direction, q) * inverseDet;
+		if (*v < 0.0f || *u + *v > 1.0f)
+			return false;
+		*distance = ew::Dot(edge2, q) * inverseDet;
+		return *distance > 0.0f && *distance < maxDistance;
+	}
+
+	/// <summary>
+	/// Closest first traversal shared by both hierarchies. The nearer child is visited first and the other one
+	/// is pushed with its entry distance, so it is skipped if a closer hit has been found by the time it is popped.
+	/// intersectLeaf(node) tests a leaf's primitives against hit->distance and returns true if it updated hit
+	/// </summary>
+	template<typename LeafFn>
+	static bool traverse(const std::vector<BVHNode>& nodes, const Ray& ray, RayHit* hit, LeafFn intersectLeaf)
+	{
+		if (nodes.empty())
+			return false;
+		const ew::Vec3 inverseDirection = ew::Vec3(safeInverse(ray.direction.x), safeInverse(ray.direction.y), safeInverse(ray.direction.z));
+		float entry;
+		if (!intersectBox(nodes[0], ray.origin, inverseDirection, hit->distance, &entry))
+			return false;
+		struct StackEntry { unsigned int node; float entry; };
+		StackEntry stack[MAX_DEPTH + 1];
+		int stackSize = 0;
+		unsigned int nodeIndex = 0;
+		bool found = false;
+		while (true)
+		{
+			const BVHNode& node = nodes[nodeIndex];
+			if (node.count > 0) {
+				found |= intersectLeaf(node);
+			}
+			else {
+				unsigned int near = nodeIndex + 1, far = node.offset;
+				float nearEntry, farEntry;
+				bool hitNear = intersectBox(nodes[near], ray.origin, inverseDirection, hit->distance, &nearEntry);
+				bool hitFar = intersectBox(nodes[far], ray.origin, inverseDirection, hit->distance, &farEntry);
+				if (hitNear && hitFar) {
+					if (farEntry < nearEntry) {
+						std::swap(near, far);
+						std::swap(nearEntry, farEntry);
+					}
+					stack[stackSize++] = { far, farEntry };
+					nodeIndex = near;
+					continue;
+				}
+				if (hitNear || hitFar) {
+					nodeIndex = hitNear ? near : far;
+					continue;
+				}
+			}
+			//Next pushed node that can still hold a closer hit
+			do {
+				if (stackSize == 0)
+					return found;
+				stackSize--;
+			} while (stack[stackSize].entry >= hit->distance);
+			nodeIndex = stack[stackSize].node;
+		}
+	}
+
+	MeshBVH::MeshBVH(const MeshData& meshData, unsigned int numThreads)
+	{
+		build(meshData, numThreads);
+	}
+
+	void MeshBVH::build(const MeshData& meshData, unsigned int numThreads)
+	{
+		if (numThreads == 0)
+			numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		const size_t numTriangles = meshData.indices.size() / 3;
+		std::vector<ew::AABB> boxes(numTriangles);
+		std::vector<ew::Vec3> centroids(numTriangles);
+		for (size_t t = 0; t < numTriangles; t++) {
+			const ew::Vec3& p0 = meshData.vertices[meshData.indices[t * 3]].pos;
+			const ew::Vec3& p1 = meshData.vertices[meshData.indices[t * 3 + 1]].pos;
+			const ew::Vec3& p2 = meshData.vertices[meshData.indices[t * 3 + 2]].pos;
+			boxes[t].min = ew::Vec3(std::min({ p0.x, p1.x, p2.x }), std::min({ p0.y, p1.y, p2.y }), std::min({ p0.z, p1.z, p2.z }));
+			boxes[t].max = ew::Vec3(std::max({ p0.x, p1.x, p2.x }), std::max({ p0.y, p1.y, p2.y }), std::max({ p0.z, p1.z, p2.z }));
+			centroids[t] = boxes[t].center();
+		}
+		buildHierarchy(boxes, centroids, numThreads, MESH_LEAF_SIZE, &m_nodes, &m_triangleIds);
+
+		m_triangles.resize(numTriangles);
+		for (size_t i = 0; i < numTriangles; i++) {
+			const unsigned int* tri = &meshData.indices[m_triangleIds[i] * 3];
+			const ew::Vec3& p0 = meshData.vertices[tri[0]].pos;
+			m_triangles[i].v0 = p0;
+			m_triangles[i].edge1 = meshData.vertices[tri[1]].pos - p0;
+			m_triangles[i].edge2 = meshData.vertices[tri[2]].pos - p0;
+		}
+	}
+
+	ew::AABB MeshBVH::getBounds() const
+	{
+		ew::AABB box;
+		if (!m_nodes.empty()) {
+			box.min = m_nodes[0].min;
+			box.max = m_nodes[0].max;
+		}
+		return box;
+	}
+
+	bool MeshBVH::intersect(const Ray& ray, RayHit* hit) const
+	{
+		return traverse(m_nodes, ray, hit, [&](const BVHNode& leaf) {
+			bool found = false;
+			for (unsigned int i = leaf.offset; i < leaf.offset + leaf.count; i++) {
+				const Triangle& tri = m_triangles[i];
+				float distance, u, v;
+				if (intersectTriangle(tri.v0, tri.edge1, tri.edge2, ray, hit->distance, &distance, &u, &v)) {
+					hit->distance = distance;
+					hit->triangle = m_triangleIds[i];
+					hit->u = u;
+					hit->v = v;
+					found = true;
+				}
+			}
+			return found;
+		});
+	}
+
+	void MeshBVH::intersect(const Ray* rays, RayHit* hits, size_t count) const
+	{
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			intersectPacket(&rays[i], &hits[i]);
+		}
+		for (; i < count; i++) {
+			intersect(rays[i], &hits[i]);
+		}
+	}
+
+#if defined(EW_MATH_SSE)
+	//Bit per ray that enters the node before its current closest hit
+	static inline int intersectBox4(const BVHNode& node, const __m128 origin[3], const __m128 inverseDirection[3], __m128 maxDistance, __m128* entry)
+	{
+		const float nodeMin[3] = { node.min.x, node.min.y, node.min.z };
+		const float nodeMax[3] = { node.max.x, node.max.y, node.max.z };
+		__m128 tMin = _mm_setzero_ps();
+		__m128 tMax = maxDistance;
+		for (int axis = 0; axis < 3; axis++) {
+			__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(nodeMin[axis]), origin[axis]), inverseDirection[axis]);
+			__m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(nodeMax[axis]), origin[axis]), inverseDirection[axis]);
+			tMin = _mm_max_ps(tMin, _mm_min_ps(t1, t2));
+			tMax = _mm_min_ps(tMax, _mm_max_ps(t1, t2));
+		}
+		*entry = tMin;
+		return _mm_movemask_ps(_mm_cmple_ps(tMin, tMax));
+	}
+
+	static inline __m128 select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	//Smallest entry distance of the active rays
+	static inline float nearestEntry(__m128 entry, int mask)
+	{
+		float entries[4];
+		_mm_storeu_ps(entries, entry);
+		float nearest = FLT_MAX;
+		for (int k = 0; k < 4; k++) {
+			if (mask & (1 << k))
+				nearest = fminf(nearest, entries[k]);
+		}
+		return nearest;
+	}
+#endif
+
+	/// <summary>
+	/// 4 rays in SSE lanes walk the tree together. A node is visited if any of them enters it,
+	/// and every triangle test covers all 4 rays at once
+	/// </summary>
+	void MeshBVH::intersectPacket(const Ray* rays, RayHit* hits) const
+	{
+#if defined(EW_MATH_SSE)
+		if (m_nodes.empty())
+			return;
+		__m128 origin[3], direction[3], inverseDirection[3];
+		origin[0] = _mm_setr_ps(rays[0].origin.x, rays[1].origin.x, rays[2].origin.x, rays[3].origin.x);
+		origin[1] = _mm_setr_ps(rays[0].origin.y, rays[1].origin.y, rays[2].origin.y, rays[3].origin.y);
+		origin[2] = _mm_setr_ps(rays[0].origin.z, rays[1].origin.z, rays[2].origin.z, rays[3].origin.z);
+		direction[0] = _mm_setr_ps(rays[0].direction.x, rays[1].direction.x, rays[2].direction.x, rays[3].direction.x);
+		direction[1] = _mm_setr_ps(rays[0].direction.y, rays[1].direction.y, rays[2].direction.y, rays[3].direction.y);
+		direction[2] = _mm_setr_ps(rays[0].direction.z, rays[1].direction.z, rays[2].direction.z, rays[3].direction.z);
+		inverseDirection[0] = _mm_setr_ps(safeInverse(rays[0].direction.x), safeInverse(rays[1].direction.x), safeInverse(rays[2].direction.x), safeInverse(rays[3].direction.x));
+		inverseDirection[1] = _mm_setr_ps(safeInverse(rays[0].direction.y), safeInverse(rays[1].direction.y), safeInverse(rays[2].direction.y), safeInverse(rays[3].direction.y));
+		inverseDirection[2] = _mm_setr_ps(safeInverse(rays[0].direction.z), safeInverse(rays[1].direction.z), safeInverse(rays[2].direction.z), safeInverse(rays[3].direction.z));
+		__m128 closest = _mm_setr_ps(hits[0].distance, hits[1].distance, hits[2].distance, hits[3].distance);
+		__m128 closestU = _mm_setzero_ps(), closestV = _mm_setzero_ps();
+		__m128 closestTriangle = _mm_castsi128_ps(_mm_set1_epi32(-1)); //Leaf order index
+		const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+
+		__m128 entry;
+		if (!intersectBox4(m_nodes[0], origin, inverseDirection, closest, &entry))
+			return;
+		unsigned int stack[MAX_DEPTH + 1];
+		int stackSize = 0;
+		unsigned int nodeIndex = 0;
+		while (true)
+		{
+			const BVHNode& node = m_nodes[nodeIndex];
+			if (node.count > 0) {
+				for (unsigned int i = node.offset; i < node.offset + node.count; i++) {
+					const Triangle& tri = m_triangles[i];
+					__m128 e1x = _mm_set1_ps(tri.edge1.x), e1y = _mm_set1_ps(tri.edge1.y), e1z = _mm_set1_ps(tri.edge1.z);
+					__m128 e2x = _mm_set1_ps(tri.edge2.x), e2y = _mm_set1_ps(tri.edge2.y), e2z = _mm_set1_ps(tri.edge2.z);
+					__m128 px = _mm_sub_ps(_mm_mul_ps(direction[1], e2z), _mm_mul_ps(direction[2], e2y));
+					__m128 py = _mm_sub_ps(_mm_mul_ps(direction[2], e2x), _mm_mul_ps(direction[0], e2z));
+					__m128 pz = _mm_sub_ps(_mm_mul_ps(direction[0], e2y), _mm_mul_ps(direction[1], e2x));
+					__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+					__m128 inverseDet = _mm_div_ps(one, det);
+					__m128 sx = _mm_sub_ps(origin[0], _mm_set1_ps(tri.v0.x));
+					__m128 sy = _mm_sub_ps(origin[1], _mm_set1_ps(tri.v0.y));
+					__m128 sz = _mm_sub_ps(origin[2], _mm_set1_ps(tri.v0.z));
+					__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inverseDet);
+					__m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+					__m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+					__m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+					__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(direction[0], qx), _mm_mul_ps(direction[1], qy)), _mm_mul_ps(direction[2], qz)), inverseDet);
+					__m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverseDet);
+					//Comparisons with NaN from det == 0 are false
+					__m128 mask = _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmpge_ps(v, zero));
+					mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+					mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpgt_ps(t, zero), _mm_cmplt_ps(t, closest)));
+					if (_mm_movemask_ps(mask) == 0)
+						continue;
+					closest = select(mask, t, closest);
+					closestU = select(mask, u, closestU);
+					closestV = select(mask, v, closestV);
+					closestTriangle = select(mask, _mm_castsi128_ps(_mm_set1_epi32((int)i)), closestTriangle);
+				}
+			}
+			else {
+				unsigned int near = nodeIndex + 1, far = node.offset;
+				__m128 nearEntries, farEntries;
+				int nearMask = intersectBox4(m_nodes[near], origin, inverseDirection, closest, &nearEntries);
+				int farMask = intersectBox4(m_nodes[far], origin, inverseDirection, closest, &farEntries);
+				if (nearMask && farMask) {
+					if (nearestEntry(farEntries, farMask) < nearestEntry(nearEntries, nearMask))
+						std::swap(near, far);
+					stack[stackSize++] = far;
+					nodeIndex = near;
+					continue;
+				}
+				if (nearMask || farMask) {
+					nodeIndex = nearMask ? near : far;
+					continue;
+				}
+			}
+			//Pushed nodes are tested again, the rays may have found closer hits since
+			bool next = false;
+			while (stackSize > 0 && !next) {
+				nodeIndex = stack[--stackSize];
+				next = intersectBox4(m_nodes[nodeIndex], origin, inverseDirection, closest, &entry) != 0;
+			}
+			if (!next)
+				break;
+		}
+
+		float distances[4], us[4], vs[4];
+		int triangles[4];
+		_mm_storeu_ps(distances, closest);
+		_mm_storeu_ps(us, closestU);
+		_mm_storeu_ps(vs, closestV);
+		_mm_storeu_si128((__m128i*)triangles, _mm_castps_si128(closestTriangle));
+		for (int k = 0; k < 4; k++) {
+			if (triangles[k] < 0)
+				continue;
+			hits[k].distance = distances[k];
+			hits[k].triangle = m_triangleIds[triangles[k]];
+			hits[k].u = us[k];
+			hits[k].v = vs[k];
+		}
+#else
+		for (int k = 0; k < 4; k++) {
+			intersect(rays[k], &hits[k]);
+		}
+#endif
+	}
+
+	unsigned int SceneBVH::add(const MeshBVH* bvh, const ew::Transform& transform)
+	{
+		return add(bvh, transform.getModelMatrix());
+	}
+
+	unsigned int SceneBVH::add(const MeshBVH* bvh, const ew::Mat4& model)
+	{
+		Instance instance;
+		instance.bvh = bvh;
+		m_instances.push_back(instance);
+		setTransform((unsigned int)m_instances.size() - 1, model);
+		return (unsigned int)m_instances.size() - 1;
+	}
+
+	void SceneBVH::setTransform(unsigned int instance, const ew::Transform& transform)
+	{
+		setTransform(instance, transform.getModelMatrix());
+	}
+
+	void SceneBVH::setTransform(unsigned int instance, const ew::Mat4& model)
+	{
+		m_instances[instance].model = model;
+		m_instances[instance].inverseModel = ew::Inverse(model);
+	}
+
+	void SceneBVH::clear()
+	{
+		m_instances.clear();
+		m_nodes.clear();
+		m_instanceOrder.clear();
+	}
+
+	void SceneBVH::build()
+	{
+		std::vector<ew::AABB> boxes(m_instances.size());
+		std::vector<ew::Vec3> centroids(m_instances.size());
+		for (size_t i = 0; i < m_instances.size(); i++) {
+			boxes[i] = ew::TransformAABB(m_instances[i].bvh->getBounds(), m_instances[i].model);
+			centroids[i] = boxes[i].center();
+		}
+		buildHierarchy(boxes, centroids, 1, SCENE_LEAF_SIZE, &m_nodes, &m_instanceOrder);
+	}
+
+	/// <summary>
+	/// The ray is moved into each instance's object space without renormalizing the direction,
+	/// so distances along it are the same in both spaces
+	/// </summary>
+	bool SceneBVH::intersect(const Ray& ray, RayHit* hit) const
+	{
+		return traverse(m_nodes, ray, hit, [&](const BVHNode& leaf) {
+			bool found = false;
+			for (unsigned int i = leaf.offset; i < leaf.offset + leaf.count; i++) {
+				const Instance& instance = m_instances[m_instanceOrder[i]];
+				Ray localRay;
+				localRay.origin = (instance.inverseModel * ew::Vec4(ray.origin, 1.0f)).toVec3();
+				localRay.direction = (instance.inverseModel * ew::Vec4(ray.direction, 0.0f)).toVec3();
+				if (instance.bvh->intersect(localRay, hit)) {
+					hit->instance = m_instanceOrder[i];
+					found = true;
+				}
+			}
+			return found;
+		});
+	}
+}
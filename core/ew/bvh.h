@@ -0,0 +1,96 @@
+#pragma once
+#include <vector>
+#include <float.h>
+#include "mesh.h"
+#include "camera.h"
+#include "transform.h"
+#include "ewMath/bounds.h"
+
+namespace ew {
+	struct Ray {
+		ew::Vec3 origin = ew::Vec3(0.0f);
+		ew::Vec3 direction = ew::Vec3(0.0f, 0.0f, -1.0f); //Does not need to be normalized, distances are in multiples of its length
+	};
+
+	const unsigned int INVALID_HIT = 0xffffffff;
+
+	struct RayHit {
+		float distance = FLT_MAX; //Only hits closer than this are reported
+		unsigned int triangle = INVALID_HIT; //Index into MeshData::indices / 3
+		unsigned int instance = INVALID_HIT; //SceneBVH only
+		float u = 0, v = 0; //Barycentric weights of the triangle's second and third vertex
+		inline bool hit()const { return triangle != INVALID_HIT; }
+	};
+
+	//World space ray from the camera through a cursor position in pixels, (0,0) being the top left corner. Starts on the near plane
+	Ray ScreenPointToRay(const Camera& camera, float cursorX, float cursorY, float screenWidth, float screenHeight);
+
+	//Flattened hierarchy node, 32 bytes. An interior node's left child directly follows it
+	struct BVHNode {
+		ew::Vec3 min;
+		unsigned int offset = 0; //Leaf: first primitive. Interior: index of the right child
+		ew::Vec3 max;
+		unsigned int count = 0; //Primitives in a leaf, 0 for interior nodes
+	};
+
+	/// <summary>
+	/// Bounding volume hierarchy over a mesh's triangles, built with binned SAH.
+	/// Subtrees are built on separate threads, then flattened depth first into one node array.
+	/// Triangles are copied in leaf order, so the MeshData is not needed after building
+	/// </summary>
+	class MeshBVH {
+	public:
+		MeshBVH() {};
+		MeshBVH(const MeshData& meshData, unsigned int numThreads = 0);
+		//numThreads 0 uses every hardware thread
+		void build(const MeshData& meshData, unsigned int numThreads = 0);
+		//Closest hit nearer than hit->distance, in the mesh's object space. Returns true if hit was updated
+		bool intersect(const Ray& ray, RayHit* hit)const;
+		/// <summary>
+		/// Closest hits of many rays, each limited by its hit's distance. Rays are traced in packets of 4
+		/// sharing one traversal, which is much cheaper for coherent rays such as neighbouring pixels
+		/// </summary>
+		void intersect(const Ray* rays, RayHit* hits, size_t count)const;
+		inline const std::vector<BVHNode>& getNodes()const { return m_nodes; }
+		inline size_t getNumTriangles()const { return m_triangleIds.size(); }
+		ew::AABB getBounds()const;
+	private:
+		struct Triangle {
+			ew::Vec3 v0, edge1, edge2;
+		};
+		void intersectPacket(const Ray* rays, RayHit* hits)const;
+		std::vector<BVHNode> m_nodes;
+		std::vector<Triangle> m_triangles; //Leaf order
+		std::vector<unsigned int> m_triangleIds; //Leaf order -> mesh triangle
+	};
+
+	/// <summary>
+	/// Top level hierarchy over placed MeshBVHs. Rays are moved into each instance's object space,
+	/// so one MeshBVH can be shared by any number of instances
+	/// </summary>
+	class SceneBVH {
+	public:
+		SceneBVH() {};
+		//Returns the instance index reported in RayHit::instance. The MeshBVH must outlive the scene
+		unsigned int add(const MeshBVH* bvh, const ew::Transform& transform);
+		unsigned int add(const MeshBVH* bvh, const ew::Mat4& model);
+		//Takes effect on the next build
+		void setTransform(unsigned int instance, const ew::Transform& transform);
+		void setTransform(unsigned int instance, const ew::Mat4& model);
+		void clear();
+		//Rebuilds the hierarchy over every instance's world space bounds. Cheap, call after moving instances
+		void build();
+		//World space closest hit nearer than hit->distance. Returns true if hit was updated
+		bool intersect(const Ray& ray, RayHit* hit)const;
+		inline size_t getNumInstances()const { return m_instances.size(); }
+	private:
+		struct Instance {
+			const MeshBVH* bvh = nullptr;
+			ew::Mat4 model;
+			ew::Mat4 inverseModel;
+		};
+		std::vector<Instance> m_instances;
+		std::vector<BVHNode> m_nodes;
+		std::vector<unsigned int> m_instanceOrder; //Leaf order -> instance
+	};
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "ewMath/ewMath.h"
+#include "ewMath/quat.h"
+
+namespace ew {
+	/// <summary>
+	/// Transform with quaternion rotation and a cached model matrix.
+	/// Setters mark the transform dirty, the matrix is only rebuilt the next time it is read.
+	/// Static objects compose their matrix once.
+	/// </summary>
+	class CachedTransform {
+	public:
+		CachedTransform() {};
+		CachedTransform(const ew::Vec3& position, const ew::Quat& rotation = ew::Quat(), const ew::Vec3& scale = ew::Vec3(1.0f))
+			:m_position(position), m_rotation(rotation), m_scale(scale) {};
+
+		inline const ew::Vec3& getPosition()const { return m_position; }
+		inline const ew::Quat& getRotation()const { return m_rotation; }
+		inline const ew::Vec3& getScale()const { return m_scale; }
+		inline void setPosition(const ew::Vec3& position) { m_position = position; m_dirty = true; }
+		inline void setRotation(const ew::Quat& rotation) { m_rotation = ew::Normalize(rotation); m_dirty = true; }
+		inline void setScale(const ew::Vec3& scale) { m_scale = scale; m_dirty = true; }
+
+		//Euler angles (Degrees), same convention as ew::Transform. For editors
+		inline ew::Vec3 getRotationEuler()const {
+			ew::Vec3 rad = ew::QuatToEuler(m_rotation);
+			return ew::Vec3(ew::Degrees(rad.x), ew::Degrees(rad.y), ew::Degrees(rad.z));
+		}
+		inline void setRotationEuler(const ew::Vec3& degrees) {
+			setRotation(ew::EulerToQuat(ew::Vec3(ew::Radians(degrees.x), ew::Radians(degrees.y), ew::Radians(degrees.z))));
+		}
+
+		inline bool isDirty()const { return m_dirty; }
+
+		//Translate * Rotate * Scale. Pointer stays valid for the lifetime of the transform
+		inline const ew::Mat4* getModelMatrix()const {
+			if (m_dirty)
+				rebuild();
+			return &m_model;
+		}
+		//transpose(inverse(mat3(model)))
+		inline const ew::Mat3* getNormalMatrix()const {
+			if (m_dirty)
+				rebuild();
+			return &m_normal;
+		}
+	private:
+		void rebuild()const {
+			ew::Mat3 r = ew::QuatToMat3(m_rotation);
+			const float s[3] = { m_scale.x, m_scale.y, m_scale.z };
+			for (int c = 0; c < 3; c++) {
+				m_model[c] = ew::Vec4(r[c] * s[c], 0.0f);
+				//Inverse transpose of R*S is R*S^-1
+				m_normal[c] = r[c] * (1.0f / s[c]);
+			}
+			m_model[3] = ew::Vec4(m_position, 1.0f);
+			m_dirty = false;
+		}
+
+		ew::Vec3 m_position = ew::Vec3(0.0f);
+		ew::Quat m_rotation;
+		ew::Vec3 m_scale = ew::Vec3(1.0f);
+		mutable ew::Mat4 m_model;
+		mutable ew::Mat3 m_normal;
+		mutable bool m_dirty = true;
+	};
+}
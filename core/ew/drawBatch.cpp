@@ -0,0 +1,155 @@
+#include "drawBatch.h"
+#include "external/glad.h"
+#include <algorithm>
+
+namespace ew {
+	//Smallest command and instance buffer allocations, in elements
+	const size_t MIN_COMMAND_CAPACITY = 64;
+	const size_t MIN_INSTANCE_CAPACITY = 64;
+
+	//The normal matrix is computed once per draw here, so batched shaders never invert per vertex
+	static BatchInstance makeBatchInstance(const ew::Mat4& model, const ew::Vec4& color)
+	{
+		BatchInstance instance;
+		instance.model = model;
+		instance.color = color;
+		ew::Mat3 normalMatrix = ew::NormalMatrix(model);
+		for (int c = 0; c < 3; c++) {
+			instance.normalMatrix[c] = ew::Vec4(normalMatrix[c], 0.0f);
+		}
+		return instance;
+	}
+
+	DrawBatch::DrawBatch(const MeshPool* meshPool)
+	{
+		m_meshPool = meshPool;
+	}
+
+	void DrawBatch::clear()
+	{
+		m_draws.clear();
+	}
+
+	bool DrawBatch::add(MeshHandle mesh, const ew::Mat4& model, const ew::Vec4& color)
+	{
+		if (!m_meshPool || !m_meshPool->isValid(mesh))
+			return false;
+		m_draws.push_back({ mesh, makeBatchInstance(model, color) });
+		return true;
+	}
+
+	bool DrawBatch::add(MeshHandle mesh, const ew::Mat4* models, size_t count, const ew::Vec4& color)
+	{
+		if (!m_meshPool || !m_meshPool->isValid(mesh))
+			return false;
+		size_t first = m_draws.size();
+		m_draws.resize(first + count);
+		for (size_t i = 0; i < count; i++) {
+			m_draws[first + i].mesh = mesh;
+			m_draws[first + i].instance = makeBatchInstance(models[i], color);
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Draws are sorted by index type, then mesh, so each mesh becomes one command whose instances
+	/// are consecutive in the instance buffer, starting at the command's baseInstance
+	/// </summary>
+	void DrawBatch::upload()
+	{
+		m_commands.clear();
+		m_numShortCommands = 0;
+		m_instances.clear();
+		if (!m_meshPool)
+			return;
+
+		//Bit 63: 32 bit indices, bits 32-62: mesh slot, bits 0-31: draw
+		m_sortKeys.clear();
+		m_sortKeys.reserve(m_draws.size());
+		for (size_t i = 0; i < m_draws.size(); i++) {
+			DrawElementsIndirectCommand command;
+			unsigned int indexType;
+			if (!m_meshPool->getDrawCommand(m_draws[i].mesh, &command, &indexType))
+				continue;
+			unsigned long long key = (unsigned long long)(indexType == GL_UNSIGNED_INT) << 63;
+			key |= (unsigned long long)(m_draws[i].mesh.slot & 0x7fffffff) << 32;
+			m_sortKeys.push_back(key | i);
+		}
+		std::sort(m_sortKeys.begin(), m_sortKeys.end());
+
+		m_instances.resize(m_sortKeys.size());
+		BatchInstance* instances = m_instances.data();
+		unsigned long long previousMesh = ~0ull;
+		for (size_t i = 0; i < m_sortKeys.size(); i++) {
+			const Draw& draw = m_draws[m_sortKeys[i] & 0xffffffff];
+			instances[i] = draw.instance;
+			unsigned long long mesh = m_sortKeys[i] >> 32;
+			if (mesh == previousMesh) {
+				m_commands.back().instanceCount++;
+				continue;
+			}
+			previousMesh = mesh;
+			DrawElementsIndirectCommand command;
+			unsigned int indexType;
+			m_meshPool->getDrawCommand(draw.mesh, &command, &indexType);
+			command.instanceCount = 1;
+			command.baseInstance = (unsigned int)i;
+			m_commands.push_back(command);
+			if (indexType == GL_UNSIGNED_SHORT)
+				m_numShortCommands++;
+		}
+		if (m_commands.empty())
+			return;
+		//Same growth and orphaning as InstanceBuffer
+		if (m_instanceBuffer == 0)
+			glGenBuffers(1, &m_instanceBuffer);
+		if (m_instances.size() > m_instanceCapacity) {
+			m_instanceCapacity = std::max(std::max(m_instances.size(), m_instanceCapacity * 2), MIN_INSTANCE_CAPACITY);
+		}
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, m_instanceCapacity * sizeof(BatchInstance), NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_instances.size() * sizeof(BatchInstance), m_instances.data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		if (m_commandBuffer == 0)
+			glGenBuffers(1, &m_commandBuffer);
+		if (m_commands.size() > m_commandCapacity) {
+			m_commandCapacity = std::max(std::max(m_commands.size(), m_commandCapacity * 2), MIN_COMMAND_CAPACITY);
+		}
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, m_commandCapacity * sizeof(DrawElementsIndirectCommand), NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, m_commands.size() * sizeof(DrawElementsIndirectCommand), m_commands.data());
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	void DrawBatch::draw() const
+	{
+		if (!m_meshPool || m_commands.empty())
+			return;
+		m_meshPool->bind();
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_BATCH_INSTANCE_BINDING, m_instanceBuffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+		const GLsizei numIntCommands = (GLsizei)(m_commands.size() - m_numShortCommands);
+		if (m_numShortCommands > 0) {
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, NULL, (GLsizei)m_numShortCommands, 0);
+		}
+		if (numIntCommands > 0) {
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)(m_numShortCommands * sizeof(DrawElementsIndirectCommand)), numIntCommands, 0);
+		}
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	void DrawBatch::destroy()
+	{
+		if (m_instanceBuffer) {
+			glDeleteBuffers(1, &m_instanceBuffer);
+			m_instanceBuffer = 0;
+		}
+		m_instanceCapacity = 0;
+		if (m_commandBuffer) {
+			glDeleteBuffers(1, &m_commandBuffer);
+			m_commandBuffer = 0;
+		}
+		m_commandCapacity = 0;
+	}
+}
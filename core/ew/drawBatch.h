@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+#include "meshPool.h"
+
+namespace ew {
+	//Shader storage binding of the BatchInstance array read by batched shaders
+	const unsigned int DRAW_BATCH_INSTANCE_BINDING = 0;
+
+	//One element of the batch's shader storage buffer, laid out like the std430 struct { mat4 model; vec4 color; mat3 normalMatrix; }
+	struct BatchInstance {
+		ew::Mat4 model;
+		ew::Vec4 color = ew::Vec4(1.0f);
+		ew::Vec4 normalMatrix[3]; //transpose(inverse(mat3(model))), columns padded to vec4 like a std430 mat3
+	};
+	static_assert(sizeof(BatchInstance) == 128, "BatchInstance must match its std430 layout");
+
+	/// <summary>
+	/// Collects draws of MeshPool meshes and submits all of them with glMultiDrawElementsIndirect,
+	/// one call per index type, however many meshes and objects there are.
+	/// Draws of the same mesh are merged into one instanced command. Each draw's model matrix, normal matrix and color
+	/// go to a shader storage buffer that shaders index with gl_BaseInstance + gl_InstanceID (GLSL 4.60):
+	///
+	/// layout(std430, binding = 0) readonly buffer Instances { BatchInstance instances[]; };
+	/// </summary>
+	class DrawBatch {
+	public:
+		DrawBatch() {};
+		DrawBatch(const MeshPool* meshPool);
+		//The pool must outlive the batch
+		inline void setMeshPool(const MeshPool* meshPool) { m_meshPool = meshPool; }
+		//Starts over, keeping the allocated memory
+		void clear();
+		//Returns false for stale handles
+		bool add(MeshHandle mesh, const ew::Mat4& model, const ew::Vec4& color = ew::Vec4(1.0f));
+		//e.g. TransformArray::modelMatrices()
+		bool add(MeshHandle mesh, const ew::Mat4* models, size_t count, const ew::Vec4& color = ew::Vec4(1.0f));
+		/// <summary>
+		/// Builds the indirect commands and uploads them with the instances. Call after adding the draws,
+		/// and again after MeshPool::add or compact, since those can move meshes
+		/// </summary>
+		void upload();
+		//Binds the pool's VAO and the instance buffer, then issues the uploaded commands
+		void draw()const;
+		void destroy();
+		inline size_t getNumDraws()const { return m_draws.size(); }
+		//Draws left after merging draws of the same mesh
+		inline size_t getNumCommands()const { return m_commands.size(); }
+		//glMultiDrawElementsIndirect calls made by draw(), at most 2
+		inline unsigned int getNumCalls()const { return (m_numShortCommands > 0 ? 1 : 0) + (m_commands.size() > m_numShortCommands ? 1 : 0); }
+	private:
+		struct Draw {
+			MeshHandle mesh;
+			BatchInstance instance;
+		};
+		const MeshPool* m_meshPool = nullptr;
+		std::vector<Draw> m_draws;
+		std::vector<unsigned long long> m_sortKeys;
+		std::vector<DrawElementsIndirectCommand> m_commands; //16 bit index commands first
+		unsigned int m_numShortCommands = 0;
+		std::vector<BatchInstance> m_instances; //Command order
+		unsigned int m_instanceBuffer = 0;
+		size_t m_instanceCapacity = 0;
+		unsigned int m_commandBuffer = 0;
+		size_t m_commandCapacity = 0;
+	};
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <math.h>
+#include "vec3.h"
+#include "vec4.h"
+#include "mat4.h"
+
+namespace ew {
+	//Axis aligned bounding box
+	struct AABB {
+		ew::Vec3 min = ew::Vec3(0.0f);
+		ew::Vec3 max = ew::Vec3(0.0f);
+
+		inline ew::Vec3 center()const { return (min + max) * 0.5f; }
+		inline ew::Vec3 extents()const { return (max - min) * 0.5f; } //Half size
+	};
+
+	struct BoundingSphere {
+		ew::Vec3 center = ew::Vec3(0.0f);
+		float radius = 0.0f;
+	};
+
+	//Length of the longest of m's first three columns
+	inline float MaxAxisScale(const ew::Mat4& m) {
+		float scaleSq = 0.0f;
+		for (int c = 0; c < 3; c++) {
+			float lengthSq = m[c][0] * m[c][0] + m[c][1] * m[c][1] + m[c][2] * m[c][2];
+			scaleSq = lengthSq > scaleSq ? lengthSq : scaleSq;
+		}
+		return sqrtf(scaleSq);
+	}
+
+	//Smallest box containing box transformed by m (Arvo). Works for any affine m
+	inline AABB TransformAABB(const AABB& box, const ew::Mat4& m) {
+		ew::Vec3 center = (m * ew::Vec4(box.center(), 1.0f)).toVec3();
+		ew::Vec3 e = box.extents();
+		ew::Vec3 extents = ew::Vec3(
+			fabsf(m[0][0]) * e.x + fabsf(m[1][0]) * e.y + fabsf(m[2][0]) * e.z,
+			fabsf(m[0][1]) * e.x + fabsf(m[1][1]) * e.y + fabsf(m[2][1]) * e.z,
+			fabsf(m[0][2]) * e.x + fabsf(m[1][2]) * e.y + fabsf(m[2][2]) * e.z);
+		AABB out;
+		out.min = center - extents;
+		out.max = center + extents;
+		return out;
+	}
+
+	//Sphere containing sphere transformed by m. Non uniform scale grows the radius by the largest axis scale
+	inline BoundingSphere TransformBoundingSphere(const BoundingSphere& sphere, const ew::Mat4& m) {
+		BoundingSphere out;
+		out.center = (m * ew::Vec4(sphere.center, 1.0f)).toVec3();
+		out.radius = sphere.radius * MaxAxisScale(m);
+		return out;
+	}
+}
@@ -9,6 +9,8 @@
 #include "vec2.h"
 #include "vec3.h"
 #include "mat4.h"
+#include "mat3.h"
+#include "bounds.h"
 
 namespace ew {
 	constexpr float PI = 3.14159265359f;
@@ -0,0 +1,102 @@
+#pragma once
+#include "vec3.h"
+#include "mat4.h"
+
+namespace ew {
+	//3x3 column major matrix. Same memory layout as GLSL mat3, so it can be uploaded with glUniformMatrix3fv
+	struct Mat3 {
+	private:
+		//Columns are stored as Vec3s, so operator[] never reinterprets float arrays
+		Vec3 cols[3];
+	public:
+		Mat3() = default;
+		Mat3(float n00)
+		{
+			cols[0] = Vec3(n00); cols[1] = Vec3(n00); cols[2] = Vec3(n00);
+		};
+		Mat3(float n00, float n10, float n20,
+			 float n01, float n11, float n21,
+			 float n02, float n12, float n22)
+		{
+			cols[0] = Vec3(n00, n01, n02);
+			cols[1] = Vec3(n10, n11, n12);
+			cols[2] = Vec3(n20, n21, n22);
+		};
+		Mat3(const Vec3& c0, const Vec3& c1, const Vec3& c2) {
+			cols[0] = c0; cols[1] = c1; cols[2] = c2;
+		}
+		//Upper left 3x3 of a Mat4
+		explicit Mat3(const Mat4& m) {
+			for (int c = 0; c < 3; c++) {
+				cols[c] = Vec3(m[c][0], m[c][1], m[c][2]);
+			}
+		}
+		inline Vec3& operator[](int i) {
+			return cols[i];
+		}
+		inline const Vec3& operator[](int i) const {
+			return cols[i];
+		}
+		inline friend Vec3 operator * (const Mat3& m, const Vec3& v) {
+			return Vec3(
+				m[0].x * v.x + m[1].x * v.y + m[2].x * v.z,
+				m[0].y * v.x + m[1].y * v.y + m[2].y * v.z,
+				m[0].z * v.x + m[1].z * v.y + m[2].z * v.z
+			);
+		}
+		inline friend Mat3 operator * (const Mat3& l, const Mat3& r) {
+			Mat3 m;
+			for (int c = 0; c < 3; c++) {
+				m[c] = l * r[c];
+			}
+			return m;
+		}
+	};
+
+	static_assert(sizeof(Mat3) == sizeof(float) * 9, "Mat3 must stay tightly packed for glUniformMatrix3fv");
+
+	inline Mat3 Transpose(const Mat3& m) {
+		return Mat3(
+			m[0].x, m[0].y, m[0].z,
+			m[1].x, m[1].y, m[1].z,
+			m[2].x, m[2].y, m[2].z
+		);
+	}
+
+	inline float Determinant(const Mat3& m) {
+		return Dot(m[0], Cross(m[1], m[2]));
+	}
+
+	/// <summary>
+	/// Cofactor matrix, equal to Determinant(m) * Transpose(Inverse(m)).
+	/// Its columns are cross products of the input columns
+	/// </summary>
+	inline Mat3 Cofactor(const Mat3& m) {
+		Mat3 c;
+		c[0] = Cross(m[1], m[2]);
+		c[1] = Cross(m[2], m[0]);
+		c[2] = Cross(m[0], m[1]);
+		return c;
+	}
+
+	//Results are undefined for singular matrices
+	inline Mat3 Inverse(const Mat3& m) {
+		Mat3 c = Cofactor(m);
+		float invDet = 1.0f / Dot(m[0], c[0]);
+		Mat3 inv = Transpose(c);
+		inv[0] *= invDet; inv[1] *= invDet; inv[2] *= invDet;
+		return inv;
+	}
+
+	/// <summary>
+	/// Matrix that transforms normals from model to world space, transpose(inverse(mat3(model))).
+	/// Compute once per object on the CPU instead of per vertex
+	/// </summary>
+	inline Mat3 NormalMatrix(const Mat4& model) {
+		Mat3 m = Mat3(model);
+		Mat3 c = Cofactor(m);
+		float invDet = 1.0f / Dot(m[0], c[0]);
+		c[0] *= invDet; c[1] *= invDet; c[2] *= invDet;
+		return c;
+	}
+}
@@ -4,6 +4,7 @@
 
 #pragma once
 #include "vec4.h"
+#include "simd.h"
 #include <cstddef>
 
 namespace ew {
@@ -42,15 +43,54 @@ namespace ew {
 			return (*reinterpret_cast<const Vec4*>(n[i]));
 		}
 		inline friend Vec4 operator * (const Mat4& m, const Vec4& v) {
+#if defined(EW_MATH_SSE)
+			__m128 r = _mm_mul_ps(_mm_loadu_ps(&m[0][0]), _mm_set1_ps(v.x));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(&m[1][0]), _mm_set1_ps(v.y)));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(&m[2][0]), _mm_set1_ps(v.z)));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(&m[3][0]), _mm_set1_ps(v.w)));
+			Vec4 out;
+			_mm_storeu_ps(&out.x, r);
+			return out;
+#else
 			return Vec4(
 				m[0][0] * v.x + m[1][0] * v.y + m[2][0] * v.z + m[3][0] * v.w,
 				m[0][1] * v.x + m[1][1] * v.y + m[2][1] * v.z + m[3][1] * v.w,
 				m[0][2] * v.x + m[1][2] * v.y + m[2][2] * v.z + m[3][2] * v.w,
 				m[0][3] * v.x + m[1][3] * v.y + m[2][3] * v.z + m[3][3] * v.w
 			);
+#endif
 		}
 		inline friend Mat4 operator * (const Mat4& l, const Mat4& r) {
 			Mat4 m;
+#if defined(EW_MATH_AVX)
+			//Two result columns per iteration. Same summation order as the scalar path
+			const __m256 l0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&l[0][0]));
+			const __m256 l1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&l[1][0]));
+			const __m256 l2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&l[2][0]));
+			const __m256 l3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&l[3][0]));
+			for (int j = 0; j < 4; j += 2) {
+				const float* a = &r[j][0];
+				const float* b = &r[j + 1][0];
+				__m256 c = _mm256_mul_ps(l0, _mm256_setr_ps(a[0], a[0], a[0], a[0], b[0], b[0], b[0], b[0]));
+				c = _mm256_add_ps(c, _mm256_mul_ps(l1, _mm256_setr_ps(a[1], a[1], a[1], a[1], b[1], b[1], b[1], b[1])));
+				c = _mm256_add_ps(c, _mm256_mul_ps(l2, _mm256_setr_ps(a[2], a[2], a[2], a[2], b[2], b[2], b[2], b[2])));
+				c = _mm256_add_ps(c, _mm256_mul_ps(l3, _mm256_setr_ps(a[3], a[3], a[3], a[3], b[3], b[3], b[3], b[3])));
+				_mm256_storeu_ps(&m[j][0], c);
+			}
+#elif defined(EW_MATH_SSE)
+			//Each result column is a linear combination of the columns of l
+			const __m128 l0 = _mm_loadu_ps(&l[0][0]);
+			const __m128 l1 = _mm_loadu_ps(&l[1][0]);
+			const __m128 l2 = _mm_loadu_ps(&l[2][0]);
+			const __m128 l3 = _mm_loadu_ps(&l[3][0]);
+			for (int j = 0; j < 4; j++) {
+				__m128 c = _mm_mul_ps(l0, _mm_set1_ps(r[j][0]));
+				c = _mm_add_ps(c, _mm_mul_ps(l1, _mm_set1_ps(r[j][1])));
+				c = _mm_add_ps(c, _mm_mul_ps(l2, _mm_set1_ps(r[j][2])));
+				c = _mm_add_ps(c, _mm_mul_ps(l3, _mm_set1_ps(r[j][3])));
+				_mm_storeu_ps(&m[j][0], c);
+			}
+#else
 			//Row 0
 			m[0][0] = l[0][0] * r[0][0] + l[1][0] * r[0][1] + l[2][0] * r[0][2] + l[3][0] * r[0][3];//dot(l_row_0,r_col_0)
 			m[1][0] = l[0][0] * r[1][0] + l[1][0] * r[1][1] + l[2][0] * r[1][2] + l[3][0] * r[1][3];//dot(l_row_0,r_col_1)
@@ -71,6 +111,7 @@ namespace ew {
 			m[1][3] = l[0][3] * r[1][0] + l[1][3] * r[1][1] + l[2][3] * r[1][2] + l[3][3] * r[1][3];//dot(l_row_3,r_col_1)
 			m[2][3] = l[0][3] * r[2][0] + l[1][3] * r[2][1] + l[2][3] * r[2][2] + l[3][3] * r[2][3];//dot(l_row_3,r_col_2)
 			m[3][3] = l[0][3] * r[3][0] + l[1][3] * r[3][1] + l[2][3] * r[3][2] + l[3][3] * r[3][3];//dot(l_row_3,r_col_3)
+#endif
 			return m;		  
 		}
 	};
@@ -82,4 +123,127 @@ namespace ew {
 			0.0f, 0.0f, 0.0f, 1.0f
 		);
 	}
+	//Swaps rows and columns
+	inline Mat4 Transpose(const Mat4& m) {
+		Mat4 t;
+#if defined(EW_MATH_SSE)
+		__m128 c0 = _mm_loadu_ps(&m[0][0]);
+		__m128 c1 = _mm_loadu_ps(&m[1][0]);
+		__m128 c2 = _mm_loadu_ps(&m[2][0]);
+		__m128 c3 = _mm_loadu_ps(&m[3][0]);
+		_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+		_mm_storeu_ps(&t[0][0], c0);
+		_mm_storeu_ps(&t[1][0], c1);
+		_mm_storeu_ps(&t[2][0], c2);
+		_mm_storeu_ps(&t[3][0], c3);
+#else
+		for (int c = 0; c < 4; c++) {
+			for (int r = 0; r < 4; r++) {
+				t[c][r] = m[r][c];
+			}
+		}
+#endif
+		return t;
+	}
+
+#if defined(EW_MATH_SSE)
+	namespace detail {
+		//2x2 matrices packed as (a0 a1 a2 a3) = | a0 a1 |
+		//                                       | a2 a3 |
+		//A * B
+		inline __m128 Mat2Mul(__m128 a, __m128 b) {
+			return _mm_add_ps(_mm_mul_ps(a, EW_SWIZZLE(b, 0, 3, 0, 3)),
+				_mm_mul_ps(EW_SWIZZLE(a, 1, 0, 3, 2), EW_SWIZZLE(b, 2, 1, 2, 1)));
+		}
+		//adj(A) * B
+		inline __m128 Mat2AdjMul(__m128 a, __m128 b) {
+			return _mm_sub_ps(_mm_mul_ps(EW_SWIZZLE(a, 3, 3, 0, 0), b),
+				_mm_mul_ps(EW_SWIZZLE(a, 1, 1, 2, 2), EW_SWIZZLE(b, 2, 3, 0, 1)));
+		}
+		//A * adj(B)
+		inline __m128 Mat2MulAdj(__m128 a, __m128 b) {
+			return _mm_sub_ps(_mm_mul_ps(a, EW_SWIZZLE(b, 3, 0, 3, 0)),
+				_mm_mul_ps(EW_SWIZZLE(a, 1, 0, 3, 2), EW_SWIZZLE(b, 2, 1, 2, 1)));
+		}
+	}
+#endif
+
+	/// <summary>
+	/// General 4x4 inverse. Results are undefined for singular matrices.
+	/// For rigid transforms prefer composing the inverse from the parts instead.
+	/// </summary>
+	inline Mat4 Inverse(const Mat4& m) {
+		Mat4 inv;
+#if defined(EW_MATH_SSE)
+		//Block matrix method on the four 2x2 sub matrices
+		const __m128 c0 = _mm_loadu_ps(&m[0][0]);
+		const __m128 c1 = _mm_loadu_ps(&m[1][0]);
+		const __m128 c2 = _mm_loadu_ps(&m[2][0]);
+		const __m128 c3 = _mm_loadu_ps(&m[3][0]);
+		const __m128 A = _mm_movelh_ps(c0, c1);
+		const __m128 B = _mm_movehl_ps(c1, c0);
+		const __m128 C = _mm_movelh_ps(c2, c3);
+		const __m128 D = _mm_movehl_ps(c3, c2);
+
+		//(|A| |B| |C| |D|)
+		const __m128 detSub = _mm_sub_ps(
+			_mm_mul_ps(EW_SHUFFLE(c0, c2, 0, 2, 0, 2), EW_SHUFFLE(c1, c3, 1, 3, 1, 3)),
+			_mm_mul_ps(EW_SHUFFLE(c0, c2, 1, 3, 1, 3), EW_SHUFFLE(c1, c3, 0, 2, 0, 2)));
+		const __m128 detA = EW_SWIZZLE(detSub, 0, 0, 0, 0);
+		const __m128 detB = EW_SWIZZLE(detSub, 1, 1, 1, 1);
+		const __m128 detC = EW_SWIZZLE(detSub, 2, 2, 2, 2);
+		const __m128 detD = EW_SWIZZLE(detSub, 3, 3, 3, 3);
+
+		const __m128 D_C = detail::Mat2AdjMul(D, C);
+		const __m128 A_B = detail::Mat2AdjMul(A, B);
+		__m128 X = _mm_sub_ps(_mm_mul_ps(detD, A), detail::Mat2Mul(B, D_C));
+		__m128 W = _mm_sub_ps(_mm_mul_ps(detA, D), detail::Mat2Mul(C, A_B));
+		__m128 Y = _mm_sub_ps(_mm_mul_ps(detB, C), detail::Mat2MulAdj(D, A_B));
+		__m128 Z = _mm_sub_ps(_mm_mul_ps(detC, B), detail::Mat2MulAdj(A, D_C));
+
+		//|M| = |A||D| + |B||C| - tr(adj(A)B * adj(D)C)
+		__m128 tr = _mm_mul_ps(A_B, EW_SWIZZLE(D_C, 0, 2, 1, 3));
+		tr = _mm_add_ps(tr, EW_SWIZZLE(tr, 1, 0, 3, 2));
+		tr = _mm_add_ps(tr, EW_SWIZZLE(tr, 2, 3, 0, 1));
+		__m128 detM = _mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC));
+		detM = _mm_sub_ps(detM, tr);
+
+		const __m128 rDetM = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), detM);
+		X = _mm_mul_ps(X, rDetM);
+		Y = _mm_mul_ps(Y, rDetM);
+		Z = _mm_mul_ps(Z, rDetM);
+		W = _mm_mul_ps(W, rDetM);
+
+		//Adjugate shuffle combined with the store shuffle
+		_mm_storeu_ps(&inv[0][0], EW_SHUFFLE(X, Y, 3, 1, 3, 1));
+		_mm_storeu_ps(&inv[1][0], EW_SHUFFLE(X, Y, 2, 0, 2, 0));
+		_mm_storeu_ps(&inv[2][0], EW_SHUFFLE(Z, W, 3, 1, 3, 1));
+		_mm_storeu_ps(&inv[3][0], EW_SHUFFLE(Z, W, 2, 0, 2, 0));
+#else
+		//Cofactor expansion. Storage order does not matter since inverse(transpose(M)) == transpose(inverse(M))
+		const float* a = &m[0][0];
+		float* o = &inv[0][0];
+		o[0] = a[5] * a[10] * a[15] - a[5] * a[11] * a[14] - a[9] * a[6] * a[15] + a[9] * a[7] * a[14] + a[13] * a[6] * a[11] - a[13] * a[7] * a[10];
+		o[4] = -a[4] * a[10] * a[15] + a[4] * a[11] * a[14] + a[8] * a[6] * a[15] - a[8] * a[7] * a[14] - a[12] * a[6] * a[11] + a[12] * a[7] * a[10];
+		o[8] = a[4] * a[9] * a[15] - a[4] * a[11] * a[13] - a[8] * a[5] * a[15] + a[8] * a[7] * a[13] + a[12] * a[5] * a[11] - a[12] * a[7] * a[9];
+		o[12] = -a[4] * a[9] * a[14] + a[4] * a[10] * a[13] + a[8] * a[5] * a[14] - a[8] * a[6] * a[13] - a[12] * a[5] * a[10] + a[12] * a[6] * a[9];
+		o[1] = -a[1] * a[10] * a[15] + a[1] * a[11] * a[14] + a[9] * a[2] * a[15] - a[9] * a[3] * a[14] - a[13] * a[2] * a[11] + a[13] * a[3] * a[10];
+		o[5] = a[0] * a[10] * a[15] - a[0] * a[11] * a[14] - a[8] * a[2] * a[15] + a[8] * a[3] * a[14] + a[12] * a[2] * a[11] - a[12] * a[3] * a[10];
+		o[9] = -a[0] * a[9] * a[15] + a[0] * a[11] * a[13] + a[8] * a[1] * a[15] - a[8] * a[3] * a[13] - a[12] * a[1] * a[11] + a[12] * a[3] * a[9];
+		o[13] = a[0] * a[9] * a[14] - a[0] * a[10] * a[13] - a[8] * a[1] * a[14] + a[8] * a[2] * a[13] + a[12] * a[1] * a[10] - a[12] * a[2] * a[9];
+		o[2] = a[1] * a[6] * a[15] - a[1] * a[7] * a[14] - a[5] * a[2] * a[15] + a[5] * a[3] * a[14] + a[13] * a[2] * a[7] - a[13] * a[3] * a[6];
+		o[6] = -a[0] * a[6] * a[15] + a[0] * a[7] * a[14] + a[4] * a[2] * a[15] - a[4] * a[3] * a[14] - a[12] * a[2] * a[7] + a[12] * a[3] * a[6];
+		o[10] = a[0] * a[5] * a[15] - a[0] * a[7] * a[13] - a[4] * a[1] * a[15] + a[4] * a[3] * a[13] + a[12] * a[1] * a[7] - a[12] * a[3] * a[5];
+		o[14] = -a[0] * a[5] * a[14] + a[0] * a[6] * a[13] + a[4] * a[1] * a[14] - a[4] * a[2] * a[13] - a[12] * a[1] * a[6] + a[12] * a[2] * a[5];
+		o[3] = -a[1] * a[6] * a[11] + a[1] * a[7] * a[10] + a[5] * a[2] * a[11] - a[5] * a[3] * a[10] - a[9] * a[2] * a[7] + a[9] * a[3] * a[6];
+		o[7] = a[0] * a[6] * a[11] - a[0] * a[7] * a[10] - a[4] * a[2] * a[11] + a[4] * a[3] * a[10] + a[8] * a[2] * a[7] - a[8] * a[3] * a[6];
+		o[11] = -a[0] * a[5] * a[11] + a[0] * a[7] * a[9] + a[4] * a[1] * a[11] - a[4] * a[3] * a[9] - a[8] * a[1] * a[7] + a[8] * a[3] * a[5];
+		o[15] = a[0] * a[5] * a[10] - a[0] * a[6] * a[9] - a[4] * a[1] * a[10] + a[4] * a[2] * a[9] + a[8] * a[1] * a[6] - a[8] * a[2] * a[5];
+		const float invDet = 1.0f / (a[0] * o[0] + a[1] * o[4] + a[2] * o[8] + a[3] * o[12]);
+		for (int i = 0; i < 16; i++) {
+			o[i] *= invDet;
+		}
+#endif
+		return inv;
+	}
 }
@@ -0,0 +1,127 @@
+#pragma once
+#include <math.h>
+#include "vec3.h"
+#include "mat3.h"
+#include "mat4.h"
+
+namespace ew {
+	//Unit quaternion rotation. (x,y,z) is the vector part, w the scalar part
+	struct Quat {
+		float x, y, z, w;
+
+		Quat() :x(0), y(0), z(0), w(1) {};
+		Quat(float x, float y, float z, float w) :x(x), y(y), z(z), w(w) {};
+
+		//Hamilton product. (a * b) applies b first, then a
+		friend Quat operator*(const Quat& a, const Quat& b) {
+			return Quat(
+				a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+				a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+				a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+				a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z
+			);
+		}
+	};
+
+	inline float Dot(const Quat& a, const Quat& b) {
+		return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+	}
+
+	inline Quat Normalize(const Quat& q) {
+		float mag = sqrtf(Dot(q, q));
+		if (mag == 0)
+			return Quat();
+		float inv = 1.0f / mag;
+		return Quat(q.x * inv, q.y * inv, q.z * inv, q.w * inv);
+	}
+
+	//Inverse rotation of a unit quaternion
+	inline Quat Conjugate(const Quat& q) {
+		return Quat(-q.x, -q.y, -q.z, q.w);
+	}
+
+	//Rotation of rad radians around a unit length axis
+	inline Quat AxisAngle(const Vec3& axis, float rad) {
+		float s = sinf(rad * 0.5f);
+		return Quat(axis.x * s, axis.y * s, axis.z * s, cosf(rad * 0.5f));
+	}
+
+	/// <summary>
+	/// Quaternion from Euler angles in radians. Uses the same order as ew::Transform (RotateY * RotateX * RotateZ)
+	/// </summary>
+	inline Quat EulerToQuat(const Vec3& rad) {
+		float sx = sinf(rad.x * 0.5f), cx = cosf(rad.x * 0.5f);
+		float sy = sinf(rad.y * 0.5f), cy = cosf(rad.y * 0.5f);
+		float sz = sinf(rad.z * 0.5f), cz = cosf(rad.z * 0.5f);
+		//qy * qx * qz expanded
+		return Quat(
+			cy * sx * cz + sy * cx * sz,
+			sy * cx * cz - cy * sx * sz,
+			cy * cx * sz - sy * sx * cz,
+			cy * cx * cz + sy * sx * sz
+		);
+	}
+
+	//Rotation part as a 3x3 matrix
+	inline Mat3 QuatToMat3(const Quat& q) {
+		float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+		float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+		float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+		return Mat3(
+			1.0f - 2.0f * (yy + zz), 2.0f * (xy - wz), 2.0f * (xz + wy),
+			2.0f * (xy + wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz - wx),
+			2.0f * (xz - wy), 2.0f * (yz + wx), 1.0f - 2.0f * (xx + yy)
+		);
+	}
+
+	/// <summary>
+	/// Inverse of EulerToQuat. Returns radians in the RotateY * RotateX * RotateZ order.
+	/// At +-90 degrees pitch (X) the roll (Z) is folded into yaw (Y)
+	/// </summary>
+	inline Vec3 QuatToEuler(const Quat& q) {
+		Mat3 m = QuatToMat3(q);
+		//m[column].row
+		float sx = -m[2].y;
+		sx = fminf(fmaxf(sx, -1.0f), 1.0f);
+		Vec3 euler;
+		euler.x = asinf(sx);
+		if (fabsf(sx) < 0.9999f) {
+			euler.y = atan2f(m[2].x, m[2].z);
+			euler.z = atan2f(m[0].y, m[1].y);
+		}
+		else {
+			euler.y = atan2f(-m[0].z, m[0].x);
+			euler.z = 0.0f;
+		}
+		return euler;
+	}
+
+	//Rotates a vector by a unit quaternion
+	inline Vec3 Rotate(const Quat& q, const Vec3& v) {
+		Vec3 u = Vec3(q.x, q.y, q.z);
+		Vec3 t = Cross(u, v) * 2.0f;
+		return v + t * q.w + Cross(u, t);
+	}
+
+	//Spherical interpolation along the shortest arc
+	inline Quat Slerp(const Quat& a, Quat b, float t) {
+		float d = Dot(a, b);
+		if (d < 0.0f) {
+			b = Quat(-b.x, -b.y, -b.z, -b.w);
+			d = -d;
+		}
+		float wa, wb;
+		if (d > 0.9995f) {
+			//Nearly parallel, fall back to lerp
+			wa = 1.0f - t;
+			wb = t;
+		}
+		else {
+			float theta = acosf(d);
+			float invSin = 1.0f / sinf(theta);
+			wa = sinf((1.0f - t) * theta) * invSin;
+			wb = sinf(t * theta) * invSin;
+		}
+		return Normalize(Quat(a.x * wa + b.x * wb, a.y * wa + b.y * wb, a.z * wa + b.z * wb, a.w * wa + b.w * wb));
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+//Compile time selection of the ewMath backend.
+//SSE is used whenever the target supports it, AVX paths are added on top when compiled with AVX enabled (/arch:AVX, -mavx).
+//Define EW_MATH_SCALAR (or configure with -DEW_MATH_SIMD=OFF) to force the portable scalar fallback.
+#if !defined(EW_MATH_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+	#define EW_MATH_SSE 1
+	#include <emmintrin.h>
+	#if defined(__AVX__)
+		#define EW_MATH_AVX 1
+		#include <immintrin.h>
+	#endif
+#endif
+
+#if defined(EW_MATH_SSE)
+//Shuffle helper. Selects lanes (x,y) from a and (z,w) from b
+#define EW_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+#define EW_SWIZZLE(v, x, y, z, w) EW_SHUFFLE(v, v, x, y, z, w)
+#endif
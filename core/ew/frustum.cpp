@@ -0,0 +1,173 @@
+#include "frustum.h"
+
+namespace ew {
+	static Plane normalizePlane(const ew::Vec4& p) {
+		Plane plane;
+		float invMag = 1.0f / sqrtf(p.x * p.x + p.y * p.y + p.z * p.z);
+		plane.normal = ew::Vec3(p.x, p.y, p.z) * invMag;
+		plane.d = p.w * invMag;
+		return plane;
+	}
+	Frustum ExtractFrustum(const ew::Mat4& m)
+	{
+		//Rows of the (column major) matrix
+		ew::Vec4 row[4];
+		for (int i = 0; i < 4; i++) {
+			row[i] = ew::Vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+		}
+		//Vec4 +=/-= only touch xyz, so w is combined explicitly
+		auto add = [](const ew::Vec4& a, const ew::Vec4& b) { return ew::Vec4(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w); };
+		auto sub = [](const ew::Vec4& a, const ew::Vec4& b) { return ew::Vec4(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w); };
+		Frustum f;
+		f.planes[Frustum::PLANE_LEFT] = normalizePlane(add(row[3], row[0]));
+		f.planes[Frustum::PLANE_RIGHT] = normalizePlane(sub(row[3], row[0]));
+		f.planes[Frustum::PLANE_BOTTOM] = normalizePlane(add(row[3], row[1]));
+		f.planes[Frustum::PLANE_TOP] = normalizePlane(sub(row[3], row[1]));
+		f.planes[Frustum::PLANE_NEAR] = normalizePlane(add(row[3], row[2]));
+		f.planes[Frustum::PLANE_FAR] = normalizePlane(sub(row[3], row[2]));
+		return f;
+	}
+
+	bool SphereInFrustum(const Frustum& frustum, const ew::BoundingSphere& sphere)
+	{
+		for (int i = 0; i < Frustum::NUM_PLANES; i++) {
+			const Plane& p = frustum.planes[i];
+			if (ew::Dot(p.normal, sphere.center) + p.d < -sphere.radius)
+				return false;
+		}
+		return true;
+	}
+
+	bool AABBInFrustum(const Frustum& frustum, const ew::AABB& box)
+	{
+		ew::Vec3 c = box.center();
+		ew::Vec3 e = box.extents();
+		for (int i = 0; i < Frustum::NUM_PLANES; i++) {
+			const Plane& p = frustum.planes[i];
+			//Projected radius of the box onto the plane normal
+			float r = e.x * fabsf(p.normal.x) + e.y * fabsf(p.normal.y) + e.z * fabsf(p.normal.z);
+			if (ew::Dot(p.normal, c) + p.d < -r)
+				return false;
+		}
+		return true;
+	}
+
+	size_t CullSpheres(const Frustum& frustum, const ew::BoundingSphere* spheres, size_t count, uint8_t* visible)
+	{
+		size_t numVisible = 0;
+		size_t i = 0;
+#if defined(EW_MATH_SSE)
+		static_assert(sizeof(ew::BoundingSphere) == 16, "BoundingSphere is loaded as 4 floats");
+		__m128 nx[Frustum::NUM_PLANES], ny[Frustum::NUM_PLANES], nz[Frustum::NUM_PLANES], nd[Frustum::NUM_PLANES];
+		for (int p = 0; p < Frustum::NUM_PLANES; p++) {
+			nx[p] = _mm_set1_ps(frustum.planes[p].normal.x);
+			ny[p] = _mm_set1_ps(frustum.planes[p].normal.y);
+			nz[p] = _mm_set1_ps(frustum.planes[p].normal.z);
+			nd[p] = _mm_set1_ps(frustum.planes[p].d);
+		}
+		for (; i + 4 <= count; i += 4)
+		{
+			//4 spheres transposed into x,y,z,radius lanes
+			__m128 x = _mm_loadu_ps(&spheres[i].center.x);
+			__m128 y = _mm_loadu_ps(&spheres[i + 1].center.x);
+			__m128 z = _mm_loadu_ps(&spheres[i + 2].center.x);
+			__m128 r = _mm_loadu_ps(&spheres[i + 3].center.x);
+			_MM_TRANSPOSE4_PS(x, y, z, r);
+			const __m128 negR = _mm_sub_ps(_mm_setzero_ps(), r);
+			__m128 outside = _mm_setzero_ps();
+			for (int p = 0; p < Frustum::NUM_PLANES; p++) {
+				__m128 dist = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], x), _mm_mul_ps(ny[p], y)), _mm_mul_ps(nz[p], z)), nd[p]);
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, negR));
+			}
+			int mask = _mm_movemask_ps(outside);
+			for (int k = 0; k < 4; k++) {
+				uint8_t v = (mask & (1 << k)) ? 0 : 1;
+				visible[i + k] = v;
+				numVisible += v;
+			}
+		}
+#endif
+		for (; i < count; i++) {
+			visible[i] = SphereInFrustum(frustum, spheres[i]) ? 1 : 0;
+			numVisible += visible[i];
+		}
+		return numVisible;
+	}
+
+	size_t CullAABBs(const Frustum& frustum, const ew::AABB* boxes, size_t count, uint8_t* visible)
+	{
+		size_t numVisible = 0;
+		size_t i = 0;
+#if defined(EW_MATH_SSE)
+		__m128 nx[Frustum::NUM_PLANES], ny[Frustum::NUM_PLANES], nz[Frustum::NUM_PLANES], nd[Frustum::NUM_PLANES];
+		__m128 ax[Frustum::NUM_PLANES], ay[Frustum::NUM_PLANES], az[Frustum::NUM_PLANES];
+		for (int p = 0; p < Frustum::NUM_PLANES; p++) {
+			const Plane& plane = frustum.planes[p];
+			nx[p] = _mm_set1_ps(plane.normal.x);
+			ny[p] = _mm_set1_ps(plane.normal.y);
+			nz[p] = _mm_set1_ps(plane.normal.z);
+			nd[p] = _mm_set1_ps(plane.d);
+			ax[p] = _mm_set1_ps(fabsf(plane.normal.x));
+			ay[p] = _mm_set1_ps(fabsf(plane.normal.y));
+			az[p] = _mm_set1_ps(fabsf(plane.normal.z));
+		}
+		const __m128 half = _mm_set1_ps(0.5f);
+		for (; i + 4 <= count; i += 4)
+		{
+			const ew::AABB* b = boxes + i;
+			const __m128 minX = _mm_setr_ps(b[0].min.x, b[1].min.x, b[2].min.x, b[3].min.x);
+			const __m128 minY = _mm_setr_ps(b[0].min.y, b[1].min.y, b[2].min.y, b[3].min.y);
+			const __m128 minZ = _mm_setr_ps(b[0].min.z, b[1].min.z, b[2].min.z, b[3].min.z);
+			const __m128 maxX = _mm_setr_ps(b[0].max.x, b[1].max.x, b[2].max.x, b[3].max.x);
+			const __m128 maxY = _mm_setr_ps(b[0].max.y, b[1].max.y, b[2].max.y, b[3].max.y);
+			const __m128 maxZ = _mm_setr_ps(b[0].max.z, b[1].max.z, b[2].max.z, b[3].max.z);
+			const __m128 cx = _mm_mul_ps(_mm_add_ps(minX, maxX), half);
+			const __m128 cy = _mm_mul_ps(_mm_add_ps(minY, maxY), half);
+			const __m128 cz = _mm_mul_ps(_mm_add_ps(minZ, maxZ), half);
+			const __m128 ex = _mm_mul_ps(_mm_sub_ps(maxX, minX), half);
+			const __m128 ey = _mm_mul_ps(_mm_sub_ps(maxY, minY), half);
+			const __m128 ez = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half);
+			__m128 outside = _mm_setzero_ps();
+			for (int p = 0; p < Frustum::NUM_PLANES; p++) {
+				__m128 dist = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)), _mm_mul_ps(nz[p], cz)), nd[p]);
+				__m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_mul_ps(az[p], ez));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(dist, r), _mm_setzero_ps()));
+			}
+			int mask = _mm_movemask_ps(outside);
+			for (int k = 0; k < 4; k++) {
+				uint8_t v = (mask & (1 << k)) ? 0 : 1;
+				visible[i + k] = v;
+				numVisible += v;
+			}
+		}
+#endif
+		for (; i < count; i++) {
+			visible[i] = AABBInFrustum(frustum, boxes[i]) ? 1 : 0;
+			numVisible += visible[i];
+		}
+		return numVisible;
+	}
+
+	CullStats CullDrawList(const Frustum& frustum, const std::vector<DrawItem>& items, std::vector<DrawItem>* visibleItems)
+	{
+		//Scratch buffers are kept between calls so steady state culling does not allocate
+		static thread_local std::vector<ew::BoundingSphere> spheres;
+		static thread_local std::vector<uint8_t> visible;
+		spheres.resize(items.size());
+		visible.resize(items.size());
+		for (size_t i = 0; i < items.size(); i++) {
+			spheres[i] = items[i].worldBounds;
+		}
+		CullStats stats;
+		stats.visible = CullSpheres(frustum, spheres.data(), spheres.size(), visible.data());
+		stats.culled = items.size() - stats.visible;
+
+		visibleItems->clear();
+		visibleItems->reserve(stats.visible);
+		for (size_t i = 0; i < items.size(); i++) {
+			if (visible[i])
+				visibleItems->push_back(items[i]);
+		}
+		return stats;
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include <stdint.h>
+#include "ewMath/ewMath.h"
+#include "ewMath/bounds.h"
+
+namespace ew {
+	class Mesh;
+
+	//Points p with Dot(normal, p) + d >= 0 are on the inside
+	struct Plane {
+		ew::Vec3 normal = ew::Vec3(0.0f);
+		float d = 0.0f;
+	};
+
+	struct Frustum {
+		enum { PLANE_LEFT = 0, PLANE_RIGHT, PLANE_BOTTOM, PLANE_TOP, PLANE_NEAR, PLANE_FAR, NUM_PLANES };
+		Plane planes[NUM_PLANES];
+	};
+
+	/// <summary>
+	/// Extracts the 6 normalized frustum planes from a view projection matrix (Gribb/Hartmann).
+	/// Passing projection * view gives world space planes, passing projection * view * model gives model space planes
+	/// </summary>
+	Frustum ExtractFrustum(const ew::Mat4& viewProjection);
+
+	bool SphereInFrustum(const Frustum& frustum, const ew::BoundingSphere& sphere);
+	bool AABBInFrustum(const Frustum& frustum, const ew::AABB& box);
+
+	/// <summary>
+	/// Batched visibility tests. Writes 1 (visible) or 0 (culled) per element into visible.
+	/// Returns the number of visible elements
+	/// </summary>
+	size_t CullSpheres(const Frustum& frustum, const ew::BoundingSphere* spheres, size_t count, uint8_t* visible);
+	size_t CullAABBs(const Frustum& frustum, const ew::AABB* boxes, size_t count, uint8_t* visible);
+
+	struct CullStats {
+		size_t visible = 0;
+		size_t culled = 0;
+	};
+
+	//One object to draw. Bounds are in world space
+	struct DrawItem {
+		const ew::Mesh* mesh = nullptr;
+		ew::Mat4 model;
+		ew::BoundingSphere worldBounds;
+		unsigned int id = 0; //Caller defined, e.g. an index into the scene's objects, to find visible items' owners
+	};
+
+	/// <summary>
+	/// Filters a draw list down to the items that intersect the frustum.
+	/// visibleItems is cleared and filled in submission order
+	/// </summary>
+	CullStats CullDrawList(const Frustum& frustum, const std::vector<DrawItem>& items, std::vector<DrawItem>* visibleItems);
+}
@@ -0,0 +1,46 @@
+#include "instanceBuffer.h"
+#include "external/glad.h"
+#include <algorithm>
+
+namespace ew {
+	//Smallest GPU allocation, in instances
+	const size_t MIN_INSTANCE_CAPACITY = 64;
+
+	void InstanceBuffer::add(const ew::Mat4* models, size_t count, const ew::Vec4& color)
+	{
+		size_t first = m_instances.size();
+		m_instances.resize(first + count);
+		for (size_t i = 0; i < count; i++) {
+			m_instances[first + i].model = models[i];
+			m_instances[first + i].color = color;
+		}
+	}
+
+	/// <summary>
+	/// Grows to at least twice the old capacity, so filling a few more instances every frame
+	/// does not reallocate every frame. The buffer name never changes, so meshes keep their attribute setup
+	/// </summary>
+	void InstanceBuffer::upload()
+	{
+		if (m_buffer == 0)
+			glGenBuffers(1, &m_buffer);
+		if (m_instances.empty())
+			return;
+		if (m_instances.size() > m_capacity) {
+			m_capacity = std::max(std::max(m_instances.size(), m_capacity * 2), MIN_INSTANCE_CAPACITY);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, m_capacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, 0, m_instances.size() * sizeof(InstanceData), m_instances.data());
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	void InstanceBuffer::destroy()
+	{
+		if (m_buffer) {
+			glDeleteBuffers(1, &m_buffer);
+			m_buffer = 0;
+		}
+		m_capacity = 0;
+	}
+}
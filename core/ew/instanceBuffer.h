@@ -0,0 +1,45 @@
+#pragma once
+#include <vector>
+#include <stddef.h>
+#include "ewMath/ewMath.h"
+
+namespace ew {
+	//Per instance vertex attributes read by Mesh::drawInstanced. The model matrix takes 4 locations, one per column
+	const unsigned int INSTANCE_MODEL_LOCATION = 3;
+	const unsigned int INSTANCE_COLOR_LOCATION = 7;
+
+	struct InstanceData {
+		ew::Mat4 model;
+		ew::Vec4 color = ew::Vec4(1.0f);
+	};
+
+	/// <summary>
+	/// Instance attributes for Mesh::drawInstanced, gathered on the CPU and uploaded once per frame.
+	/// The GPU buffer grows geometrically and is orphaned on every upload, so draws still reading
+	/// last frame's instances never stall the upload
+	/// </summary>
+	class InstanceBuffer {
+	public:
+		InstanceBuffer() {};
+		//Starts over, keeping the allocated memory
+		inline void clear() { m_instances.clear(); }
+		inline void reserve(size_t count) { m_instances.reserve(count); }
+		inline void add(const ew::Mat4& model, const ew::Vec4& color = ew::Vec4(1.0f)) { m_instances.push_back({ model, color }); }
+		//e.g. TransformArray::modelMatrices()
+		void add(const ew::Mat4* models, size_t count, const ew::Vec4& color = ew::Vec4(1.0f));
+		//For filling instances in place. Sizes the array with resize first
+		inline void resize(size_t count) { m_instances.resize(count); }
+		inline InstanceData* data() { return m_instances.data(); }
+		inline size_t getNumInstances()const { return m_instances.size(); }
+		//Copies every instance to the GPU. Call after adding the frame's instances, before drawing them
+		void upload();
+		void destroy();
+		inline unsigned int getBuffer()const { return m_buffer; }
+		//Instances that fit in the GPU buffer without growing it
+		inline size_t getCapacity()const { return m_capacity; }
+	private:
+		std::vector<InstanceData> m_instances;
+		unsigned int m_buffer = 0;
+		size_t m_capacity = 0;
+	};
+}
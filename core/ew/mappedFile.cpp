@@ -0,0 +1,106 @@
+#include "mappedFile.h"
+#include <stdio.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace ew {
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+#ifdef _WIN32
+	bool MappedFile::open(const std::string& filePath)
+	{
+		close();
+		HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE) {
+			printf("Failed to open file %s\n", filePath.c_str());
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+			CloseHandle(file);
+			return false;
+		}
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL) {
+			printf("Failed to map file %s\n", filePath.c_str());
+			CloseHandle(file);
+			return false;
+		}
+		void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (data == NULL) {
+			printf("Failed to map file %s\n", filePath.c_str());
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+		m_file = file;
+		m_mapping = mapping;
+		m_data = (const unsigned char*)data;
+		m_size = (size_t)fileSize.QuadPart;
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (m_data)
+			UnmapViewOfFile(m_data);
+		if (m_mapping)
+			CloseHandle((HANDLE)m_mapping);
+		if (m_file)
+			CloseHandle((HANDLE)m_file);
+		m_data = nullptr;
+		m_size = 0;
+		m_mapping = nullptr;
+		m_file = nullptr;
+	}
+#else
+	bool MappedFile::open(const std::string& filePath)
+	{
+		close();
+		int fd = ::open(filePath.c_str(), O_RDONLY);
+		if (fd < 0) {
+			printf("Failed to open file %s\n", filePath.c_str());
+			return false;
+		}
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0) {
+			::close(fd);
+			return false;
+		}
+		void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		//The mapping keeps the file alive on its own
+		::close(fd);
+		if (data == MAP_FAILED) {
+			printf("Failed to map file %s\n", filePath.c_str());
+			return false;
+		}
+#ifdef MADV_WILLNEED
+		//Everything is read once, front to back, when uploaded. Start reading ahead now
+		madvise(data, (size_t)info.st_size, MADV_WILLNEED);
+#endif
+		m_data = (const unsigned char*)data;
+		m_size = (size_t)info.st_size;
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (m_data)
+			munmap((void*)m_data, m_size);
+		m_data = nullptr;
+		m_size = 0;
+	}
+#endif
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <stddef.h>
+
+namespace ew {
+	/// <summary>
+	/// Read only view of a whole file mapped into memory (mmap, or CreateFileMapping on Windows).
+	/// Pages are loaded by the OS when first touched, nothing is read up front.
+	/// Unmapped when closed or destroyed, so pointers into data() must not outlive it
+	/// </summary>
+	class MappedFile {
+	public:
+		MappedFile() {};
+		~MappedFile();
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		bool open(const std::string& filePath);
+		void close();
+		inline bool isOpen()const { return m_data != nullptr; }
+		inline const unsigned char* data()const { return m_data; }
+		inline size_t size()const { return m_size; }
+	private:
+		const unsigned char* m_data = nullptr;
+		size_t m_size = 0;
+#ifdef _WIN32
+		void* m_file = nullptr; //HANDLE
+		void* m_mapping = nullptr; //HANDLE
+#endif
+	};
+}
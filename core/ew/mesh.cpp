@@ -3,52 +3,207 @@
 */
 
 #include "mesh.h"
+#include "vertexPacking.h"
+#include "meshBounds.h"
 #include "ewMath/ewMath.h"
 #include "external/glad.h"
+#include <string.h>
+#include <stdio.h>
 
 namespace ew {
-	Mesh::Mesh(const MeshData& meshData)
+	std::vector<MeshData> splitMeshData(const MeshData& meshData, unsigned int maxVertices)
 	{
+		std::vector<MeshData> parts;
+		if (meshData.vertices.size() <= maxVertices) {
+			parts.push_back(meshData);
+			return parts;
+		}
+		const unsigned int UNMAPPED = 0xffffffff;
+		//Source vertex -> index in the current part
+		std::vector<unsigned int> remap(meshData.vertices.size(), UNMAPPED);
+		std::vector<unsigned int> touched;
+		parts.emplace_back();
+		for (size_t t = 0; t + 2 < meshData.indices.size(); t += 3)
+		{
+			const unsigned int* tri = &meshData.indices[t];
+			unsigned int newVertices = 0;
+			for (int k = 0; k < 3; k++) {
+				if (remap[tri[k]] == UNMAPPED)
+					newVertices++;
+			}
+			if (parts.back().vertices.size() + newVertices > maxVertices) {
+				//Start a new part
+				for (unsigned int v : touched) {
+					remap[v] = UNMAPPED;
+				}
+				touched.clear();
+				parts.emplace_back();
+			}
+			MeshData& part = parts.back();
+			for (int k = 0; k < 3; k++) {
+				unsigned int v = tri[k];
+				if (remap[v] == UNMAPPED) {
+					remap[v] = (unsigned int)part.vertices.size();
+					part.vertices.push_back(meshData.vertices[v]);
+					touched.push_back(v);
+				}
+				part.indices.push_back(remap[v]);
+			}
+		}
+		for (MeshData& part : parts) {
+			computeBounds(&part);
+		}
+		return parts;
+	}
+	Mesh::Mesh(const MeshData& meshData, MeshUsage usage)
+	{
+		m_usage = usage;
 		load(meshData);
 	}
-	void Mesh::load(const MeshData& meshData)
+	/// <summary>
+	/// Creates the VAO and buffers on first use, then binds them
+	/// </summary>
+	void Mesh::bindBuffers()
 	{
 		if (!m_initialized) {
 			glGenVertexArrays(1, &m_vao);
-			glBindVertexArray(m_vao);
-
 			glGenBuffers(1, &m_vbo);
-			glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-
 			glGenBuffers(1, &m_ebo);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-			//Position attribute
-			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, pos));
-			glEnableVertexAttribArray(0);
-
-			//Normal attribute
-			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, normal));
-			glEnableVertexAttribArray(1);
-
-			//UV attribute
-			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, uv)));
-			glEnableVertexAttribArray(2);
-
 			m_initialized = true;
 		}
-
 		glBindVertexArray(m_vao);
 		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-
-		if (meshData.vertices.size() > 0) {
-			glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * meshData.vertices.size(), meshData.vertices.data(), GL_STATIC_DRAW);
+	}
+	/// <summary>
+	/// glBufferData for STATIC meshes. Other meshes keep their storage while the data fits:
+	/// respecifying it with NULL orphans the old storage, so the driver hands out fresh memory
+	/// instead of waiting for draws that still read it
+	/// </summary>
+	static void uploadBuffer(GLenum target, const void* data, size_t size, MeshUsage usage, size_t* capacity)
+	{
+		if (size == 0)
+			return;
+		if (usage == MeshUsage::STATIC || size > *capacity) {
+			glBufferData(target, size, data, usage == MeshUsage::STATIC ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW);
+			*capacity = size;
+			return;
 		}
-		if (meshData.indices.size() > 0) {
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * meshData.indices.size(), meshData.indices.data(), GL_STATIC_DRAW);
+		glBufferData(target, *capacity, NULL, GL_DYNAMIC_DRAW);
+		glBufferSubData(target, 0, size, data);
+	}
+	/// <summary>
+	/// STREAM meshes read vertices from a ring of sections instead of m_vbo. Call before the attributes are specified
+	/// </summary>
+	void Mesh::bindVertexStorage(size_t size)
+	{
+		if (m_usage != MeshUsage::STREAM) {
+			m_stream.destroy();
+			m_baseVertex = 0;
+			return;
+		}
+		if (m_stream.getBuffer() == 0 || m_stream.getSectionSize() != size) {
+			m_stream.create(size);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, m_stream.getBuffer());
+	}
+	void Mesh::uploadVertices(const void* data, size_t size)
+	{
+		if (size == 0)
+			return;
+		if (m_usage == MeshUsage::STREAM) {
+			void* section = m_stream.nextSection();
+			memcpy(section, data, size);
+			m_baseVertex = m_stream.getSectionIndex() * m_numVertices;
+		}
+		else {
+			uploadBuffer(GL_ARRAY_BUFFER, data, size, m_usage, &m_vertexCapacity);
+		}
+	}
+	/// <summary>
+	/// Uploads indices as GL_UNSIGNED_SHORT when every index fits, which halves index memory and bandwidth
+	/// </summary>
+	void Mesh::uploadIndices(const std::vector<unsigned int>& indices, size_t numVertices)
+	{
+		if (numVertices <= MAX_SHORT_INDEX_VERTICES) {
+			std::vector<unsigned short> shortIndices(indices.begin(), indices.end());
+			uploadIndices(shortIndices.data(), shortIndices.size(), GL_UNSIGNED_SHORT);
+		}
+		else {
+			uploadIndices(indices.data(), indices.size(), GL_UNSIGNED_INT);
+		}
+	}
+	void Mesh::uploadIndices(const void* indices, size_t numIndices, unsigned int indexType)
+	{
+		const size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+		uploadBuffer(GL_ELEMENT_ARRAY_BUFFER, indices, indexSize * numIndices, m_usage, &m_indexCapacity);
+		m_indexType = indexType;
+		m_numIndices = numIndices;
+	}
+	/// <summary>
+	/// Binds the buffers, specifies the Vertex layout and uploads the vertices. Leaves the VAO bound for the indices
+	/// </summary>
+	void Mesh::loadVertices(const Vertex* vertices, size_t numVertices)
+	{
+		bindBuffers();
+		m_numVertices = numVertices;
+		m_vertexStride = sizeof(Vertex);
+		bindVertexStorage(sizeof(Vertex) * numVertices);
+
+		//Attributes are respecified on every load, since a previous load may have used a packed layout
+		//Position attribute
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, pos));
+		glEnableVertexAttribArray(0);
+
+		//Normal attribute
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, normal));
+		glEnableVertexAttribArray(1);
+
+		//UV attribute
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, uv)));
+		glEnableVertexAttribArray(2);
+
+		uploadVertices(vertices, sizeof(Vertex) * numVertices);
+	}
+	void Mesh::load(const MeshData& meshData)
+	{
+		loadVertices(meshData.vertices.data(), meshData.vertices.size());
+		uploadIndices(meshData.indices, meshData.vertices.size());
+		m_bounds = meshData.bounds;
+		m_boundingSphere = meshData.boundingSphere;
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+	void Mesh::load(const MeshDataView& view)
+	{
+		loadVertices(view.vertices, view.numVertices);
+		uploadIndices(view.indices, view.numIndices, view.indexType);
+		m_bounds = view.bounds;
+		m_boundingSphere = view.boundingSphere;
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+	void Mesh::load(const PackedMeshData& packedMeshData)
+	{
+		bindBuffers();
+		m_numVertices = packedMeshData.numVertices;
+		m_vertexStride = packedMeshData.stride;
+		bindVertexStorage(packedMeshData.vertices.size());
+
+		for (const VertexAttribute& attribute : packedMeshData.attributes) {
+			glVertexAttribPointer(attribute.location, attribute.components, attribute.glType, attribute.normalized ? GL_TRUE : GL_FALSE,
+				packedMeshData.stride, (const void*)(size_t)attribute.offset);
+			glEnableVertexAttribArray(attribute.location);
 		}
-		m_numVertices = meshData.vertices.size();
-		m_numIndices = meshData.indices.size();
+
+		uploadVertices(packedMeshData.vertices.data(), packedMeshData.vertices.size());
+		uploadIndices(packedMeshData.indices, packedMeshData.numVertices);
+		m_bounds = packedMeshData.bounds;
+		m_boundingSphere = packedMeshData.boundingSphere;
 
 		glBindVertexArray(0);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -58,11 +213,103 @@ namespace ew {
 	{
 		glBindVertexArray(m_vao);
 		if (drawMode == DrawMode::TRIANGLES) {
-			glDrawElements(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, NULL);
+			glDrawElementsBaseVertex(GL_TRIANGLES, m_numIndices, m_indexType, NULL, m_baseVertex);
 		}
 		else {
-			glDrawArrays(GL_POINTS, 0, m_numVertices);
+			glDrawArrays(GL_POINTS, m_baseVertex, m_numVertices);
 		}
 		
 	}
-}
\ No newline at end of file
+	void Mesh::drawRanges(const std::vector<IndexRange>& ranges) const
+	{
+		if (ranges.empty())
+			return;
+		const size_t indexSize = m_indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+		std::vector<GLsizei> counts(ranges.size());
+		std::vector<const void*> offsets(ranges.size());
+		std::vector<GLint> baseVertices(ranges.size(), m_baseVertex);
+		for (size_t i = 0; i < ranges.size(); i++) {
+			counts[i] = ranges[i].count;
+			offsets[i] = (const void*)(ranges[i].first * indexSize);
+		}
+		glBindVertexArray(m_vao);
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), m_indexType, offsets.data(), (GLsizei)ranges.size(), baseVertices.data());
+	}
+	/// <summary>
+	/// Points the instance attributes at the buffer with a divisor of 1. Done on every instanced draw,
+	/// since the same mesh may be drawn from several instance buffers in one frame
+	/// </summary>
+	void Mesh::bindInstanceAttributes(const InstanceBuffer& instances) const
+	{
+		glBindVertexArray(m_vao);
+		glBindBuffer(GL_ARRAY_BUFFER, instances.getBuffer());
+		for (unsigned int column = 0; column < 4; column++) {
+			const unsigned int location = INSTANCE_MODEL_LOCATION + column;
+			glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (const void*)(offsetof(InstanceData, model) + sizeof(ew::Vec4) * column));
+			glEnableVertexAttribArray(location);
+			glVertexAttribDivisor(location, 1);
+		}
+		glVertexAttribPointer(INSTANCE_COLOR_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (const void*)offsetof(InstanceData, color));
+		glEnableVertexAttribArray(INSTANCE_COLOR_LOCATION);
+		glVertexAttribDivisor(INSTANCE_COLOR_LOCATION, 1);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	void Mesh::drawInstanced(const InstanceBuffer& instances, DrawMode drawMode) const
+	{
+		drawInstanced(instances, 0, instances.getNumInstances(), drawMode);
+	}
+	void Mesh::drawInstanced(const InstanceBuffer& instances, size_t first, size_t count, DrawMode drawMode) const
+	{
+		if (count == 0 || instances.getBuffer() == 0)
+			return;
+		bindInstanceAttributes(instances);
+		if (drawMode == DrawMode::TRIANGLES) {
+			glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, m_numIndices, m_indexType, NULL, (GLsizei)count, m_baseVertex, (GLuint)first);
+		}
+		else {
+			glDrawArraysInstancedBaseInstance(GL_POINTS, m_baseVertex, m_numVertices, (GLsizei)count, (GLuint)first);
+		}
+	}
+	/// <summary>
+	/// glBufferSubData straight into m_vbo would make the driver wait for, or copy around, every draw still reading it.
+	/// The vertices go to an orphaned staging buffer instead, and the GPU copies them over in command order
+	/// </summary>
+	bool Mesh::updateVertices(size_t first, const Vertex* vertices, size_t count)
+	{
+		if (m_usage == MeshUsage::STREAM) {
+			printf("updateVertices is not available for STREAM meshes, use mapVertices\n");
+			return false;
+		}
+		if (m_vertexStride != sizeof(Vertex)) {
+			printf("updateVertices needs the Vertex layout, this mesh was loaded from PackedMeshData\n");
+			return false;
+		}
+		if (first > (size_t)m_numVertices || count > (size_t)m_numVertices - first) {
+			printf("updateVertices range %zu-%zu is past the mesh's %d vertices\n", first, first + count, m_numVertices);
+			return false;
+		}
+		if (count == 0)
+			return true;
+		const size_t size = count * sizeof(Vertex);
+		if (m_stagingBuffer == 0)
+			glGenBuffers(1, &m_stagingBuffer);
+		glBindBuffer(GL_COPY_READ_BUFFER, m_stagingBuffer);
+		if (size > m_stagingCapacity)
+			m_stagingCapacity = size;
+		glBufferData(GL_COPY_READ_BUFFER, m_stagingCapacity, NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_COPY_READ_BUFFER, 0, size, vertices);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_vbo);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, first * sizeof(Vertex), size);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		return true;
+	}
+	Vertex* Mesh::mapVertices()
+	{
+		if (m_usage != MeshUsage::STREAM)
+			return nullptr;
+		Vertex* vertices = (Vertex*)m_stream.nextSection();
+		m_baseVertex = m_stream.getSectionIndex() * m_numVertices;
+		return vertices;
+	}
+}
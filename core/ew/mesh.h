@@ -4,6 +4,8 @@
 
 #pragma once
 #include "ewMath/ewMath.h"
+#include "streamBuffer.h"
+#include "instanceBuffer.h"
 
 namespace ew {
 	struct Vertex {
@@ -15,6 +17,37 @@ namespace ew {
 	struct MeshData {
 		std::vector<Vertex> vertices;
 		std::vector<unsigned int> indices;
+		//Object space. Filled by the generators and loaders, call computeBounds (meshBounds.h) after changing vertices
+		ew::AABB bounds;
+		ew::BoundingSphere boundingSphere;
+	};
+
+	//Vertices and indices owned elsewhere, e.g. a mapped .ewmesh file. Uploaded without copies
+	struct MeshDataView {
+		const Vertex* vertices = nullptr;
+		size_t numVertices = 0;
+		const void* indices = nullptr;
+		size_t numIndices = 0;
+		unsigned int indexType = 0x1405; //GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+		ew::AABB bounds;
+		ew::BoundingSphere boundingSphere;
+	};
+
+	struct PackedMeshData;
+
+	//Meshes with at most this many vertices are drawn with 16 bit indices
+	const unsigned int MAX_SHORT_INDEX_VERTICES = 65536;
+
+	/// <summary>
+	/// Splits a mesh into sub meshes that each have at most maxVertices vertices, so all of them can use 16 bit indices.
+	/// Triangles keep their order. Meshes that already fit are returned as a single copy
+	/// </summary>
+	std::vector<MeshData> splitMeshData(const MeshData& meshData, unsigned int maxVertices = MAX_SHORT_INDEX_VERTICES);
+
+	//A run of indices in a Mesh's index buffer
+	struct IndexRange {
+		unsigned int first = 0;
+		unsigned int count = 0;
 	};
 
 	enum class DrawMode {
@@ -22,20 +55,79 @@ namespace ew {
 		POINTS = 1
 	};
 
+	enum class MeshUsage {
+		STATIC = 0, //Uploaded once
+		DYNAMIC = 1, //Reloaded or partially updated now and then. Reloads orphan the old storage instead of waiting on it
+		STREAM = 2 //Vertices rewritten every frame through a persistently mapped ring, see mapVertices
+	};
+
 	class Mesh {
 	public:
 		Mesh() {};
-		Mesh(const MeshData& meshData);
+		Mesh(const MeshData& meshData, MeshUsage usage = MeshUsage::STATIC);
+		//Takes effect on the next load
+		inline void setUsage(MeshUsage usage) { m_usage = usage; }
+		inline MeshUsage getUsage()const { return m_usage; }
 		void load(const MeshData& meshData);
+		//Compact vertex layout, see vertexPacking.h
+		void load(const PackedMeshData& packedMeshData);
+		//Indices are uploaded in the view's index type as is
+		void load(const MeshDataView& view);
 		void draw(DrawMode drawMode = DrawMode::TRIANGLES)const;
+		//Draws triangles from parts of the index buffer in one call, e.g. the output of cullMeshlets
+		void drawRanges(const std::vector<IndexRange>& ranges)const;
+		/// <summary>
+		/// Draws the mesh once per uploaded instance in a single call. The instances' model matrix and color
+		/// are read by the shader from INSTANCE_MODEL_LOCATION and INSTANCE_COLOR_LOCATION (instanceBuffer.h)
+		/// </summary>
+		void drawInstanced(const InstanceBuffer& instances, DrawMode drawMode = DrawMode::TRIANGLES)const;
+		//Instances first to first + count - 1 only, e.g. the instances that picked this LOD level
+		void drawInstanced(const InstanceBuffer& instances, size_t first, size_t count, DrawMode drawMode = DrawMode::TRIANGLES)const;
+		/// <summary>
+		/// Overwrites count vertices starting at first, without waiting on draws that still read them.
+		/// Returns false for STREAM meshes (use mapVertices), meshes loaded from PackedMeshData and ranges past the last vertex
+		/// </summary>
+		bool updateVertices(size_t first, const Vertex* vertices, size_t count);
+		/// <summary>
+		/// STREAM meshes only. Returns getNumVertices() vertices to fill for the next draws, after the GPU is done with them.
+		/// The memory holds an older frame's vertices, so every vertex must be written. Call once per frame, after the previous frame's draws
+		/// </summary>
+		Vertex* mapVertices();
+		//Number of times mapVertices had to wait on the GPU
+		inline unsigned int getStreamStallCount()const { return m_stream.getStallCount(); }
 		inline int getNumVertices()const { return m_numVertices; }
 		inline int getNumIndices()const { return m_numIndices; }
+		//GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+		inline unsigned int getIndexType()const { return m_indexType; }
+		//Object space, taken from the loaded data. Use TransformAABB / TransformBoundingSphere for world space
+		inline const ew::AABB& getBounds()const { return m_bounds; }
+		inline const ew::BoundingSphere& getBoundingSphere()const { return m_boundingSphere; }
+		//For vertices changed through updateVertices or mapVertices
+		inline void setBounds(const ew::AABB& bounds, const ew::BoundingSphere& boundingSphere) { m_bounds = bounds; m_boundingSphere = boundingSphere; }
 	private:
+		void bindBuffers();
+		void bindInstanceAttributes(const InstanceBuffer& instances)const;
+		void bindVertexStorage(size_t size);
+		void uploadVertices(const void* data, size_t size);
+		void loadVertices(const Vertex* vertices, size_t numVertices);
+		void uploadIndices(const std::vector<unsigned int>& indices, size_t numVertices);
+		void uploadIndices(const void* indices, size_t numIndices, unsigned int indexType);
 		bool m_initialized = false;
+		MeshUsage m_usage = MeshUsage::STATIC;
 		unsigned int m_vao = 0;
 		unsigned int m_vbo = 0;
 		unsigned int m_ebo = 0;
 		int m_numVertices = 0;
 		int m_numIndices = 0;
+		unsigned int m_indexType = 0x1405; //GL_UNSIGNED_INT
+		size_t m_vertexCapacity = 0; //Bytes, DYNAMIC
+		size_t m_indexCapacity = 0; //Bytes, DYNAMIC
+		size_t m_vertexStride = sizeof(Vertex); //Bytes, a PackedMeshData's stride after loading one
+		unsigned int m_stagingBuffer = 0; //Source of updateVertices copies
+		size_t m_stagingCapacity = 0; //Bytes
+		StreamBuffer m_stream;
+		int m_baseVertex = 0; //First vertex of the current STREAM section
+		ew::AABB m_bounds;
+		ew::BoundingSphere m_boundingSphere;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,21 @@
+#include "meshAdjacency.h"
+#include <algorithm>
+
+namespace ew {
+	void buildVertexTriangleAdjacency(const unsigned int* indices, size_t indexCount, size_t numVertices,
+		std::vector<unsigned int>* offsets, std::vector<unsigned int>* adjacency)
+	{
+		offsets->assign(numVertices + 1, 0);
+		for (size_t i = 0; i < indexCount; i++) {
+			(*offsets)[indices[i] + 1]++;
+		}
+		for (size_t v = 0; v < numVertices; v++) {
+			(*offsets)[v + 1] += (*offsets)[v];
+		}
+		adjacency->resize(indexCount);
+		std::vector<unsigned int> fill(offsets->begin(), offsets->end() - 1);
+		for (size_t i = 0; i < indexCount; i++) {
+			(*adjacency)[fill[indices[i]]++] = (unsigned int)(i / 3);
+		}
+	}
+}
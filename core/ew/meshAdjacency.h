@@ -0,0 +1,13 @@
+#pragma once
+#include <vector>
+#include <stddef.h>
+
+namespace ew {
+	/// <summary>
+	/// Vertex -> triangle adjacency in compressed sparse row form, shared by the mesh processing passes.
+	/// The triangles using vertex v are adjacency[offsets[v]] up to adjacency[offsets[v + 1]], in ascending order.
+	/// Reuses the storage of both vectors
+	/// </summary>
+	void buildVertexTriangleAdjacency(const unsigned int* indices, size_t indexCount, size_t numVertices,
+		std::vector<unsigned int>* offsets, std::vector<unsigned int>* adjacency);
+}
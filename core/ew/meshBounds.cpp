@@ -0,0 +1,197 @@
+#include "meshBounds.h"
+#include <math.h>
+#include <float.h>
+
+namespace ew {
+	//Positions are loaded 4 floats at a time, reading into the normal
+	static_assert(offsetof(Vertex, pos) + 4 * sizeof(float) <= sizeof(Vertex), "Vertex position loads would read past the vertex");
+
+	ew::AABB ComputeAABB(const Vertex* vertices, size_t count)
+	{
+		ew::AABB box;
+		if (count == 0)
+			return box;
+#if defined(EW_MATH_SSE)
+		//Four independent accumulators hide the min/max latency
+		__m128 min0 = _mm_loadu_ps(&vertices[0].pos.x);
+		__m128 max0 = min0, min1 = min0, max1 = min0, min2 = min0, max2 = min0, min3 = min0, max3 = min0;
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			__m128 p0 = _mm_loadu_ps(&vertices[i].pos.x);
+			__m128 p1 = _mm_loadu_ps(&vertices[i + 1].pos.x);
+			__m128 p2 = _mm_loadu_ps(&vertices[i + 2].pos.x);
+			__m128 p3 = _mm_loadu_ps(&vertices[i + 3].pos.x);
+			min0 = _mm_min_ps(min0, p0); max0 = _mm_max_ps(max0, p0);
+			min1 = _mm_min_ps(min1, p1); max1 = _mm_max_ps(max1, p1);
+			min2 = _mm_min_ps(min2, p2); max2 = _mm_max_ps(max2, p2);
+			min3 = _mm_min_ps(min3, p3); max3 = _mm_max_ps(max3, p3);
+		}
+		for (; i < count; i++) {
+			__m128 p = _mm_loadu_ps(&vertices[i].pos.x);
+			min0 = _mm_min_ps(min0, p);
+			max0 = _mm_max_ps(max0, p);
+		}
+		float min[4], max[4];
+		_mm_storeu_ps(min, _mm_min_ps(_mm_min_ps(min0, min1), _mm_min_ps(min2, min3)));
+		_mm_storeu_ps(max, _mm_max_ps(_mm_max_ps(max0, max1), _mm_max_ps(max2, max3)));
+		box.min = ew::Vec3(min[0], min[1], min[2]);
+		box.max = ew::Vec3(max[0], max[1], max[2]);
+#else
+		box.min = box.max = vertices[0].pos;
+		for (size_t i = 1; i < count; i++) {
+			const ew::Vec3& p = vertices[i].pos;
+			box.min = ew::Vec3(fminf(box.min.x, p.x), fminf(box.min.y, p.y), fminf(box.min.z, p.z));
+			box.max = ew::Vec3(fmaxf(box.max.x, p.x), fmaxf(box.max.y, p.y), fmaxf(box.max.z, p.z));
+		}
+#endif
+		return box;
+	}
+
+#if defined(EW_MATH_SSE)
+	//Squared distances of 4 consecutive vertices to a point
+	static inline __m128 distanceSq4(const Vertex* vertices, __m128 cx, __m128 cy, __m128 cz)
+	{
+		__m128 p0 = _mm_loadu_ps(&vertices[0].pos.x);
+		__m128 p1 = _mm_loadu_ps(&vertices[1].pos.x);
+		__m128 p2 = _mm_loadu_ps(&vertices[2].pos.x);
+		__m128 p3 = _mm_loadu_ps(&vertices[3].pos.x);
+		_MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+		__m128 dx = _mm_sub_ps(p0, cx);
+		__m128 dy = _mm_sub_ps(p1, cy);
+		__m128 dz = _mm_sub_ps(p2, cz);
+		return _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+	}
+#endif
+
+	static float maxDistanceSq(const Vertex* vertices, size_t count, const ew::Vec3& center)
+	{
+		float result = 0.0f;
+		size_t i = 0;
+#if defined(EW_MATH_SSE)
+		__m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+		__m128 maxSq = _mm_setzero_ps();
+		for (; i + 4 <= count; i += 4) {
+			maxSq = _mm_max_ps(maxSq, distanceSq4(&vertices[i], cx, cy, cz));
+		}
+		maxSq = _mm_max_ps(maxSq, EW_SWIZZLE(maxSq, 2, 3, 0, 1));
+		maxSq = _mm_max_ps(maxSq, EW_SWIZZLE(maxSq, 1, 0, 3, 2));
+		result = _mm_cvtss_f32(maxSq);
+#endif
+		for (; i < count; i++) {
+			ew::Vec3 d = vertices[i].pos - center;
+			result = fmaxf(result, ew::Dot(d, d));
+		}
+		return result;
+	}
+
+	//Grows sphere just enough to contain p
+	static inline void growSphere(ew::BoundingSphere* sphere, const ew::Vec3& p)
+	{
+		ew::Vec3 d = p - sphere->center;
+		float distanceSq = ew::Dot(d, d);
+		if (distanceSq <= sphere->radius * sphere->radius)
+			return;
+		float distance = sqrtf(distanceSq);
+		float radius = (sphere->radius + distance) * 0.5f;
+		sphere->center += d * ((radius - sphere->radius) / distance);
+		sphere->radius = radius;
+	}
+
+	//Vertices this little outside the sphere do not grow it. The final pass over all vertices covers them
+	const float GROW_TOLERANCE = 1e-4f;
+
+	/// <summary>
+	/// Only vertices clearly outside the current sphere take the slow path, so after the first few
+	/// growth steps this is one SIMD distance test per 4 vertices
+	/// </summary>
+	static void growSphere(ew::BoundingSphere* sphere, const Vertex* vertices, size_t count)
+	{
+		size_t i = 0;
+#if defined(EW_MATH_SSE)
+		__m128 cx = _mm_set1_ps(sphere->center.x), cy = _mm_set1_ps(sphere->center.y), cz = _mm_set1_ps(sphere->center.z);
+		float limit = sphere->radius * (1.0f + GROW_TOLERANCE);
+		__m128 limitSq = _mm_set1_ps(limit * limit);
+		for (; i + 4 <= count; i += 4) {
+			if (_mm_movemask_ps(_mm_cmpgt_ps(distanceSq4(&vertices[i], cx, cy, cz), limitSq)) == 0)
+				continue;
+			for (size_t k = 0; k < 4; k++) {
+				growSphere(sphere, vertices[i + k].pos);
+			}
+			cx = _mm_set1_ps(sphere->center.x), cy = _mm_set1_ps(sphere->center.y), cz = _mm_set1_ps(sphere->center.z);
+			limit = sphere->radius * (1.0f + GROW_TOLERANCE);
+			limitSq = _mm_set1_ps(limit * limit);
+		}
+#endif
+		for (; i < count; i++) {
+			growSphere(sphere, vertices[i].pos);
+		}
+	}
+
+	static ew::BoundingSphere boundingSphere(const Vertex* vertices, size_t count, const ew::AABB& box)
+	{
+		ew::BoundingSphere sphere;
+		if (count == 0)
+			return sphere;
+
+		//Vertices at the box's faces. Bits 0-2 of found are the min faces, 3-5 the max faces
+		const float boxMin[3] = { box.min.x, box.min.y, box.min.z };
+		const float boxMax[3] = { box.max.x, box.max.y, box.max.z };
+		size_t minIndex[3] = { 0, 0, 0 }, maxIndex[3] = { 0, 0, 0 };
+		unsigned int found = 0;
+#if defined(EW_MATH_SSE)
+		const __m128 minV = _mm_setr_ps(box.min.x, box.min.y, box.min.z, FLT_MAX);
+		const __m128 maxV = _mm_setr_ps(box.max.x, box.max.y, box.max.z, -FLT_MAX);
+#endif
+		for (size_t i = 0; i < count && found != 0x3f; i++) {
+#if defined(EW_MATH_SSE)
+			//Lane 3 holds normal.x and never matches the sentinels
+			__m128 p = _mm_loadu_ps(&vertices[i].pos.x);
+			unsigned int faces = (unsigned int)_mm_movemask_ps(_mm_cmpeq_ps(p, minV)) | ((unsigned int)_mm_movemask_ps(_mm_cmpeq_ps(p, maxV)) << 3);
+			if ((faces & ~found) == 0)
+				continue;
+#endif
+			const float p3[3] = { vertices[i].pos.x, vertices[i].pos.y, vertices[i].pos.z };
+			for (int axis = 0; axis < 3; axis++) {
+				if (!(found & (1u << axis)) && p3[axis] == boxMin[axis]) {
+					minIndex[axis] = i;
+					found |= 1u << axis;
+				}
+				if (!(found & (8u << axis)) && p3[axis] == boxMax[axis]) {
+					maxIndex[axis] = i;
+					found |= 8u << axis;
+				}
+			}
+		}
+		float bestSq = -1.0f;
+		for (int axis = 0; axis < 3; axis++) {
+			ew::Vec3 d = vertices[maxIndex[axis]].pos - vertices[minIndex[axis]].pos;
+			if (ew::Dot(d, d) > bestSq) {
+				bestSq = ew::Dot(d, d);
+				sphere.center = (vertices[maxIndex[axis]].pos + vertices[minIndex[axis]].pos) * 0.5f;
+				sphere.radius = sqrtf(bestSq) * 0.5f;
+			}
+		}
+		growSphere(&sphere, vertices, count);
+		sphere.radius = sqrtf(maxDistanceSq(vertices, count, sphere.center));
+
+		ew::BoundingSphere boxSphere;
+		boxSphere.center = box.center();
+		boxSphere.radius = sqrtf(maxDistanceSq(vertices, count, boxSphere.center));
+		if (boxSphere.radius < sphere.radius)
+			sphere = boxSphere;
+		//Absorb rounding, so distances computed elsewhere never come out larger
+		sphere.radius *= 1.0f + 4.0f * FLT_EPSILON;
+		return sphere;
+	}
+
+	ew::BoundingSphere ComputeBoundingSphere(const Vertex* vertices, size_t count)
+	{
+		return boundingSphere(vertices, count, ComputeAABB(vertices, count));
+	}
+
+	void computeBounds(MeshData* meshData)
+	{
+		meshData->bounds = ComputeAABB(meshData->vertices.data(), meshData->vertices.size());
+		meshData->boundingSphere = boundingSphere(meshData->vertices.data(), meshData->vertices.size(), meshData->bounds);
+	}
+}
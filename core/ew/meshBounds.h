@@ -0,0 +1,18 @@
+#pragma once
+#include "mesh.h"
+#include "ewMath/bounds.h"
+
+namespace ew {
+	//Box around the vertex positions. SSE min/max reduction when available
+	ew::AABB ComputeAABB(const Vertex* vertices, size_t count);
+
+	/// <summary>
+	/// Ritter's bounding sphere, seeded with the most distant pair of axis extreme vertices,
+	/// compared against the sphere around the box center. Returns the smaller of the two.
+	/// Within a few percent of the minimal sphere for typical meshes
+	/// </summary>
+	ew::BoundingSphere ComputeBoundingSphere(const Vertex* vertices, size_t count);
+
+	//Fills meshData->bounds and meshData->boundingSphere from its vertices
+	void computeBounds(MeshData* meshData);
+}
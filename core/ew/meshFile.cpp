@@ -0,0 +1,227 @@
+#include "meshFile.h"
+#include "meshBounds.h"
+#include <stdio.h>
+#include <fstream>
+#include <filesystem>
+
+namespace ew {
+	static_assert(sizeof(MeshFileHeader) == 80, "MeshFileHeader layout changed, bump MESH_FILE_VERSION");
+	static_assert(sizeof(MeshFileLOD) == 32, "MeshFileLOD layout changed, bump MESH_FILE_VERSION");
+
+	const unsigned int INDEX_TYPE_SHORT = 0x1403; //GL_UNSIGNED_SHORT
+	const unsigned int INDEX_TYPE_INT = 0x1405; //GL_UNSIGNED_INT
+
+	const uint64_t FNV64_OFFSET = 14695981039346656037ull;
+	const uint64_t FNV64_PRIME = 1099511628211ull;
+
+	//64 bit FNV-1a, continued from hash. The size is mixed in too, so moving bytes between arrays changes the hash
+	static uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= FNV64_PRIME;
+		}
+		for (size_t i = 0, length = size; i < sizeof(length); i++, length >>= 8) {
+			hash ^= length & 0xff;
+			hash *= FNV64_PRIME;
+		}
+		return hash;
+	}
+
+	uint64_t hashMeshSource(const MeshData& meshData, const std::vector<float>& settings)
+	{
+		uint64_t hash = FNV64_OFFSET;
+		hash = hashBytes(hash, meshData.vertices.data(), sizeof(Vertex) * meshData.vertices.size());
+		hash = hashBytes(hash, meshData.indices.data(), sizeof(unsigned int) * meshData.indices.size());
+		hash = hashBytes(hash, settings.data(), sizeof(float) * settings.size());
+		//0 means unknown in the header
+		return hash != 0 ? hash : 1;
+	}
+
+	static uint64_t alignOffset(uint64_t offset)
+	{
+		return (offset + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT;
+	}
+
+	static void writePadding(std::ofstream& file, uint64_t* offset)
+	{
+		static const char zeros[MESH_FILE_ALIGNMENT] = {};
+		uint64_t aligned = alignOffset(*offset);
+		file.write(zeros, (std::streamsize)(aligned - *offset));
+		*offset = aligned;
+	}
+
+	/// <summary>
+	/// Lays out the header and LOD table first, then writes every blob at its precomputed offset
+	/// </summary>
+	bool writeMeshFile(const std::string& filePath, const std::vector<MeshLOD>& lods, uint64_t sourceHash)
+	{
+		MeshFileHeader header;
+		header.headerSize = sizeof(MeshFileHeader);
+		header.sourceHash = sourceHash;
+		header.vertexStride = sizeof(Vertex);
+		header.numLODs = (uint32_t)lods.size();
+		//Recomputed rather than trusted, the MeshData may have been edited since its bounds were set
+		if (!lods.empty()) {
+			const std::vector<Vertex>& vertices = lods[0].meshData.vertices;
+			header.bounds = ComputeAABB(vertices.data(), vertices.size());
+			header.sphere = ComputeBoundingSphere(vertices.data(), vertices.size());
+		}
+
+		std::vector<MeshFileLOD> table(lods.size());
+		uint64_t offset = sizeof(MeshFileHeader) + sizeof(MeshFileLOD) * lods.size();
+		for (size_t i = 0; i < lods.size(); i++) {
+			const MeshData& meshData = lods[i].meshData;
+			MeshFileLOD& entry = table[i];
+			entry.numVertices = (uint32_t)meshData.vertices.size();
+			entry.numIndices = (uint32_t)meshData.indices.size();
+			entry.indexType = meshData.vertices.size() <= MAX_SHORT_INDEX_VERTICES ? INDEX_TYPE_SHORT : INDEX_TYPE_INT;
+			entry.error = lods[i].error;
+			entry.vertexOffset = alignOffset(offset);
+			offset = entry.vertexOffset + sizeof(Vertex) * entry.numVertices;
+			entry.indexOffset = alignOffset(offset);
+			offset = entry.indexOffset + (entry.indexType == INDEX_TYPE_SHORT ? sizeof(uint16_t) : sizeof(uint32_t)) * entry.numIndices;
+		}
+		header.fileSize = offset;
+
+		std::filesystem::path directory = std::filesystem::path(filePath).parent_path();
+		if (!directory.empty()) {
+			std::error_code error;
+			std::filesystem::create_directories(directory, error);
+		}
+		std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			printf("Failed to write mesh file %s\n", filePath.c_str());
+			return false;
+		}
+		file.write((const char*)&header, sizeof(MeshFileHeader));
+		file.write((const char*)table.data(), (std::streamsize)(sizeof(MeshFileLOD) * table.size()));
+		offset = sizeof(MeshFileHeader) + sizeof(MeshFileLOD) * table.size();
+		std::vector<uint16_t> shortIndices;
+		for (size_t i = 0; i < lods.size(); i++) {
+			const MeshData& meshData = lods[i].meshData;
+			writePadding(file, &offset);
+			file.write((const char*)meshData.vertices.data(), (std::streamsize)(sizeof(Vertex) * meshData.vertices.size()));
+			offset += sizeof(Vertex) * meshData.vertices.size();
+			writePadding(file, &offset);
+			if (table[i].indexType == INDEX_TYPE_SHORT) {
+				shortIndices.assign(meshData.indices.begin(), meshData.indices.end());
+				file.write((const char*)shortIndices.data(), (std::streamsize)(sizeof(uint16_t) * shortIndices.size()));
+				offset += sizeof(uint16_t) * shortIndices.size();
+			}
+			else {
+				file.write((const char*)meshData.indices.data(), (std::streamsize)(sizeof(uint32_t) * meshData.indices.size()));
+				offset += sizeof(uint32_t) * meshData.indices.size();
+			}
+		}
+		if (!file.good()) {
+			printf("Failed to write mesh file %s\n", filePath.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	bool writeMeshFile(const std::string& filePath, const MeshData& meshData, uint64_t sourceHash)
+	{
+		std::vector<MeshLOD> lods(1);
+		lods[0].meshData = meshData;
+		return writeMeshFile(filePath, lods, sourceHash);
+	}
+
+	MeshFile::MeshFile(const std::string& filePath)
+	{
+		open(filePath);
+	}
+
+	/// <summary>
+	/// Only the header and LOD table are touched. Every blob range is checked against the file size,
+	/// so a truncated file fails here instead of faulting during upload
+	/// </summary>
+	bool MeshFile::open(const std::string& filePath)
+	{
+		close();
+		if (!m_file.open(filePath))
+			return false;
+		const unsigned char* data = m_file.data();
+		const uint64_t size = m_file.size();
+		const MeshFileHeader* header = (const MeshFileHeader*)data;
+		bool valid = size >= sizeof(MeshFileHeader)
+			&& header->magic == MESH_FILE_MAGIC
+			&& header->version == MESH_FILE_VERSION
+			&& header->headerSize == sizeof(MeshFileHeader)
+			&& header->vertexStride == sizeof(Vertex)
+			&& header->fileSize == size
+			&& sizeof(MeshFileHeader) + sizeof(MeshFileLOD) * (uint64_t)header->numLODs <= size;
+		const MeshFileLOD* lods = (const MeshFileLOD*)(data + sizeof(MeshFileHeader));
+		for (uint32_t i = 0; valid && i < header->numLODs; i++) {
+			const MeshFileLOD& lod = lods[i];
+			uint64_t indexSize = lod.indexType == INDEX_TYPE_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+			valid = (lod.indexType == INDEX_TYPE_SHORT || lod.indexType == INDEX_TYPE_INT)
+				&& lod.vertexOffset <= size && lod.indexOffset <= size
+				&& lod.vertexOffset % MESH_FILE_ALIGNMENT == 0
+				&& lod.indexOffset % MESH_FILE_ALIGNMENT == 0
+				&& lod.vertexOffset + sizeof(Vertex) * (uint64_t)lod.numVertices <= size
+				&& lod.indexOffset + indexSize * lod.numIndices <= size;
+		}
+		if (!valid) {
+			printf("Invalid or outdated mesh file %s\n", filePath.c_str());
+			m_file.close();
+			return false;
+		}
+		m_header = header;
+		m_lods = lods;
+		return true;
+	}
+
+	bool MeshFile::open(const std::string& filePath, uint64_t sourceHash)
+	{
+		if (!open(filePath))
+			return false;
+		if (m_header->sourceHash != sourceHash) {
+			printf("Mesh file %s was generated from another source\n", filePath.c_str());
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void MeshFile::close()
+	{
+		m_file.close();
+		m_header = nullptr;
+		m_lods = nullptr;
+	}
+
+	MeshDataView MeshFile::getLOD(int level) const
+	{
+		const MeshFileLOD& lod = m_lods[level];
+		MeshDataView view;
+		view.vertices = (const Vertex*)(m_file.data() + lod.vertexOffset);
+		view.numVertices = lod.numVertices;
+		view.indices = m_file.data() + lod.indexOffset;
+		view.numIndices = lod.numIndices;
+		view.indexType = lod.indexType;
+		//Levels only use positions of level 0, so its bounds hold for all of them
+		view.bounds = m_header->bounds;
+		view.boundingSphere = m_header->sphere;
+		return view;
+	}
+
+	MeshData MeshFile::toMeshData(int level) const
+	{
+		MeshDataView view = getLOD(level);
+		MeshData meshData;
+		meshData.vertices.assign(view.vertices, view.vertices + view.numVertices);
+		if (view.indexType == INDEX_TYPE_SHORT) {
+			const uint16_t* indices = (const uint16_t*)view.indices;
+			meshData.indices.assign(indices, indices + view.numIndices);
+		}
+		else {
+			const uint32_t* indices = (const uint32_t*)view.indices;
+			meshData.indices.assign(indices, indices + view.numIndices);
+		}
+		computeBounds(&meshData);
+		return meshData;
+	}
+}
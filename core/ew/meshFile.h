@@ -0,0 +1,85 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include "mesh.h"
+#include "mappedFile.h"
+#include "meshSimplifier.h"
+#include "ewMath/bounds.h"
+
+namespace ew {
+	/*
+		.ewmesh layout, little endian:
+		MeshFileHeader
+		MeshFileLOD[numLODs]
+		Per LOD: vertex blob (Vertex[numVertices]), index blob (uint16 or uint32 [numIndices])
+		Every blob starts on a MESH_FILE_ALIGNMENT boundary, so the mapped pointers can be used as is
+	*/
+	const uint32_t MESH_FILE_MAGIC = 0x534d5745; //"EWMS"
+	const uint32_t MESH_FILE_VERSION = 3;
+	const uint32_t MESH_FILE_ALIGNMENT = 64;
+
+	struct MeshFileHeader {
+		uint32_t magic = MESH_FILE_MAGIC;
+		uint32_t version = MESH_FILE_VERSION;
+		uint32_t headerSize = 0; //sizeof(MeshFileHeader)
+		uint32_t vertexStride = 0; //sizeof(Vertex)
+		uint32_t numLODs = 0;
+		uint32_t reserved = 0;
+		uint64_t fileSize = 0;
+		uint64_t sourceHash = 0; //hashMeshSource of what the file was generated from, 0 if unknown
+		ew::AABB bounds; //Object space, level 0
+		ew::BoundingSphere sphere;
+	};
+
+	struct MeshFileLOD {
+		uint64_t vertexOffset = 0; //Bytes from the start of the file
+		uint64_t indexOffset = 0;
+		uint32_t numVertices = 0;
+		uint32_t numIndices = 0;
+		uint32_t indexType = 0; //GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+		float error = 0; //Object space, see MeshLOD
+	};
+
+	/// <summary>
+	/// 64 bit FNV-1a of a mesh's vertices and indices, and of the settings it was processed with (e.g. LOD levels and reduction).
+	/// Stored in generated files, so a cache built from other data or settings is detected and regenerated
+	/// </summary>
+	uint64_t hashMeshSource(const MeshData& meshData, const std::vector<float>& settings = {});
+
+	/// <summary>
+	/// Writes levels of a LOD chain, level 0 being the full detail mesh. Missing parent directories are created.
+	/// Indices are stored as 16 bit when a level has at most MAX_SHORT_INDEX_VERTICES vertices, matching what Mesh uploads
+	/// </summary>
+	bool writeMeshFile(const std::string& filePath, const std::vector<MeshLOD>& lods, uint64_t sourceHash = 0);
+	bool writeMeshFile(const std::string& filePath, const MeshData& meshData, uint64_t sourceHash = 0);
+
+	/// <summary>
+	/// Memory mapped .ewmesh file. Nothing is parsed or copied: getLOD returns pointers into the mapping,
+	/// which Mesh::load passes straight to glBufferData. Pages are read from disk as the upload touches them
+	/// </summary>
+	class MeshFile {
+	public:
+		MeshFile() {};
+		MeshFile(const std::string& filePath);
+		//Fails if the file is missing, from another version, or truncated
+		bool open(const std::string& filePath);
+		//Also fails if the file was generated from another source, see hashMeshSource
+		bool open(const std::string& filePath, uint64_t sourceHash);
+		void close();
+		inline bool isOpen()const { return m_header != nullptr; }
+		inline int getNumLODs()const { return m_header ? (int)m_header->numLODs : 0; }
+		//Valid while the file is open
+		MeshDataView getLOD(int level)const;
+		inline float getLODError(int level)const { return m_lods[level].error; }
+		inline const ew::AABB& getBounds()const { return m_header->bounds; }
+		inline const ew::BoundingSphere& getBoundingSphere()const { return m_header->sphere; }
+		inline uint64_t getSourceHash()const { return m_header->sourceHash; }
+		//Copies a level out of the file, for CPU side processing
+		MeshData toMeshData(int level)const;
+	private:
+		MappedFile m_file;
+		const MeshFileHeader* m_header = nullptr;
+		const MeshFileLOD* m_lods = nullptr;
+	};
+}
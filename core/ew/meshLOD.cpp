@@ -0,0 +1,82 @@
+#include "meshLOD.h"
+#include <math.h>
+
+namespace ew {
+	float ScreenSpaceSize(const Camera& camera, const ew::Vec3& worldPosition, float worldSize, float screenHeight)
+	{
+		if (camera.orthographic) {
+			return worldSize / camera.orthoHeight * screenHeight;
+		}
+		float distance = ew::Magnitude(worldPosition - camera.position);
+		if (distance < camera.nearPlane)
+			distance = camera.nearPlane;
+		//Height of the view volume at that distance
+		float viewHeight = 2.0f * distance * tanf(ew::Radians(camera.fov) * 0.5f);
+		return worldSize / viewHeight * screenHeight;
+	}
+
+	MeshLODSet::MeshLODSet(const MeshData& meshData, unsigned int maxLevels, float reductionPerLevel)
+	{
+		load(meshData, maxLevels, reductionPerLevel);
+	}
+
+	void MeshLODSet::load(const MeshData& meshData, unsigned int maxLevels, float reductionPerLevel)
+	{
+		load(generateLODChain(meshData, maxLevels, reductionPerLevel));
+	}
+
+	void MeshLODSet::load(const std::vector<MeshLOD>& lods)
+	{
+		//Buffers of previous levels are reused where possible
+		m_levels.resize(lods.size());
+		m_errors.resize(lods.size());
+		for (size_t i = 0; i < lods.size(); i++) {
+			m_levels[i].load(lods[i].meshData);
+			m_errors[i] = lods[i].error;
+		}
+	}
+
+	void MeshLODSet::load(const MeshFile& meshFile)
+	{
+		m_levels.resize(meshFile.getNumLODs());
+		m_errors.resize(meshFile.getNumLODs());
+		for (int i = 0; i < meshFile.getNumLODs(); i++) {
+			m_levels[i].load(meshFile.getLOD(i));
+			m_errors[i] = meshFile.getLODError(i);
+		}
+	}
+
+	/// <summary>
+	/// Levels are ordered by increasing error, so the coarsest acceptable one is found walking back from the end
+	/// </summary>
+	int MeshLODSet::selectLevel(const Camera& camera, const ew::Vec3& worldPosition, float worldScale, float screenHeight, float maxPixelError) const
+	{
+		for (int level = (int)m_levels.size() - 1; level > 0; level--) {
+			if (ScreenSpaceSize(camera, worldPosition, m_errors[level] * worldScale, screenHeight) <= maxPixelError)
+				return level;
+		}
+		return 0;
+	}
+
+	void MeshLODSet::draw(int level, DrawMode drawMode) const
+	{
+		if (m_levels.empty())
+			return;
+		if (level < 0)
+			level = 0;
+		if (level >= (int)m_levels.size())
+			level = (int)m_levels.size() - 1;
+		m_levels[level].draw(drawMode);
+	}
+
+	void MeshLODSet::drawInstanced(int level, const InstanceBuffer& instances, size_t first, size_t count, DrawMode drawMode) const
+	{
+		if (m_levels.empty())
+			return;
+		if (level < 0)
+			level = 0;
+		if (level >= (int)m_levels.size())
+			level = (int)m_levels.size() - 1;
+		m_levels[level].drawInstanced(instances, first, count, drawMode);
+	}
+}
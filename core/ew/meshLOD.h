@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include "mesh.h"
+#include "camera.h"
+#include "meshSimplifier.h"
+#include "meshFile.h"
+
+namespace ew {
+	//Height in pixels of a world space distance at worldPosition, as seen by camera
+	float ScreenSpaceSize(const Camera& camera, const ew::Vec3& worldPosition, float worldSize, float screenHeight);
+
+	/// <summary>
+	/// One GPU mesh per level of a LOD chain. Pick a level per object with selectLevel, then draw it
+	/// </summary>
+	class MeshLODSet {
+	public:
+		MeshLODSet() {};
+		MeshLODSet(const MeshData& meshData, unsigned int maxLevels = 4, float reductionPerLevel = 0.25f);
+		void load(const MeshData& meshData, unsigned int maxLevels = 4, float reductionPerLevel = 0.25f);
+		void load(const std::vector<MeshLOD>& lods);
+		//Uploads every level straight from the mapped file
+		void load(const MeshFile& meshFile);
+		//Coarsest level whose simplification error stays under maxPixelError on screen. worldScale is the object's largest scale axis
+		int selectLevel(const Camera& camera, const ew::Vec3& worldPosition, float worldScale, float screenHeight, float maxPixelError = 1.0f)const;
+		void draw(int level, DrawMode drawMode = DrawMode::TRIANGLES)const;
+		//Instances first to first + count - 1 of the buffer with one level. Group instances by level to draw each level once
+		void drawInstanced(int level, const InstanceBuffer& instances, size_t first, size_t count, DrawMode drawMode = DrawMode::TRIANGLES)const;
+		inline int getNumLevels()const { return (int)m_levels.size(); }
+		inline const Mesh& getLevel(int level)const { return m_levels[level]; }
+		//Object space units
+		inline float getLevelError(int level)const { return m_errors[level]; }
+	private:
+		std::vector<Mesh> m_levels;
+		std::vector<float> m_errors;
+	};
+}
@@ -0,0 +1,416 @@
+#include "meshOptimizer.h"
+#include "meshBounds.h"
+#include "meshAdjacency.h"
+#include <math.h>
+#include <algorithm>
+#include <stdint.h>
+#include <unordered_map>
+
+namespace ew {
+	//Forsyth scoring constants
+	static const unsigned int MAX_CACHE_SIZE = 64;
+	static const float CACHE_DECAY_POWER = 1.5f;
+	static const float LAST_TRI_SCORE = 0.75f;
+	static const float VALENCE_BOOST_SCALE = 2.0f;
+	static const float VALENCE_BOOST_POWER = 0.5f;
+
+	static float vertexScore(int cachePosition, unsigned int remainingTriangles, unsigned int cacheSize) {
+		if (remainingTriangles == 0)
+			return -1.0f;
+		float score = 0.0f;
+		if (cachePosition >= 0) {
+			if (cachePosition < 3) {
+				//Vertices of the last triangle get a fixed score so the next triangle does not just reuse the same edge
+				score = LAST_TRI_SCORE;
+			}
+			else {
+				float scaler = 1.0f / (cacheSize - 3);
+				score = powf(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+			}
+		}
+		//Prefer vertices with few triangles left, so they can be finished and leave the cache
+		score += VALENCE_BOOST_SCALE * powf((float)remainingTriangles, -VALENCE_BOOST_POWER);
+		return score;
+	}
+
+	void optimizeVertexCache(MeshData* mesh, unsigned int cacheSize)
+	{
+		std::vector<unsigned int>& indices = mesh->indices;
+		const size_t numTriangles = indices.size() / 3;
+		const size_t numVertices = mesh->vertices.size();
+		if (numTriangles == 0)
+			return;
+		cacheSize = std::min(std::max(cacheSize, 4u), MAX_CACHE_SIZE);
+
+		std::vector<unsigned int> offsets, adjacency;
+		buildVertexTriangleAdjacency(indices.data(), numTriangles * 3, numVertices, &offsets, &adjacency);
+		std::vector<unsigned int> remaining(numVertices);
+		for (size_t v = 0; v < numVertices; v++) {
+			remaining[v] = offsets[v + 1] - offsets[v];
+		}
+
+		std::vector<float> vScore(numVertices);
+		for (size_t v = 0; v < numVertices; v++) {
+			vScore[v] = vertexScore(-1, remaining[v], cacheSize);
+		}
+		std::vector<float> tScore(numTriangles);
+		std::vector<bool> emitted(numTriangles, false);
+		for (size_t t = 0; t < numTriangles; t++) {
+			tScore[t] = vScore[indices[t * 3]] + vScore[indices[t * 3 + 1]] + vScore[indices[t * 3 + 2]];
+		}
+
+		std::vector<unsigned int> output;
+		output.reserve(numTriangles * 3);
+		std::vector<unsigned int> cache, newCache;
+		cache.reserve(cacheSize + 3);
+		newCache.reserve(cacheSize + 3);
+		size_t scanCursor = 0; //For the fallback search when nothing in the cache is usable
+
+		size_t bestTriangle = std::max_element(tScore.begin(), tScore.end()) - tScore.begin();
+		for (size_t emittedCount = 0; emittedCount < numTriangles; emittedCount++)
+		{
+			if (bestTriangle == (size_t)-1) {
+				while (emitted[scanCursor])
+					scanCursor++;
+				bestTriangle = scanCursor;
+			}
+			emitted[bestTriangle] = true;
+			const unsigned int* tri = &indices[bestTriangle * 3];
+			output.insert(output.end(), tri, tri + 3);
+
+			//Remove the triangle from its vertices' adjacency lists
+			for (int k = 0; k < 3; k++) {
+				unsigned int v = tri[k];
+				unsigned int* begin = &adjacency[offsets[v]];
+				unsigned int* end = begin + remaining[v];
+				unsigned int* it = std::find(begin, end, (unsigned int)bestTriangle);
+				if (it != end) {
+					*it = *(end - 1);
+					remaining[v]--;
+				}
+			}
+
+			//New cache: this triangle's vertices first, then the old contents
+			newCache.assign(tri, tri + 3);
+			for (unsigned int v : cache) {
+				if (v != tri[0] && v != tri[1] && v != tri[2])
+					newCache.push_back(v);
+			}
+			if (newCache.size() > cacheSize) {
+				//Evicted vertices still need their score updated
+				for (size_t i = cacheSize; i < newCache.size(); i++) {
+					unsigned int v = newCache[i];
+					vScore[v] = vertexScore(-1, remaining[v], cacheSize);
+					for (unsigned int a = offsets[v]; a < offsets[v] + remaining[v]; a++) {
+						unsigned int t = adjacency[a];
+						tScore[t] = vScore[indices[t * 3]] + vScore[indices[t * 3 + 1]] + vScore[indices[t * 3 + 2]];
+					}
+				}
+				newCache.resize(cacheSize);
+			}
+			cache.swap(newCache);
+
+			//Rescore everything in the cache and pick the best triangle among their neighbours
+			for (size_t i = 0; i < cache.size(); i++) {
+				unsigned int v = cache[i];
+				vScore[v] = vertexScore((int)i, remaining[v], cacheSize);
+			}
+			bestTriangle = (size_t)-1;
+			float bestScore = -1.0f;
+			for (unsigned int v : cache) {
+				for (unsigned int a = offsets[v]; a < offsets[v] + remaining[v]; a++) {
+					unsigned int t = adjacency[a];
+					float s = vScore[indices[t * 3]] + vScore[indices[t * 3 + 1]] + vScore[indices[t * 3 + 2]];
+					tScore[t] = s;
+					if (s > bestScore) {
+						bestScore = s;
+						bestTriangle = t;
+					}
+				}
+			}
+		}
+		indices.swap(output);
+	}
+
+	void optimizeOverdraw(MeshData* mesh, unsigned int trianglesPerCluster)
+	{
+		const std::vector<Vertex>& vertices = mesh->vertices;
+		const std::vector<unsigned int>& indices = mesh->indices;
+		const size_t numTriangles = indices.size() / 3;
+		if (numTriangles == 0 || trianglesPerCluster == 0)
+			return;
+
+		ew::Vec3 meshCenter = ew::Vec3(0.0f);
+		for (const Vertex& v : vertices) {
+			meshCenter += v.pos;
+		}
+		meshCenter /= (float)std::max<size_t>(vertices.size(), 1);
+
+		struct Cluster {
+			size_t firstTriangle;
+			size_t numTriangles;
+			float sortKey;
+		};
+		std::vector<Cluster> clusters;
+		for (size_t first = 0; first < numTriangles; first += trianglesPerCluster)
+		{
+			Cluster c;
+			c.firstTriangle = first;
+			c.numTriangles = std::min<size_t>(trianglesPerCluster, numTriangles - first);
+			//Area weighted centroid and normal
+			ew::Vec3 centroid = ew::Vec3(0.0f);
+			ew::Vec3 normal = ew::Vec3(0.0f);
+			float area = 0.0f;
+			for (size_t t = first; t < first + c.numTriangles; t++) {
+				const ew::Vec3& a = vertices[indices[t * 3]].pos;
+				const ew::Vec3& b = vertices[indices[t * 3 + 1]].pos;
+				const ew::Vec3& d = vertices[indices[t * 3 + 2]].pos;
+				ew::Vec3 n = ew::Cross(b - a, d - a);
+				float triArea = ew::Magnitude(n);
+				centroid += (a + b + d) * (triArea / 3.0f);
+				normal += n;
+				area += triArea;
+			}
+			if (area > 0.0f)
+				centroid /= area;
+			//Clusters facing away from the center are likely in front of the others
+			float normalLength = ew::Magnitude(normal);
+			c.sortKey = normalLength > 0.0f ? ew::Dot(centroid - meshCenter, normal) / normalLength : 0.0f;
+			clusters.push_back(c);
+		}
+		std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+		std::vector<unsigned int> output;
+		output.reserve(indices.size());
+		for (const Cluster& c : clusters) {
+			output.insert(output.end(), indices.begin() + c.firstTriangle * 3, indices.begin() + (c.firstTriangle + c.numTriangles) * 3);
+		}
+		//Cluster boundaries cost some cache hits. Keep the old order if too many are lost
+		const float MAX_ACMR_INCREASE = 1.05f;
+		if (analyzeVertexCache(output, vertices.size()).acmr > analyzeVertexCache(indices, vertices.size()).acmr * MAX_ACMR_INCREASE)
+			return;
+		mesh->indices.swap(output);
+	}
+
+	void optimizeVertexFetch(MeshData* mesh)
+	{
+		const unsigned int UNUSED = 0xffffffff;
+		std::vector<unsigned int> remap(mesh->vertices.size(), UNUSED);
+		std::vector<Vertex> vertices;
+		vertices.reserve(mesh->vertices.size());
+		for (unsigned int& index : mesh->indices) {
+			if (remap[index] == UNUSED) {
+				remap[index] = (unsigned int)vertices.size();
+				vertices.push_back(mesh->vertices[index]);
+			}
+			index = remap[index];
+		}
+		mesh->vertices.swap(vertices);
+	}
+
+	//Vertex shader invocations and bytes fetched, neither worse and at least one better.
+	//Bytes rather than overfetch, since optimizeVertexFetch drops unreferenced vertices and shrinks the buffer
+	static bool improves(const MeshData& optimized, const VertexCacheStats& cacheBefore, const VertexFetchStats& fetchBefore)
+	{
+		VertexCacheStats cacheAfter = analyzeVertexCache(optimized.indices, optimized.vertices.size());
+		VertexFetchStats fetchAfter = analyzeVertexFetch(optimized.indices, optimized.vertices.size());
+		if (cacheAfter.vertexShaderInvocations > cacheBefore.vertexShaderInvocations || fetchAfter.bytesFetched > fetchBefore.bytesFetched)
+			return false;
+		return cacheAfter.vertexShaderInvocations < cacheBefore.vertexShaderInvocations || fetchAfter.bytesFetched < fetchBefore.bytesFetched;
+	}
+
+	/// <summary>
+	/// Meshes that are already well ordered, e.g. procedural strips, can come out worse. The overdraw pass
+	/// is dropped first, then the whole pipeline, so the input is never made slower to draw
+	/// </summary>
+	bool optimizeMesh(MeshData* mesh)
+	{
+		const VertexCacheStats cacheBefore = analyzeVertexCache(mesh->indices, mesh->vertices.size());
+		const VertexFetchStats fetchBefore = analyzeVertexFetch(mesh->indices, mesh->vertices.size());
+		MeshData optimized = *mesh;
+		optimizeVertexCache(&optimized);
+		MeshData withoutOverdraw = optimized;
+		optimizeOverdraw(&optimized);
+		optimizeVertexFetch(&optimized);
+		if (improves(optimized, cacheBefore, fetchBefore)) {
+			mesh->vertices.swap(optimized.vertices);
+			mesh->indices.swap(optimized.indices);
+			return true;
+		}
+		optimizeVertexFetch(&withoutOverdraw);
+		if (improves(withoutOverdraw, cacheBefore, fetchBefore)) {
+			mesh->vertices.swap(withoutOverdraw.vertices);
+			mesh->indices.swap(withoutOverdraw.indices);
+			return true;
+		}
+		return false;
+	}
+
+	VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, size_t numVertices, unsigned int cacheSize)
+	{
+		VertexCacheStats stats;
+		//Timestamp of when each vertex entered the FIFO. In cache while (misses - timestamp) < cacheSize
+		std::vector<unsigned int> enteredAt(numVertices, 0);
+		std::vector<bool> seen(numVertices, false);
+		unsigned int misses = 0;
+		for (unsigned int index : indices) {
+			if (!seen[index] || misses - enteredAt[index] >= cacheSize) {
+				seen[index] = true;
+				enteredAt[index] = misses;
+				misses++;
+			}
+		}
+		stats.vertexShaderInvocations = misses;
+		size_t numTriangles = indices.size() / 3;
+		stats.acmr = numTriangles ? (float)misses / numTriangles : 0.0f;
+		stats.atvr = numVertices ? (float)misses / numVertices : 0.0f;
+		return stats;
+	}
+
+	VertexFetchStats analyzeVertexFetch(const std::vector<unsigned int>& indices, size_t numVertices, size_t vertexSize)
+	{
+		const size_t LINE_SIZE = 64;
+		const size_t NUM_LINES = 64; //4KB fully associative LRU
+		VertexFetchStats stats;
+		std::vector<size_t> lines; //Most recently used at the back
+		lines.reserve(NUM_LINES);
+		for (unsigned int index : indices) {
+			size_t start = index * vertexSize / LINE_SIZE;
+			size_t end = (index * vertexSize + vertexSize - 1) / LINE_SIZE;
+			for (size_t line = start; line <= end; line++) {
+				auto it = std::find(lines.begin(), lines.end(), line);
+				if (it != lines.end()) {
+					lines.erase(it);
+				}
+				else {
+					stats.bytesFetched += LINE_SIZE;
+					if (lines.size() == NUM_LINES)
+						lines.erase(lines.begin());
+				}
+				lines.push_back(line);
+			}
+		}
+		size_t bufferSize = numVertices * vertexSize;
+		stats.overfetch = bufferSize ? (float)stats.bytesFetched / bufferSize : 0.0f;
+		return stats;
+	}
+
+	static inline int64_t weldCell(float value, float cellSize)
+	{
+		return (int64_t)floorf(value / cellSize);
+	}
+
+	//Packs 21 bits of each cell coordinate. Wrapped coordinates only cost extra comparisons
+	static inline uint64_t weldCellKey(int64_t x, int64_t y, int64_t z)
+	{
+		const uint64_t mask = (1ull << 21) - 1;
+		return ((uint64_t)x & mask) | (((uint64_t)y & mask) << 21) | (((uint64_t)z & mask) << 42);
+	}
+
+	static inline bool verticesMatch(const Vertex& a, const Vertex& b, const WeldSettings& settings)
+	{
+		ew::Vec3 d = a.pos - b.pos;
+		if (ew::Dot(d, d) > settings.positionEpsilon * settings.positionEpsilon)
+			return false;
+		if (fabsf(a.normal.x - b.normal.x) > settings.normalEpsilon || fabsf(a.normal.y - b.normal.y) > settings.normalEpsilon
+			|| fabsf(a.normal.z - b.normal.z) > settings.normalEpsilon)
+			return false;
+		return fabsf(a.uv.x - b.uv.x) <= settings.uvEpsilon && fabsf(a.uv.y - b.uv.y) <= settings.uvEpsilon;
+	}
+
+	/// <summary>
+	/// Kept vertices are bucketed in a hash grid with cells of 2 * positionEpsilon, so every vertex within
+	/// epsilon of a position lies in at most 2 cells per axis. Each vertex merges into the first kept vertex it matches
+	/// </summary>
+	WeldStats weldVertices(MeshData* mesh, const WeldSettings& settings)
+	{
+		const unsigned int NONE = 0xffffffff;
+		WeldStats stats;
+		std::vector<Vertex>& vertices = mesh->vertices;
+		std::vector<unsigned int>& indices = mesh->indices;
+		stats.verticesBefore = vertices.size();
+		stats.trianglesBefore = indices.size() / 3;
+
+		const float epsilon = fmaxf(settings.positionEpsilon, 0.0f);
+		//An epsilon of 0 still needs a cell size, only exact matches pass verticesMatch anyway
+		const float cellSize = epsilon > 0.0f ? epsilon * 2.0f : 1e-6f;
+		std::unordered_map<uint64_t, unsigned int> cellHeads; //Cell -> last kept vertex in it
+		cellHeads.reserve(vertices.size());
+		std::vector<unsigned int> cellNext(vertices.size(), NONE); //Previous kept vertex in the same cell
+		std::vector<unsigned int> remap(vertices.size(), NONE);
+		for (unsigned int v = 0; v < vertices.size(); v++)
+		{
+			const ew::Vec3& p = vertices[v].pos;
+			const int64_t min[3] = { weldCell(p.x - epsilon, cellSize), weldCell(p.y - epsilon, cellSize), weldCell(p.z - epsilon, cellSize) };
+			const int64_t max[3] = { weldCell(p.x + epsilon, cellSize), weldCell(p.y + epsilon, cellSize), weldCell(p.z + epsilon, cellSize) };
+			for (int64_t x = min[0]; x <= max[0] && remap[v] == NONE; x++) {
+				for (int64_t y = min[1]; y <= max[1] && remap[v] == NONE; y++) {
+					for (int64_t z = min[2]; z <= max[2] && remap[v] == NONE; z++) {
+						auto cell = cellHeads.find(weldCellKey(x, y, z));
+						if (cell == cellHeads.end())
+							continue;
+						for (unsigned int other = cell->second; other != NONE; other = cellNext[other]) {
+							if (verticesMatch(vertices[v], vertices[other], settings)) {
+								remap[v] = other;
+								break;
+							}
+						}
+					}
+				}
+			}
+			if (remap[v] != NONE)
+				continue;
+			remap[v] = v;
+			uint64_t key = weldCellKey(weldCell(p.x, cellSize), weldCell(p.y, cellSize), weldCell(p.z, cellSize));
+			auto inserted = cellHeads.emplace(key, v);
+			if (!inserted.second) {
+				cellNext[v] = inserted.first->second;
+				inserted.first->second = v;
+			}
+		}
+
+		//Drop degenerate triangles
+		size_t numIndices = 0;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			unsigned int a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+			if (a == b || b == c || a == c)
+				continue;
+			ew::Vec3 ab = vertices[b].pos - vertices[a].pos;
+			ew::Vec3 bc = vertices[c].pos - vertices[b].pos;
+			ew::Vec3 ca = vertices[a].pos - vertices[c].pos;
+			float longestSq = fmaxf(ew::Dot(ab, ab), fmaxf(ew::Dot(bc, bc), ew::Dot(ca, ca)));
+			float areaTwice = ew::Magnitude(ew::Cross(ab, -ca));
+			//Height over the longest edge is areaTwice / longest edge
+			if (areaTwice * areaTwice <= epsilon * epsilon * longestSq)
+				continue;
+			indices[numIndices++] = a;
+			indices[numIndices++] = b;
+			indices[numIndices++] = c;
+		}
+		indices.resize(numIndices);
+
+		//Compact the vertices that are still referenced, keeping their order
+		std::vector<unsigned int> newIndex(vertices.size(), NONE);
+		for (unsigned int index : indices) {
+			newIndex[index] = 0;
+		}
+		unsigned int numVertices = 0;
+		for (unsigned int v = 0; v < vertices.size(); v++) {
+			if (newIndex[v] == NONE)
+				continue;
+			newIndex[v] = numVertices;
+			vertices[numVertices++] = vertices[v];
+		}
+		vertices.resize(numVertices);
+		for (unsigned int& index : indices) {
+			index = newIndex[index];
+		}
+
+		computeBounds(mesh);
+		stats.verticesAfter = vertices.size();
+		stats.trianglesAfter = indices.size() / 3;
+		stats.vertexReduction = stats.verticesBefore > 0 ? 1.0f - (float)stats.verticesAfter / stats.verticesBefore : 0.0f;
+		return stats;
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include "mesh.h"
+
+namespace ew {
+	//Largest difference at which two vertices still count as the same. Use a large epsilon to ignore an attribute
+	struct WeldSettings {
+		float positionEpsilon = 1e-5f; //Object space distance
+		float normalEpsilon = 1e-3f; //Per component
+		float uvEpsilon = 1e-5f; //Per component
+	};
+
+	struct WeldStats {
+		size_t verticesBefore = 0;
+		size_t verticesAfter = 0;
+		size_t trianglesBefore = 0;
+		size_t trianglesAfter = 0;
+		float vertexReduction = 0; //Fraction of vertices removed
+	};
+
+	/// <summary>
+	/// Merges vertices whose position, normal and uv all match within the settings' epsilons, so seams
+	/// where uvs or normals differ are kept. Then removes degenerate triangles: repeated indices, or a height
+	/// below positionEpsilon. Unreferenced vertices are removed, the rest keep their order. Run before the optimizers
+	/// </summary>
+	WeldStats weldVertices(MeshData* mesh, const WeldSettings& settings = WeldSettings());
+
+	/// <summary>
+	/// Reorders triangles for post-transform vertex cache reuse (Forsyth's linear speed algorithm).
+	/// Vertices are not touched
+	/// </summary>
+	void optimizeVertexCache(MeshData* mesh, unsigned int cacheSize = 32);
+
+	/// <summary>
+	/// Reorders clusters of triangles so outward facing clusters are drawn first, which reduces overdraw
+	/// on convex-ish shapes. Run after optimizeVertexCache, clusters are consecutive runs of the cache optimized order
+	/// so cache efficiency is mostly kept. The order is left alone if ACMR would grow by more than 5%
+	/// </summary>
+	void optimizeOverdraw(MeshData* mesh, unsigned int trianglesPerCluster = 64);
+
+	/// <summary>
+	/// Reorders vertices in order of first use by the index buffer, so vertex fetches walk memory linearly.
+	/// Unreferenced vertices are removed. Run last
+	/// </summary>
+	void optimizeVertexFetch(MeshData* mesh);
+
+	/// <summary>
+	/// All of the above in the recommended order, kept only if vertex shader invocations (ACMR) and vertex fetch
+	/// (overfetch) don't get worse and at least one improves. Returns false if the input was left as is
+	/// </summary>
+	bool optimizeMesh(MeshData* mesh);
+
+	struct VertexCacheStats {
+		unsigned int vertexShaderInvocations = 0; //Cache misses
+		float acmr = 0; //Average cache miss ratio: transformed vertices per triangle. 0.5 is ideal for large grids, 3 is worst
+		float atvr = 0; //Average transformed vertex ratio: transformed vertices per vertex. 1 is ideal
+	};
+	//Simulates a FIFO post-transform cache
+	VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, size_t numVertices, unsigned int cacheSize = 16);
+
+	struct VertexFetchStats {
+		size_t bytesFetched = 0;
+		float overfetch = 0; //Bytes fetched / vertex buffer size. 1 is ideal
+	};
+	//Simulates a small LRU cache of 64 byte lines in front of the vertex buffer
+	VertexFetchStats analyzeVertexFetch(const std::vector<unsigned int>& indices, size_t numVertices, size_t vertexSize = sizeof(Vertex));
+}
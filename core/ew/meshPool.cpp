@@ -0,0 +1,308 @@
+#include "meshPool.h"
+#include "external/glad.h"
+#include <algorithm>
+
+namespace ew {
+	RangeAllocator::RangeAllocator(unsigned int capacity)
+	{
+		reset(capacity, 0);
+	}
+
+	unsigned int RangeAllocator::allocate(unsigned int size, unsigned int alignment)
+	{
+		if (size == 0)
+			return 0;
+		for (auto it = m_freeBlocks.begin(); it != m_freeBlocks.end(); ++it) {
+			unsigned int blockOffset = it->first;
+			unsigned int blockEnd = it->first + it->second;
+			unsigned int offset = (blockOffset + alignment - 1) / alignment * alignment;
+			if (offset + size > blockEnd)
+				continue;
+			//Split off whatever is left on either side
+			m_freeBlocks.erase(it);
+			if (offset > blockOffset)
+				m_freeBlocks[blockOffset] = offset - blockOffset;
+			if (offset + size < blockEnd)
+				m_freeBlocks[offset + size] = blockEnd - (offset + size);
+			m_freeSize -= size;
+			return offset;
+		}
+		return INVALID_OFFSET;
+	}
+
+	void RangeAllocator::free(unsigned int offset, unsigned int size)
+	{
+		if (size == 0)
+			return;
+		m_freeSize += size;
+		unsigned int start = offset;
+		unsigned int end = offset + size;
+		auto next = m_freeBlocks.lower_bound(offset);
+		if (next != m_freeBlocks.begin()) {
+			auto prev = std::prev(next);
+			if (prev->first + prev->second == start) {
+				start = prev->first;
+				m_freeBlocks.erase(prev);
+			}
+		}
+		if (next != m_freeBlocks.end() && next->first == end) {
+			end += next->second;
+			m_freeBlocks.erase(next);
+		}
+		m_freeBlocks[start] = end - start;
+	}
+
+	void RangeAllocator::grow(unsigned int newCapacity)
+	{
+		if (newCapacity <= m_capacity)
+			return;
+		unsigned int oldCapacity = m_capacity;
+		m_capacity = newCapacity;
+		free(oldCapacity, newCapacity - oldCapacity);
+	}
+
+	void RangeAllocator::reset(unsigned int capacity, unsigned int usedSize)
+	{
+		m_freeBlocks.clear();
+		m_capacity = capacity;
+		m_freeSize = capacity > usedSize ? capacity - usedSize : 0;
+		if (m_freeSize > 0)
+			m_freeBlocks[usedSize] = m_freeSize;
+	}
+
+	unsigned int RangeAllocator::getLargestFreeBlock() const
+	{
+		unsigned int largest = 0;
+		for (const auto& block : m_freeBlocks) {
+			largest = std::max(largest, block.second);
+		}
+		return largest;
+	}
+
+	//Same attribute layout as Mesh::load(const MeshData&)
+	static void setVertexAttributes() {
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, pos));
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, normal));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, uv));
+		glEnableVertexAttribArray(2);
+	}
+
+	MeshPool::MeshPool(unsigned int vertexCapacity, unsigned int indexCapacity)
+	{
+		createBuffers(vertexCapacity, indexCapacity);
+	}
+
+	void MeshPool::createBuffers(unsigned int vertexCapacity, unsigned int indexCapacity)
+	{
+		glGenVertexArrays(1, &m_vao);
+		glGenBuffers(1, &m_vbo);
+		glGenBuffers(1, &m_ebo);
+		glBindVertexArray(m_vao);
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertexCapacity * sizeof(Vertex), NULL, GL_DYNAMIC_DRAW);
+		setVertexAttributes();
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)indexCapacity * sizeof(unsigned short), NULL, GL_DYNAMIC_DRAW);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		m_vertexAllocator.reset(vertexCapacity, 0);
+		m_indexAllocator.reset(indexCapacity, 0);
+		m_initialized = true;
+	}
+
+	/// <summary>
+	/// Copies every live mesh, packed together, into new buffers of the given capacity and swaps them in.
+	/// Copying into fresh buffers avoids overlapping glCopyBufferSubData ranges
+	/// </summary>
+	void MeshPool::reallocate(unsigned int vertexCapacity, unsigned int indexCapacity)
+	{
+		unsigned int vbo = 0, ebo = 0;
+		glGenBuffers(1, &vbo);
+		glGenBuffers(1, &ebo);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+		glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)vertexCapacity * sizeof(Vertex), NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+		glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)indexCapacity * sizeof(unsigned short), NULL, GL_DYNAMIC_DRAW);
+
+		//Keep the current order so meshes added together stay together
+		std::vector<Slot*> live;
+		for (Slot& slot : m_slots) {
+			if (slot.alive)
+				live.push_back(&slot);
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, m_vbo);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+		std::sort(live.begin(), live.end(), [](const Slot* a, const Slot* b) { return a->vertexOffset < b->vertexOffset; });
+		unsigned int vertexEnd = 0;
+		for (Slot* slot : live) {
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)slot->vertexOffset * sizeof(Vertex),
+				(GLintptr)vertexEnd * sizeof(Vertex), (GLsizeiptr)slot->vertexCount * sizeof(Vertex));
+			slot->vertexOffset = vertexEnd;
+			vertexEnd += slot->vertexCount;
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, m_ebo);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+		std::sort(live.begin(), live.end(), [](const Slot* a, const Slot* b) { return a->indexOffset < b->indexOffset; });
+		unsigned int indexEnd = 0;
+		for (Slot* slot : live) {
+			unsigned int unitsPerIndex = slot->indexType == GL_UNSIGNED_INT ? 2 : 1;
+			indexEnd = (indexEnd + unitsPerIndex - 1) / unitsPerIndex * unitsPerIndex;
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)slot->indexOffset * sizeof(unsigned short),
+				(GLintptr)indexEnd * sizeof(unsigned short), (GLsizeiptr)slot->indexCount * unitsPerIndex * sizeof(unsigned short));
+			slot->indexOffset = indexEnd;
+			indexEnd += slot->indexCount * unitsPerIndex;
+		}
+		m_vertexAllocator.reset(vertexCapacity, vertexEnd);
+		m_indexAllocator.reset(indexCapacity, indexEnd);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		glDeleteBuffers(1, &m_vbo);
+		glDeleteBuffers(1, &m_ebo);
+		m_vbo = vbo;
+		m_ebo = ebo;
+
+		//The VAO still points at the old buffers
+		glBindVertexArray(m_vao);
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		setVertexAttributes();
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	MeshHandle MeshPool::add(const MeshData& meshData)
+	{
+		const unsigned int vertexCount = (unsigned int)meshData.vertices.size();
+		const unsigned int indexCount = (unsigned int)meshData.indices.size();
+		const bool shortIndices = vertexCount <= MAX_SHORT_INDEX_VERTICES;
+		const unsigned int unitsPerIndex = shortIndices ? 1 : 2;
+		if (!m_initialized) {
+			createBuffers(std::max(vertexCount, 1u << 16), std::max(indexCount * unitsPerIndex, 1u << 18));
+		}
+
+		unsigned int vertexOffset = m_vertexAllocator.allocate(vertexCount);
+		unsigned int indexOffset = m_indexAllocator.allocate(indexCount * unitsPerIndex, unitsPerIndex);
+		if (vertexOffset == RangeAllocator::INVALID_OFFSET || indexOffset == RangeAllocator::INVALID_OFFSET) {
+			if (vertexOffset != RangeAllocator::INVALID_OFFSET)
+				m_vertexAllocator.free(vertexOffset, vertexCount);
+			if (indexOffset != RangeAllocator::INVALID_OFFSET)
+				m_indexAllocator.free(indexOffset, indexCount * unitsPerIndex);
+			//Compact if that frees a big enough block, otherwise grow and compact in the same copy
+			unsigned int vertexCapacity = m_vertexAllocator.getCapacity();
+			unsigned int indexCapacity = m_indexAllocator.getCapacity();
+			if (m_vertexAllocator.getFreeSize() < vertexCount)
+				vertexCapacity = std::max(vertexCapacity * 2, vertexCapacity - m_vertexAllocator.getFreeSize() + vertexCount);
+			//+1 for alignment padding of 32 bit ranges
+			if (m_indexAllocator.getFreeSize() < indexCount * unitsPerIndex + m_slots.size() + 1)
+				indexCapacity = std::max(indexCapacity * 2, indexCapacity - m_indexAllocator.getFreeSize() + indexCount * unitsPerIndex + (unsigned int)m_slots.size() + 1);
+			reallocate(vertexCapacity, indexCapacity);
+			vertexOffset = m_vertexAllocator.allocate(vertexCount);
+			indexOffset = m_indexAllocator.allocate(indexCount * unitsPerIndex, unitsPerIndex);
+		}
+
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_vbo);
+		if (vertexCount > 0) {
+			glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)vertexOffset * sizeof(Vertex), (GLsizeiptr)vertexCount * sizeof(Vertex), meshData.vertices.data());
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_ebo);
+		if (indexCount > 0) {
+			if (shortIndices) {
+				std::vector<unsigned short> shortData(meshData.indices.begin(), meshData.indices.end());
+				glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)indexOffset * sizeof(unsigned short), (GLsizeiptr)indexCount * sizeof(unsigned short), shortData.data());
+			}
+			else {
+				glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)indexOffset * sizeof(unsigned short), (GLsizeiptr)indexCount * sizeof(unsigned int), meshData.indices.data());
+			}
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		MeshHandle handle;
+		if (!m_freeSlots.empty()) {
+			handle.slot = m_freeSlots.back();
+			m_freeSlots.pop_back();
+		}
+		else {
+			handle.slot = (unsigned int)m_slots.size();
+			m_slots.emplace_back();
+		}
+		Slot& slot = m_slots[handle.slot];
+		slot.vertexOffset = vertexOffset;
+		slot.vertexCount = vertexCount;
+		slot.indexOffset = indexOffset;
+		slot.indexCount = indexCount;
+		slot.indexType = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		slot.alive = true;
+		handle.generation = slot.generation;
+		return handle;
+	}
+
+	void MeshPool::remove(MeshHandle handle)
+	{
+		if (!isValid(handle))
+			return;
+		Slot& slot = m_slots[handle.slot];
+		unsigned int unitsPerIndex = slot.indexType == GL_UNSIGNED_INT ? 2 : 1;
+		m_vertexAllocator.free(slot.vertexOffset, slot.vertexCount);
+		m_indexAllocator.free(slot.indexOffset, slot.indexCount * unitsPerIndex);
+		slot.alive = false;
+		slot.generation++;
+		m_freeSlots.push_back(handle.slot);
+	}
+
+	bool MeshPool::isValid(MeshHandle handle) const
+	{
+		return handle.slot < m_slots.size() && m_slots[handle.slot].alive && m_slots[handle.slot].generation == handle.generation;
+	}
+
+	void MeshPool::bind() const
+	{
+		glBindVertexArray(m_vao);
+	}
+
+	void MeshPool::draw(MeshHandle handle) const
+	{
+		if (!isValid(handle))
+			return;
+		const Slot& slot = m_slots[handle.slot];
+		glDrawElementsBaseVertex(GL_TRIANGLES, slot.indexCount, slot.indexType,
+			(const void*)((size_t)slot.indexOffset * sizeof(unsigned short)), slot.vertexOffset);
+	}
+
+	bool MeshPool::getDrawCommand(MeshHandle handle, DrawElementsIndirectCommand* command, unsigned int* indexType) const
+	{
+		if (!isValid(handle))
+			return false;
+		const Slot& slot = m_slots[handle.slot];
+		command->count = slot.indexCount;
+		command->firstIndex = slot.indexType == GL_UNSIGNED_INT ? slot.indexOffset / 2 : slot.indexOffset;
+		command->baseVertex = (int)slot.vertexOffset;
+		*indexType = slot.indexType;
+		return true;
+	}
+
+	void MeshPool::compact()
+	{
+		if (!m_initialized)
+			return;
+		reallocate(m_vertexAllocator.getCapacity(), m_indexAllocator.getCapacity());
+	}
+
+	MeshPoolStats MeshPool::getStats() const
+	{
+		MeshPoolStats stats;
+		stats.numMeshes = (unsigned int)(m_slots.size() - m_freeSlots.size());
+		stats.vertexCapacity = m_vertexAllocator.getCapacity();
+		stats.verticesUsed = stats.vertexCapacity - m_vertexAllocator.getFreeSize();
+		stats.vertexFreeBlocks = m_vertexAllocator.getNumFreeBlocks();
+		stats.indexCapacity = m_indexAllocator.getCapacity();
+		stats.indicesUsed = stats.indexCapacity - m_indexAllocator.getFreeSize();
+		stats.indexFreeBlocks = m_indexAllocator.getNumFreeBlocks();
+		if (m_vertexAllocator.getFreeSize() > 0)
+			stats.vertexFragmentation = 1.0f - (float)m_vertexAllocator.getLargestFreeBlock() / m_vertexAllocator.getFreeSize();
+		if (m_indexAllocator.getFreeSize() > 0)
+			stats.indexFragmentation = 1.0f - (float)m_indexAllocator.getLargestFreeBlock() / m_indexAllocator.getFreeSize();
+		return stats;
+	}
+}
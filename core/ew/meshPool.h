@@ -0,0 +1,104 @@
+#pragma once
+#include <vector>
+#include <map>
+#include "mesh.h"
+
+namespace ew {
+	/// <summary>
+	/// First fit free list over a linear range of units (vertices, indices...).
+	/// Freed blocks are merged with their neighbours
+	/// </summary>
+	class RangeAllocator {
+	public:
+		static const unsigned int INVALID_OFFSET = 0xffffffff;
+		RangeAllocator(unsigned int capacity = 0);
+		//Returns INVALID_OFFSET when no free block is large enough
+		unsigned int allocate(unsigned int size, unsigned int alignment = 1);
+		void free(unsigned int offset, unsigned int size);
+		//Adds free space at the end
+		void grow(unsigned int newCapacity);
+		//Everything below usedSize is allocated, everything above is one free block
+		void reset(unsigned int capacity, unsigned int usedSize);
+		inline unsigned int getCapacity()const { return m_capacity; }
+		inline unsigned int getFreeSize()const { return m_freeSize; }
+		inline unsigned int getNumFreeBlocks()const { return (unsigned int)m_freeBlocks.size(); }
+		unsigned int getLargestFreeBlock()const;
+	private:
+		std::map<unsigned int, unsigned int> m_freeBlocks; //Offset -> size
+		unsigned int m_capacity = 0;
+		unsigned int m_freeSize = 0;
+	};
+
+	//A mesh inside a MeshPool. Stays valid across compaction, goes stale when the mesh is removed
+	struct MeshHandle {
+		unsigned int slot = 0xffffffff;
+		unsigned int generation = 0;
+	};
+
+	//Layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+	struct DrawElementsIndirectCommand {
+		unsigned int count = 0;
+		unsigned int instanceCount = 1;
+		unsigned int firstIndex = 0; //In indices of the draw's index type
+		int baseVertex = 0;
+		unsigned int baseInstance = 0;
+	};
+
+	struct MeshPoolStats {
+		unsigned int numMeshes = 0;
+		unsigned int vertexCapacity = 0;
+		unsigned int verticesUsed = 0;
+		unsigned int vertexFreeBlocks = 0;
+		unsigned int indexCapacity = 0; //16 bit units, 32 bit indices take two
+		unsigned int indicesUsed = 0;
+		unsigned int indexFreeBlocks = 0;
+		//1 - largest free block / total free space. 0 when all free space is one block
+		float vertexFragmentation = 0;
+		float indexFragmentation = 0;
+	};
+
+	/// <summary>
+	/// Suballocates meshes out of one shared VBO/EBO behind a single VAO, so many meshes draw without rebinding.
+	/// Indices are stored per mesh relative to its first vertex and drawn with glDrawElementsBaseVertex,
+	/// so meshes with up to MAX_SHORT_INDEX_VERTICES vertices use 16 bit indices.
+	/// Buffers grow when full, compact() closes the holes left by removed meshes
+	/// </summary>
+	class MeshPool {
+	public:
+		MeshPool() {};
+		//Capacities in vertices and 16 bit index units
+		MeshPool(unsigned int vertexCapacity, unsigned int indexCapacity);
+		MeshHandle add(const MeshData& meshData);
+		void remove(MeshHandle handle);
+		bool isValid(MeshHandle handle)const;
+		//Binds the shared VAO. Call once before draw
+		void bind()const;
+		void draw(MeshHandle handle)const;
+		//Moves all meshes to the start of the buffers, leaving one free block each
+		void compact();
+		MeshPoolStats getStats()const;
+		inline unsigned int getNumIndices(MeshHandle handle)const { return isValid(handle) ? m_slots[handle.slot].indexCount : 0; }
+		//Where the mesh currently lives, for indirect draws. Goes stale when the buffers are reallocated by add or compact
+		bool getDrawCommand(MeshHandle handle, DrawElementsIndirectCommand* command, unsigned int* indexType)const;
+	private:
+		struct Slot {
+			unsigned int vertexOffset = 0;
+			unsigned int vertexCount = 0;
+			unsigned int indexOffset = 0; //16 bit units
+			unsigned int indexCount = 0;
+			unsigned int indexType = 0;
+			unsigned int generation = 0;
+			bool alive = false;
+		};
+		void createBuffers(unsigned int vertexCapacity, unsigned int indexCapacity);
+		void reallocate(unsigned int vertexCapacity, unsigned int indexCapacity);
+		bool m_initialized = false;
+		unsigned int m_vao = 0;
+		unsigned int m_vbo = 0;
+		unsigned int m_ebo = 0;
+		RangeAllocator m_vertexAllocator;
+		RangeAllocator m_indexAllocator;
+		std::vector<Slot> m_slots;
+		std::vector<unsigned int> m_freeSlots;
+	};
+}
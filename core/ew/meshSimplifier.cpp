@@ -0,0 +1,474 @@
+#include "meshSimplifier.h"
+#include "meshOptimizer.h"
+#include "meshBounds.h"
+#include "meshAdjacency.h"
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ew {
+	namespace {
+		const unsigned int NONE = 0xffffffff;
+		//Quadric weights of the planes that hold open borders and attribute seams in place
+		const float BORDER_WEIGHT = 10.0f;
+		const float SEAM_WEIGHT = 1.0f;
+		//Collapses that turn a triangle normal further than ~75 degrees count as flips
+		const float MIN_NORMAL_COS = 0.25f;
+
+		//Sum of weighted squared plane distances. Evaluates to a weighted mean squared distance
+		struct Quadric {
+			float a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+			float b0 = 0, b1 = 0, b2 = 0;
+			float c = 0;
+			float w = 0;
+		};
+
+		void addPlane(Quadric* q, const ew::Vec3& n, float d, float weight) {
+			q->a00 += weight * n.x * n.x;
+			q->a11 += weight * n.y * n.y;
+			q->a22 += weight * n.z * n.z;
+			q->a01 += weight * n.x * n.y;
+			q->a02 += weight * n.x * n.z;
+			q->a12 += weight * n.y * n.z;
+			q->b0 += weight * n.x * d;
+			q->b1 += weight * n.y * d;
+			q->b2 += weight * n.z * d;
+			q->c += weight * d * d;
+			q->w += weight;
+		}
+
+		Quadric operator+(Quadric a, const Quadric& b) {
+			a.a00 += b.a00; a.a11 += b.a11; a.a22 += b.a22;
+			a.a01 += b.a01; a.a02 += b.a02; a.a12 += b.a12;
+			a.b0 += b.b0; a.b1 += b.b1; a.b2 += b.b2;
+			a.c += b.c;
+			a.w += b.w;
+			return a;
+		}
+
+		float quadricError(const Quadric& q, const ew::Vec3& p) {
+			float r = q.a00 * p.x * p.x + q.a11 * p.y * p.y + q.a22 * p.z * p.z
+				+ 2.0f * (q.a01 * p.x * p.y + q.a02 * p.x * p.z + q.a12 * p.y * p.z)
+				+ 2.0f * (q.b0 * p.x + q.b1 * p.y + q.b2 * p.z)
+				+ q.c;
+			return q.w > 0.0f ? fabsf(r) / q.w : 0.0f;
+		}
+
+		enum VertexKind {
+			MANIFOLD, //Moves freely
+			BORDER, //Moves along its open edge
+			SEAM, //Two attribute sets at one position. Moves along the seam, together with its partner
+			LOCKED //Never moves
+		};
+
+		struct Collapse {
+			unsigned int v; //Removed
+			unsigned int t; //Kept
+			float error; //Quadric error
+		};
+
+		struct PositionHash {
+			size_t operator()(const ew::Vec3& p) const {
+				//+0 and -0 must hash the same
+				float f[3] = { p.x == 0.0f ? 0.0f : p.x, p.y == 0.0f ? 0.0f : p.y, p.z == 0.0f ? 0.0f : p.z };
+				uint32_t h[3];
+				memcpy(h, f, sizeof(h));
+				return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+			}
+		};
+		struct PositionEqual {
+			bool operator()(const ew::Vec3& a, const ew::Vec3& b) const {
+				return a.x == b.x && a.y == b.y && a.z == b.z;
+			}
+		};
+
+		inline uint64_t edgeKey(unsigned int a, unsigned int b) {
+			return ((uint64_t)a << 32) | b;
+		}
+
+		//Squared distance from p to the closest point of triangle abc (Ericson, Real-Time Collision Detection 5.1.5)
+		float pointTriangleDistanceSq(const ew::Vec3& p, const ew::Vec3& a, const ew::Vec3& b, const ew::Vec3& c) {
+			auto distanceSq = [&](const ew::Vec3& q) { return ew::Dot(p - q, p - q); };
+			ew::Vec3 ab = b - a, ac = c - a, ap = p - a;
+			float d1 = ew::Dot(ab, ap), d2 = ew::Dot(ac, ap);
+			if (d1 <= 0.0f && d2 <= 0.0f)
+				return distanceSq(a);
+			ew::Vec3 bp = p - b;
+			float d3 = ew::Dot(ab, bp), d4 = ew::Dot(ac, bp);
+			if (d3 >= 0.0f && d4 <= d3)
+				return distanceSq(b);
+			float vc = d1 * d4 - d3 * d2;
+			if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+				return distanceSq(a + ab * (d1 / (d1 - d3)));
+			ew::Vec3 cp = p - c;
+			float d5 = ew::Dot(ab, cp), d6 = ew::Dot(ac, cp);
+			if (d6 >= 0.0f && d5 <= d6)
+				return distanceSq(c);
+			float vb = d5 * d2 - d1 * d6;
+			if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+				return distanceSq(a + ac * (d2 / (d2 - d6)));
+			float va = d3 * d6 - d5 * d4;
+			if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+				return distanceSq(b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))));
+			float denom = va + vb + vc;
+			if (denom <= 0.0f) //Degenerate
+				return std::min(distanceSq(a), std::min(distanceSq(b), distanceSq(c)));
+			return distanceSq(a + ab * (vb / denom) + ac * (vc / denom));
+		}
+	}
+
+	MeshData simplifyMesh(const MeshData& meshData, size_t targetIndexCount, float targetError, float* resultError)
+	{
+		const std::vector<Vertex>& vertices = meshData.vertices;
+		const size_t numVertices = vertices.size();
+		std::vector<unsigned int> indices = meshData.indices;
+		indices.resize(indices.size() / 3 * 3);
+
+		//Vertices at the same position form a group. Quadrics and per pass locks work on groups
+		std::vector<unsigned int> remap(numVertices);
+		{
+			std::unordered_map<ew::Vec3, unsigned int, PositionHash, PositionEqual> positions;
+			positions.reserve(numVertices);
+			for (size_t v = 0; v < numVertices; v++) {
+				remap[v] = positions.emplace(vertices[v].pos, (unsigned int)v).first->second;
+			}
+		}
+
+		std::unordered_set<uint64_t> wedgeEdges, positionEdges;
+		auto buildEdges = [&]() {
+			wedgeEdges.clear();
+			positionEdges.clear();
+			for (size_t i = 0; i < indices.size(); i += 3) {
+				for (int k = 0; k < 3; k++) {
+					unsigned int a = indices[i + k], b = indices[i + (k + 1) % 3];
+					wedgeEdges.insert(edgeKey(a, b));
+					positionEdges.insert(edgeKey(remap[a], remap[b]));
+				}
+			}
+		};
+
+		//Triangle planes, plus planes perpendicular to borders and seams
+		std::vector<Quadric> quadrics(numVertices);
+		buildEdges();
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			const ew::Vec3& p0 = vertices[indices[i]].pos;
+			ew::Vec3 n = ew::Cross(vertices[indices[i + 1]].pos - p0, vertices[indices[i + 2]].pos - p0);
+			float doubleArea = ew::Magnitude(n);
+			if (doubleArea == 0.0f)
+				continue;
+			n /= doubleArea;
+			for (int k = 0; k < 3; k++) {
+				addPlane(&quadrics[remap[indices[i + k]]], n, -ew::Dot(n, p0), doubleArea * 0.5f);
+			}
+			for (int k = 0; k < 3; k++) {
+				unsigned int a = indices[i + k], b = indices[i + (k + 1) % 3];
+				bool border = !positionEdges.count(edgeKey(remap[b], remap[a]));
+				bool seam = !border && !wedgeEdges.count(edgeKey(b, a));
+				if (!border && !seam)
+					continue;
+				ew::Vec3 edge = vertices[b].pos - vertices[a].pos;
+				ew::Vec3 edgeNormal = ew::Cross(edge, n);
+				float length = ew::Magnitude(edgeNormal);
+				if (length == 0.0f)
+					continue;
+				edgeNormal /= length;
+				float weight = (border ? BORDER_WEIGHT : SEAM_WEIGHT) * ew::Dot(edge, edge);
+				float d = -ew::Dot(edgeNormal, vertices[a].pos);
+				addPlane(&quadrics[remap[a]], edgeNormal, d, weight);
+				addPlane(&quadrics[remap[b]], edgeNormal, d, weight);
+			}
+		}
+
+		const float targetErrorSq = targetError < sqrtf(FLT_MAX) ? targetError * targetError : FLT_MAX;
+
+		std::vector<unsigned int> adjacencyOffsets, adjacency;
+		std::vector<unsigned int> groupFirst(numVertices), wedgeNext(numVertices);
+		std::vector<unsigned char> groupSize(numVertices), kind(numVertices);
+		std::vector<unsigned char> positionOpenOut(numVertices), positionOpenIn(numVertices);
+		std::vector<unsigned char> wedgeOpenOut(numVertices), wedgeOpenIn(numVertices);
+		std::vector<unsigned int> collapseRemap(numVertices);
+		std::vector<bool> groupLocked(numVertices);
+		std::vector<unsigned int> collapsedInto(numVertices); //Group each group was merged into
+		for (size_t v = 0; v < numVertices; v++) {
+			collapsedInto[v] = (unsigned int)v;
+		}
+		std::vector<Collapse> collapses;
+
+		//Each pass collapses a batch of cheap, independent edges
+		bool firstPass = true;
+		while (indices.size() > targetIndexCount)
+		{
+			const size_t numTriangles = indices.size() / 3;
+			if (!firstPass)
+				buildEdges();
+			firstPass = false;
+
+			buildVertexTriangleAdjacency(indices.data(), indices.size(), numVertices, &adjacencyOffsets, &adjacency);
+
+			//Live vertices of each group
+			std::fill(groupFirst.begin(), groupFirst.end(), NONE);
+			std::fill(groupSize.begin(), groupSize.end(), 0);
+			for (size_t v = 0; v < numVertices; v++) {
+				if (adjacencyOffsets[v + 1] == adjacencyOffsets[v])
+					continue;
+				unsigned int g = remap[v];
+				wedgeNext[v] = groupFirst[g];
+				groupFirst[g] = (unsigned int)v;
+				groupSize[g] = (unsigned char)std::min(groupSize[g] + 1, 255);
+			}
+
+			//Classify vertices by their open edges
+			std::fill(positionOpenOut.begin(), positionOpenOut.end(), 0);
+			std::fill(positionOpenIn.begin(), positionOpenIn.end(), 0);
+			std::fill(wedgeOpenOut.begin(), wedgeOpenOut.end(), 0);
+			std::fill(wedgeOpenIn.begin(), wedgeOpenIn.end(), 0);
+			for (size_t i = 0; i < indices.size(); i += 3) {
+				for (int k = 0; k < 3; k++) {
+					unsigned int a = indices[i + k], b = indices[i + (k + 1) % 3];
+					if (!positionEdges.count(edgeKey(remap[b], remap[a]))) {
+						positionOpenOut[remap[a]] = (unsigned char)std::min(positionOpenOut[remap[a]] + 1, 255);
+						positionOpenIn[remap[b]] = (unsigned char)std::min(positionOpenIn[remap[b]] + 1, 255);
+					}
+					if (!wedgeEdges.count(edgeKey(b, a))) {
+						wedgeOpenOut[a] = (unsigned char)std::min(wedgeOpenOut[a] + 1, 255);
+						wedgeOpenIn[b] = (unsigned char)std::min(wedgeOpenIn[b] + 1, 255);
+					}
+				}
+			}
+			for (size_t v = 0; v < numVertices; v++) {
+				unsigned int g = remap[v];
+				kind[v] = LOCKED;
+				if (groupSize[g] == 1) {
+					if (positionOpenOut[g] == 0 && positionOpenIn[g] == 0)
+						kind[v] = MANIFOLD;
+					else if (positionOpenOut[g] == 1 && positionOpenIn[g] == 1)
+						kind[v] = BORDER;
+				}
+				else if (groupSize[g] == 2 && positionOpenOut[g] == 0 && positionOpenIn[g] == 0) {
+					unsigned int w = groupFirst[g] == v ? wedgeNext[v] : groupFirst[g];
+					if (wedgeOpenOut[v] == 1 && wedgeOpenIn[v] == 1 && wedgeOpenOut[w] == 1 && wedgeOpenIn[w] == 1)
+						kind[v] = SEAM;
+				}
+			}
+
+			//Cheapest valid direction of every edge
+			auto canCollapse = [&](unsigned int v, unsigned int t, bool border, bool seam) {
+				switch (kind[v]) {
+				case MANIFOLD:
+					return true;
+				case BORDER:
+					return border;
+				case SEAM:
+					return seam && (kind[t] == SEAM || kind[t] == LOCKED);
+				default:
+					return false;
+				}
+			};
+			collapses.clear();
+			for (size_t i = 0; i < indices.size(); i += 3) {
+				for (int k = 0; k < 3; k++) {
+					unsigned int a = indices[i + k], b = indices[i + (k + 1) % 3];
+					bool border = !positionEdges.count(edgeKey(remap[b], remap[a]));
+					bool seam = !border && !wedgeEdges.count(edgeKey(b, a));
+					Quadric q = quadrics[remap[a]] + quadrics[remap[b]];
+					Collapse best = { NONE, NONE, FLT_MAX };
+					if (canCollapse(a, b, border, seam)) {
+						best = { a, b, quadricError(q, vertices[b].pos) };
+					}
+					if (canCollapse(b, a, border, seam)) {
+						float error = quadricError(q, vertices[a].pos);
+						if (error < best.error)
+							best = { b, a, error };
+					}
+					if (best.v != NONE)
+						collapses.push_back(best);
+				}
+			}
+			if (collapses.empty())
+				break;
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+			//Don't let one pass eat into collapses much worse than the ones it needs
+			const size_t triangleGoal = (indices.size() - targetIndexCount + 2) / 3;
+			float passErrorLimit = std::min(collapses[std::min(collapses.size() - 1, triangleGoal / 2)].error * 1.5f, targetErrorSq);
+
+			for (size_t v = 0; v < numVertices; v++) {
+				collapseRemap[v] = (unsigned int)v;
+			}
+			std::fill(groupLocked.begin(), groupLocked.end(), false);
+
+			//Counts the triangles around v that a collapse onto t removes, returns false if any of the others would flip
+			auto checkCollapse = [&](unsigned int v, unsigned int t, size_t* removed) {
+				const unsigned int gt = remap[t];
+				for (unsigned int a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; a++) {
+					const unsigned int* tri = &indices[adjacency[a] * 3];
+					unsigned int i0 = collapseRemap[tri[0]], i1 = collapseRemap[tri[1]], i2 = collapseRemap[tri[2]];
+					unsigned int g0 = remap[i0], g1 = remap[i1], g2 = remap[i2];
+					if (g0 == g1 || g1 == g2 || g0 == g2)
+						continue;
+					if (g0 == gt || g1 == gt || g2 == gt) {
+						(*removed)++;
+						continue;
+					}
+					ew::Vec3 p0 = vertices[i0].pos, p1 = vertices[i1].pos, p2 = vertices[i2].pos;
+					ew::Vec3 before = ew::Cross(p1 - p0, p2 - p0);
+					if (i0 == v) p0 = vertices[t].pos;
+					if (i1 == v) p1 = vertices[t].pos;
+					if (i2 == v) p2 = vertices[t].pos;
+					ew::Vec3 after = ew::Cross(p1 - p0, p2 - p0);
+					if (ew::Dot(before, after) <= MIN_NORMAL_COS * ew::Magnitude(before) * ew::Magnitude(after))
+						return false;
+				}
+				return true;
+			};
+
+			size_t trianglesRemoved = 0;
+			size_t collapsesMade = 0;
+			for (const Collapse& c : collapses) {
+				if (trianglesRemoved >= triangleGoal || c.error > targetErrorSq)
+					break;
+				if (c.error > passErrorLimit) {
+					//The cheap ones were all blocked, measure the limit from the cheapest one that isn't
+					if (collapsesMade > 0)
+						break;
+					passErrorLimit = std::min(c.error * 1.5f, targetErrorSq);
+				}
+				unsigned int gv = remap[c.v], gt = remap[c.t];
+				if (groupLocked[gv] || groupLocked[gt])
+					continue;
+
+				//Seam vertices take their partner along, onto the matching side of the target
+				unsigned int w = NONE, tw = NONE;
+				if (kind[c.v] == SEAM) {
+					w = groupFirst[gv] == c.v ? wedgeNext[c.v] : groupFirst[gv];
+					for (unsigned int x = groupFirst[gt]; x != NONE; x = wedgeNext[x]) {
+						if (x != c.t && (wedgeEdges.count(edgeKey(w, x)) || wedgeEdges.count(edgeKey(x, w)))) {
+							tw = x;
+							break;
+						}
+					}
+					if (tw == NONE)
+						continue;
+				}
+
+				size_t removed = 0;
+				if (!checkCollapse(c.v, c.t, &removed))
+					continue;
+				if (w != NONE && !checkCollapse(w, tw, &removed))
+					continue;
+
+				collapseRemap[c.v] = c.t;
+				if (w != NONE)
+					collapseRemap[w] = tw;
+				quadrics[gt] = quadrics[gt] + quadrics[gv];
+				groupLocked[gv] = groupLocked[gt] = true;
+				collapsedInto[gv] = gt;
+				trianglesRemoved += removed;
+				collapsesMade++;
+			}
+			if (collapsesMade == 0)
+				break;
+
+			//Apply the collapses and drop triangles that lost an edge
+			size_t write = 0;
+			for (size_t i = 0; i < numTriangles; i++) {
+				unsigned int i0 = collapseRemap[indices[i * 3]], i1 = collapseRemap[indices[i * 3 + 1]], i2 = collapseRemap[indices[i * 3 + 2]];
+				if (remap[i0] == remap[i1] || remap[i1] == remap[i2] || remap[i0] == remap[i2])
+					continue;
+				indices[write++] = i0;
+				indices[write++] = i1;
+				indices[write++] = i2;
+			}
+			indices.resize(write);
+		}
+
+		//Distance from every source position to the closest result triangle found by walking out from the group it collapsed into.
+		//Every triangle visited is part of the result, so this never underestimates the distance to the simplified surface
+		if (resultError) {
+			std::vector<unsigned int> groupIndices(indices.size());
+			for (size_t i = 0; i < indices.size(); i++) {
+				groupIndices[i] = remap[indices[i]];
+			}
+			buildVertexTriangleAdjacency(groupIndices.data(), groupIndices.size(), numVertices, &adjacencyOffsets, &adjacency);
+			std::vector<bool> measured(numVertices, false);
+			float maxDistanceSq = 0.0f;
+			for (unsigned int index : meshData.indices) {
+				unsigned int g = remap[index];
+				if (measured[g])
+					continue;
+				measured[g] = true;
+				unsigned int target = g;
+				while (collapsedInto[target] != target) {
+					target = collapsedInto[target];
+				}
+				const ew::Vec3& p = vertices[g].pos;
+				float distanceSq = FLT_MAX;
+				unsigned int closest = NONE;
+				unsigned int around[3] = { target, target, target };
+				for (bool improved = true; improved;) {
+					improved = false;
+					for (unsigned int k = 0; k < 3; k++) {
+						for (unsigned int a = adjacencyOffsets[around[k]]; a < adjacencyOffsets[around[k] + 1]; a++) {
+							const unsigned int* tri = &indices[adjacency[a] * 3];
+							float d = pointTriangleDistanceSq(p, vertices[tri[0]].pos, vertices[tri[1]].pos, vertices[tri[2]].pos);
+							if (d < distanceSq) {
+								distanceSq = d;
+								closest = adjacency[a];
+								improved = true;
+							}
+						}
+					}
+					if (improved) {
+						for (unsigned int k = 0; k < 3; k++) {
+							around[k] = groupIndices[closest * 3 + k];
+						}
+					}
+				}
+				//The group lost all of its triangles to later collapses around it
+				if (closest == NONE) {
+					for (size_t i = 0; i < indices.size(); i += 3) {
+						distanceSq = std::min(distanceSq, pointTriangleDistanceSq(p, vertices[indices[i]].pos, vertices[indices[i + 1]].pos, vertices[indices[i + 2]].pos));
+					}
+				}
+				if (distanceSq != FLT_MAX)
+					maxDistanceSq = std::max(maxDistanceSq, distanceSq);
+			}
+			*resultError = sqrtf(maxDistanceSq);
+		}
+		MeshData result;
+		result.vertices = vertices;
+		result.indices.swap(indices);
+		optimizeVertexFetch(&result);
+		computeBounds(&result);
+		return result;
+	}
+
+	std::vector<MeshLOD> generateLODChain(const MeshData& meshData, unsigned int maxLevels, float reductionPerLevel)
+	{
+		std::vector<MeshLOD> lods;
+		if (maxLevels == 0)
+			return lods;
+		MeshLOD base;
+		base.meshData = meshData;
+		optimizeMesh(&base.meshData);
+		lods.push_back(base);
+
+		size_t targetIndexCount = meshData.indices.size();
+		for (unsigned int level = 1; level < maxLevels; level++) {
+			targetIndexCount = (size_t)(targetIndexCount * reductionPerLevel) / 3 * 3;
+			//Each level starts over from the source so errors don't stack up
+			MeshLOD lod;
+			lod.meshData = simplifyMesh(meshData, targetIndexCount, FLT_MAX, &lod.error);
+			//Stalled on locked vertices
+			if (lod.meshData.indices.size() * 10 >= lods.back().meshData.indices.size() * 9)
+				break;
+			lod.error = std::max(lod.error, lods.back().error);
+			optimizeMesh(&lod.meshData);
+			lods.push_back(lod);
+		}
+		return lods;
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+#include <float.h>
+#include "mesh.h"
+
+namespace ew {
+	/// <summary>
+	/// Reduces the triangle count with edge collapses ordered by quadric error (Garland-Heckbert).
+	/// Vertices collapse onto existing vertices, so attributes are never interpolated.
+	/// Vertices split by UV/normal seams only collapse along their seam, open borders only along the border,
+	/// and corners where more than two attribute sets meet never move
+	/// </summary>
+	/// <param name="targetIndexCount">Stops once the mesh has this many indices or fewer</param>
+	/// <param name="targetError">Stops before a collapse whose quadric error, a weighted mean of squared plane distances, exceeds this squared.
+	/// An estimate in object space units, the measured distance can be larger</param>
+	/// <param name="resultError">Optional. Largest distance from a source vertex to the simplified surface, in object space units.
+	/// Measured against nearby triangles, so it can overestimate but never underestimates</param>
+	MeshData simplifyMesh(const MeshData& meshData, size_t targetIndexCount, float targetError = FLT_MAX, float* resultError = nullptr);
+
+	struct MeshLOD {
+		MeshData meshData;
+		float error = 0; //Largest object space distance of the full detail vertices from this level's surface
+	};
+
+	/// <summary>
+	/// Level 0 is the input. Each following level keeps reductionPerLevel of the previous level's triangles.
+	/// Stops early once simplification stalls. Every level is run through optimizeMesh
+	/// </summary>
+	std::vector<MeshLOD> generateLODChain(const MeshData& meshData, unsigned int maxLevels = 4, float reductionPerLevel = 0.25f);
+}
@@ -0,0 +1,229 @@
+#include "meshlet.h"
+#include "meshAdjacency.h"
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+
+namespace ew {
+	/// <summary>
+	/// Bounding sphere around the meshlet's vertices, and the cone containing all of its triangle normals.
+	/// The apex sits far enough back along the axis that every triangle plane faces away from it
+	/// </summary>
+	static void computeMeshletBounds(const std::vector<Vertex>& vertices, const unsigned int* tris, Meshlet* meshlet, const std::vector<unsigned int>& meshletVertices)
+	{
+		ew::AABB box;
+		box.min = box.max = vertices[meshletVertices[0]].pos;
+		for (unsigned int v : meshletVertices) {
+			const ew::Vec3& p = vertices[v].pos;
+			box.min = ew::Vec3(fminf(box.min.x, p.x), fminf(box.min.y, p.y), fminf(box.min.z, p.z));
+			box.max = ew::Vec3(fmaxf(box.max.x, p.x), fmaxf(box.max.y, p.y), fmaxf(box.max.z, p.z));
+		}
+		ew::Vec3 center = box.center();
+		float radiusSq = 0.0f;
+		for (unsigned int v : meshletVertices) {
+			ew::Vec3 d = vertices[v].pos - center;
+			radiusSq = fmaxf(radiusSq, ew::Dot(d, d));
+		}
+		meshlet->bounds.center = center;
+		meshlet->bounds.radius = sqrtf(radiusSq);
+
+		std::vector<ew::Vec3> normals(meshlet->triangleCount, ew::Vec3(0.0f));
+		ew::Vec3 axis = ew::Vec3(0.0f);
+		for (unsigned int t = 0; t < meshlet->triangleCount; t++) {
+			const ew::Vec3& p0 = vertices[tris[t * 3]].pos;
+			ew::Vec3 n = ew::Cross(vertices[tris[t * 3 + 1]].pos - p0, vertices[tris[t * 3 + 2]].pos - p0);
+			float length = ew::Magnitude(n);
+			if (length == 0.0f)
+				continue;
+			normals[t] = n / length;
+			axis += normals[t];
+		}
+		meshlet->coneAxis = ew::Vec3(0.0f, 1.0f, 0.0f);
+		meshlet->coneApex = center;
+		meshlet->coneCutoff = 1.0f;
+		float axisLength = ew::Magnitude(axis);
+		if (axisLength == 0.0f)
+			return;
+		axis /= axisLength;
+		meshlet->coneAxis = axis;
+
+		float minDot = 1.0f;
+		for (const ew::Vec3& n : normals) {
+			if (n.x != 0.0f || n.y != 0.0f || n.z != 0.0f)
+				minDot = fminf(minDot, ew::Dot(axis, n));
+		}
+		//Normals spread over (nearly) a hemisphere or more, there is no useful cone
+		if (minDot <= 0.1f)
+			return;
+
+		float maxT = 0.0f;
+		for (unsigned int t = 0; t < meshlet->triangleCount; t++) {
+			const ew::Vec3& n = normals[t];
+			if (n.x == 0.0f && n.y == 0.0f && n.z == 0.0f)
+				continue;
+			float distance = ew::Dot(center - vertices[tris[t * 3]].pos, n);
+			maxT = fmaxf(maxT, distance / ew::Dot(axis, n));
+		}
+		meshlet->coneApex = center - axis * maxT;
+		//sin of the cone's half angle
+		meshlet->coneCutoff = sqrtf(1.0f - minDot * minDot);
+	}
+
+	std::vector<Meshlet> buildMeshlets(MeshData* mesh, unsigned int maxVertices, unsigned int maxTriangles)
+	{
+		const unsigned int NONE = 0xffffffff;
+		const std::vector<Vertex>& vertices = mesh->vertices;
+		const std::vector<unsigned int>& indices = mesh->indices;
+		const size_t numTriangles = indices.size() / 3;
+		const size_t numVertices = vertices.size();
+		std::vector<Meshlet> meshlets;
+		if (numTriangles == 0)
+			return meshlets;
+		maxVertices = std::max(maxVertices, 3u);
+		maxTriangles = std::max(maxTriangles, 1u);
+
+		std::vector<unsigned int> offsets, adjacency;
+		buildVertexTriangleAdjacency(indices.data(), numTriangles * 3, numVertices, &offsets, &adjacency);
+		std::vector<ew::Vec3> centroids(numTriangles);
+		for (size_t t = 0; t < numTriangles; t++) {
+			centroids[t] = (vertices[indices[t * 3]].pos + vertices[indices[t * 3 + 1]].pos + vertices[indices[t * 3 + 2]].pos) / 3.0f;
+		}
+
+		std::vector<bool> emitted(numTriangles, false);
+		std::vector<unsigned int> meshletOf(numVertices, NONE); //Last meshlet a vertex was added to
+		std::vector<unsigned int> meshletVertices, previousVertices;
+		std::vector<unsigned int> output;
+		output.reserve(numTriangles * 3);
+		ew::Vec3 previousCenter = ew::Vec3(0.0f);
+		size_t scanCursor = 0;
+		size_t emittedCount = 0;
+
+		auto newVertices = [&](size_t t, unsigned int meshletIndex) {
+			unsigned int count = 0;
+			for (int k = 0; k < 3; k++) {
+				if (meshletOf[indices[t * 3 + k]] != meshletIndex)
+					count++;
+			}
+			return count;
+		};
+
+		while (emittedCount < numTriangles)
+		{
+			const unsigned int meshletIndex = (unsigned int)meshlets.size();
+			Meshlet meshlet;
+			meshlet.indexOffset = (unsigned int)output.size();
+			meshletVertices.clear();
+			ew::Vec3 positionSum = ew::Vec3(0.0f);
+
+			//Continue next to the previous meshlet so neighbouring meshlets stay neighbours in the index buffer
+			size_t seed = NONE;
+			float seedDistance = FLT_MAX;
+			for (unsigned int v : previousVertices) {
+				for (unsigned int a = offsets[v]; a < offsets[v + 1]; a++) {
+					unsigned int t = adjacency[a];
+					if (emitted[t])
+						continue;
+					ew::Vec3 d = centroids[t] - previousCenter;
+					if (ew::Dot(d, d) < seedDistance) {
+						seedDistance = ew::Dot(d, d);
+						seed = t;
+					}
+				}
+			}
+			if (seed == NONE) {
+				while (emitted[scanCursor])
+					scanCursor++;
+				seed = scanCursor;
+			}
+
+			size_t next = seed;
+			while (next != NONE)
+			{
+				emitted[next] = true;
+				emittedCount++;
+				for (int k = 0; k < 3; k++) {
+					unsigned int v = indices[next * 3 + k];
+					if (meshletOf[v] != meshletIndex) {
+						meshletOf[v] = meshletIndex;
+						meshletVertices.push_back(v);
+						positionSum += vertices[v].pos;
+					}
+					output.push_back(v);
+				}
+				meshlet.triangleCount++;
+				if (meshlet.triangleCount >= maxTriangles)
+					break;
+
+				//Best unemitted neighbour: fewest new vertices, then closest to the meshlet center
+				ew::Vec3 center = positionSum / (float)meshletVertices.size();
+				next = NONE;
+				unsigned int bestNew = 4;
+				float bestDistance = FLT_MAX;
+				for (unsigned int v : meshletVertices) {
+					for (unsigned int a = offsets[v]; a < offsets[v + 1]; a++) {
+						unsigned int t = adjacency[a];
+						if (emitted[t])
+							continue;
+						unsigned int added = newVertices(t, meshletIndex);
+						if (meshletVertices.size() + added > maxVertices)
+							continue;
+						ew::Vec3 d = centroids[t] - center;
+						float distance = ew::Dot(d, d);
+						if (added < bestNew || (added == bestNew && distance < bestDistance)) {
+							bestNew = added;
+							bestDistance = distance;
+							next = t;
+						}
+					}
+				}
+			}
+			meshlet.vertexCount = (unsigned int)meshletVertices.size();
+			computeMeshletBounds(vertices, &output[meshlet.indexOffset], &meshlet, meshletVertices);
+			previousVertices = meshletVertices;
+			previousCenter = positionSum / (float)meshletVertices.size();
+			meshlets.push_back(meshlet);
+		}
+
+		mesh->indices.swap(output);
+		return meshlets;
+	}
+
+	MeshletCullStats cullMeshlets(const std::vector<Meshlet>& meshlets, const ew::Mat4& model, const Frustum& frustum, const ew::Vec3& cameraPosition,
+		std::vector<IndexRange>* ranges)
+	{
+		MeshletCullStats stats;
+		ranges->clear();
+		ew::Mat3 normalMatrix = ew::NormalMatrix(model);
+		//Largest axis scale, so spheres stay conservative
+		float scale = ew::MaxAxisScale(model);
+
+		for (const Meshlet& meshlet : meshlets) {
+			ew::BoundingSphere sphere;
+			sphere.center = (model * ew::Vec4(meshlet.bounds.center, 1.0f)).toVec3();
+			sphere.radius = meshlet.bounds.radius * scale;
+			if (!SphereInFrustum(frustum, sphere)) {
+				stats.frustumCulled++;
+				continue;
+			}
+			if (meshlet.coneCutoff < 1.0f) {
+				ew::Vec3 apex = (model * ew::Vec4(meshlet.coneApex, 1.0f)).toVec3();
+				ew::Vec3 axis = ew::Normalize(normalMatrix * meshlet.coneAxis);
+				ew::Vec3 toApex = apex - cameraPosition;
+				if (ew::Dot(toApex, axis) >= meshlet.coneCutoff * ew::Magnitude(toApex)) {
+					stats.backfaceCulled++;
+					continue;
+				}
+			}
+			stats.visible++;
+			stats.trianglesSubmitted += meshlet.triangleCount;
+			unsigned int count = meshlet.triangleCount * 3;
+			if (!ranges->empty() && ranges->back().first + ranges->back().count == meshlet.indexOffset) {
+				ranges->back().count += count;
+			}
+			else {
+				ranges->push_back({ meshlet.indexOffset, count });
+			}
+		}
+		return stats;
+	}
+}
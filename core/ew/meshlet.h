@@ -0,0 +1,45 @@
+#pragma once
+#include <vector>
+#include "mesh.h"
+#include "frustum.h"
+#include "ewMath/bounds.h"
+
+namespace ew {
+	const unsigned int MESHLET_MAX_VERTICES = 64;
+	const unsigned int MESHLET_MAX_TRIANGLES = 124;
+
+	//A small cluster of triangles stored contiguously in the mesh's index buffer
+	struct Meshlet {
+		unsigned int indexOffset = 0; //First index in MeshData::indices
+		unsigned int triangleCount = 0;
+		unsigned int vertexCount = 0; //Unique vertices
+		ew::BoundingSphere bounds; //Object space
+		//Normal cone. Every triangle is back facing when seen from a point p with
+		//Dot(Normalize(coneApex - p), coneAxis) >= coneCutoff
+		ew::Vec3 coneApex = ew::Vec3(0.0f);
+		ew::Vec3 coneAxis = ew::Vec3(0.0f, 1.0f, 0.0f);
+		float coneCutoff = 1.0f; //1 = never back facing
+	};
+
+	/// <summary>
+	/// Splits a mesh into meshlets by greedily growing each one over neighbouring triangles,
+	/// preferring triangles that add no new vertices and then the closest ones.
+	/// Reorders mesh->indices so every meshlet is one contiguous range. Vertices are not touched
+	/// </summary>
+	std::vector<Meshlet> buildMeshlets(MeshData* mesh, unsigned int maxVertices = MESHLET_MAX_VERTICES, unsigned int maxTriangles = MESHLET_MAX_TRIANGLES);
+
+	struct MeshletCullStats {
+		size_t visible = 0;
+		size_t frustumCulled = 0;
+		size_t backfaceCulled = 0;
+		size_t trianglesSubmitted = 0;
+	};
+
+	/// <summary>
+	/// Rejects meshlets outside the frustum or facing away from the camera, then writes the index ranges
+	/// of the remaining ones to ranges, merging neighbours. Draw them with Mesh::drawRanges.
+	/// frustum and cameraPosition are in world space. The cone test assumes model has uniform scale
+	/// </summary>
+	MeshletCullStats cullMeshlets(const std::vector<Meshlet>& meshlets, const ew::Mat4& model, const Frustum& frustum, const ew::Vec3& cameraPosition,
+		std::vector<IndexRange>* ranges);
+}
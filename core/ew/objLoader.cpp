@@ -0,0 +1,397 @@
+#include "objLoader.h"
+#include "mappedFile.h"
+#include "meshBounds.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <charconv>
+#include <thread>
+#include <algorithm>
+
+namespace ew {
+	//Below this many bytes per thread, spawning workers costs more than it saves
+	const size_t MIN_BYTES_PER_THREAD = 256 * 1024;
+	const int NONE = INT32_MIN;
+	//Corners past this are dropped from a polygon
+	const int MAX_POLYGON_CORNERS = 64;
+
+	//One OBJ corner, 0 based. Missing uv or normal is NONE
+	struct CornerKey {
+		int p, t, n;
+		inline bool operator==(const CornerKey& other)const { return p == other.p && t == other.t && n == other.n; }
+	};
+
+	/// <summary>
+	/// Open addressing (linear probing) map from CornerKey to the key's position in a list of unique keys
+	/// </summary>
+	class CornerTable {
+	public:
+		CornerTable(size_t expectedKeys) {
+			size_t capacity = 16;
+			while (capacity < expectedKeys * 2)
+				capacity *= 2;
+			m_slots.assign(capacity, EMPTY);
+		}
+		//Index of key in keys, appending it if it is new
+		unsigned int insert(const CornerKey& key, std::vector<CornerKey>* keys) {
+			if ((keys->size() + 1) * 2 > m_slots.size())
+				rehash(*keys, m_slots.size() * 2);
+			size_t mask = m_slots.size() - 1;
+			for (size_t i = hash(key) & mask;; i = (i + 1) & mask) {
+				unsigned int slot = m_slots[i];
+				if (slot == EMPTY) {
+					m_slots[i] = (unsigned int)keys->size();
+					keys->push_back(key);
+					return m_slots[i];
+				}
+				if ((*keys)[slot] == key)
+					return slot;
+			}
+		}
+	private:
+		static constexpr unsigned int EMPTY = 0xffffffff;
+		static inline size_t hash(const CornerKey& key) {
+			uint64_t h = (uint64_t)(uint32_t)key.p * 0x9E3779B97F4A7C15ull;
+			h ^= (uint64_t)(uint32_t)key.t * 0xC2B2AE3D27D4EB4Full;
+			h ^= (uint64_t)(uint32_t)key.n * 0x165667B19E3779F9ull;
+			return (size_t)(h ^ (h >> 29));
+		}
+		void rehash(const std::vector<CornerKey>& keys, size_t capacity) {
+			m_slots.assign(capacity, EMPTY);
+			size_t mask = capacity - 1;
+			for (unsigned int k = 0; k < keys.size(); k++) {
+				size_t i = hash(keys[k]) & mask;
+				while (m_slots[i] != EMPTY)
+					i = (i + 1) & mask;
+				m_slots[i] = k;
+			}
+		}
+		std::vector<unsigned int> m_slots;
+	};
+
+	//Everything parsed from one range of lines
+	struct ObjChunk {
+		const char* begin = nullptr;
+		const char* end = nullptr;
+		std::vector<float> positions; //xyz
+		std::vector<float> uvs; //uv
+		std::vector<float> normals; //xyz
+		std::vector<int> corners; //p, t, n per triangle corner
+		std::vector<size_t> relativeCorners; //Entries of corners counting back from this chunk's own elements
+		std::vector<CornerKey> uniqueCorners;
+		std::vector<unsigned int> indices; //Into uniqueCorners, later into the mesh's vertices
+	};
+
+	template<typename Fn>
+	static void runOnThreads(size_t numThreads, Fn fn)
+	{
+		std::vector<std::thread> workers;
+		workers.reserve(numThreads - 1);
+		for (size_t t = 1; t < numThreads; t++) {
+			workers.emplace_back(fn, t);
+		}
+		fn(0);
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+	}
+
+	static inline const char* skipSpaces(const char* p, const char* end)
+	{
+		while (p < end && (*p == ' ' || *p == '\t'))
+			p++;
+		return p;
+	}
+
+	static inline const char* parseFloat(const char* p, const char* end, float* value)
+	{
+		p = skipSpaces(p, end);
+		if (p < end && *p == '+')
+			p++;
+		*value = 0.0f;
+		std::from_chars_result result = std::from_chars(p, end, *value);
+		return result.ptr;
+	}
+
+	/// <summary>
+	/// One face index. Positive indices are made 0 based. Negative ones count back from localCount,
+	/// the number of elements this chunk has seen so far, and are fixed up once earlier chunks are counted
+	/// </summary>
+	static inline const char* parseIndex(const char* p, const char* end, size_t localCount, int* index, bool* relative)
+	{
+		int value = 0;
+		std::from_chars_result result = std::from_chars(p, end, value);
+		*relative = false;
+		if (result.ptr == p || value == 0) {
+			*index = NONE;
+		}
+		else if (value > 0) {
+			*index = value - 1;
+		}
+		else {
+			*index = (int)localCount + value;
+			*relative = true;
+		}
+		return result.ptr;
+	}
+
+	static void parseChunk(ObjChunk* chunk)
+	{
+		//One extra corner to parse dropped corners into
+		int polygon[3 * (MAX_POLYGON_CORNERS + 1)];
+		bool polygonRelative[3 * (MAX_POLYGON_CORNERS + 1)];
+		const char* p = chunk->begin;
+		const char* end = chunk->end;
+		while (p < end)
+		{
+			const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+			if (!lineEnd)
+				lineEnd = end;
+			p = skipSpaces(p, lineEnd);
+			if (lineEnd - p > 2 && p[0] == 'v') {
+				if (p[1] == ' ' || p[1] == '\t') {
+					for (int k = 0; k < 3; k++) {
+						float value;
+						p = parseFloat(p + (k == 0 ? 1 : 0), lineEnd, &value);
+						chunk->positions.push_back(value);
+					}
+				}
+				else if (p[1] == 't') {
+					for (int k = 0; k < 2; k++) {
+						float value;
+						p = parseFloat(p + (k == 0 ? 2 : 0), lineEnd, &value);
+						chunk->uvs.push_back(value);
+					}
+				}
+				else if (p[1] == 'n') {
+					for (int k = 0; k < 3; k++) {
+						float value;
+						p = parseFloat(p + (k == 0 ? 2 : 0), lineEnd, &value);
+						chunk->normals.push_back(value);
+					}
+				}
+			}
+			else if (lineEnd - p > 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+				const size_t localCounts[3] = { chunk->positions.size() / 3, chunk->uvs.size() / 2, chunk->normals.size() / 3 };
+				int numCorners = 0;
+				p = skipSpaces(p + 1, lineEnd);
+				while (p < lineEnd && *p != '\r' && *p != '#')
+				{
+					int* corner = &polygon[numCorners * 3];
+					bool* relative = &polygonRelative[numCorners * 3];
+					corner[1] = corner[2] = NONE;
+					relative[1] = relative[2] = false;
+					const char* start = p;
+					for (int k = 0; k < 3; k++) {
+						p = parseIndex(p, lineEnd, localCounts[k], &corner[k], &relative[k]);
+						if (k == 2 || p >= lineEnd || *p != '/')
+							break;
+						p++;
+					}
+					//Skip whatever could not be parsed
+					while (p < lineEnd && *p != ' ' && *p != '\t' && *p != '\r')
+						p++;
+					p = skipSpaces(p, lineEnd);
+					if (p == start)
+						break;
+					if (numCorners < MAX_POLYGON_CORNERS)
+						numCorners++;
+				}
+				//Fan triangulation
+				for (int i = 1; i + 1 < numCorners; i++) {
+					const int fan[3] = { 0, i, i + 1 };
+					for (int c : fan) {
+						for (int k = 0; k < 3; k++) {
+							if (polygonRelative[c * 3 + k])
+								chunk->relativeCorners.push_back(chunk->corners.size());
+							chunk->corners.push_back(polygon[c * 3 + k]);
+						}
+					}
+				}
+			}
+			p = lineEnd + 1;
+		}
+	}
+
+	/// <summary>
+	/// Fixes up relative indices, drops triangles with invalid positions and deduplicates corners within the chunk
+	/// </summary>
+	static void resolveChunk(ObjChunk* chunk, const size_t bases[3], const size_t totals[3])
+	{
+		for (size_t i : chunk->relativeCorners) {
+			chunk->corners[i] += (int)bases[i % 3];
+		}
+		const size_t numCorners = chunk->corners.size() / 3;
+		CornerTable table(numCorners / 4);
+		chunk->indices.reserve(numCorners);
+		for (size_t tri = 0; tri + 3 <= numCorners; tri += 3)
+		{
+			CornerKey keys[3];
+			bool valid = true;
+			for (int c = 0; c < 3; c++) {
+				const int* corner = &chunk->corners[(tri + c) * 3];
+				keys[c] = { corner[0], corner[1], corner[2] };
+				if (keys[c].p < 0 || (size_t)keys[c].p >= totals[0])
+					valid = false;
+				if (keys[c].t < 0 || (size_t)keys[c].t >= totals[1])
+					keys[c].t = NONE;
+				if (keys[c].n < 0 || (size_t)keys[c].n >= totals[2])
+					keys[c].n = NONE;
+			}
+			if (!valid)
+				continue;
+			for (int c = 0; c < 3; c++) {
+				chunk->indices.push_back(table.insert(keys[c], &chunk->uniqueCorners));
+			}
+		}
+		std::vector<int>().swap(chunk->corners);
+	}
+
+	/// <summary>
+	/// Area weighted normals for vertices that had none in the file
+	/// </summary>
+	static void generateMissingNormals(MeshData* mesh, const std::vector<bool>& missing)
+	{
+		std::vector<ew::Vec3> sums(mesh->vertices.size(), ew::Vec3(0.0f));
+		for (size_t i = 0; i + 2 < mesh->indices.size(); i += 3) {
+			const unsigned int* tri = &mesh->indices[i];
+			const ew::Vec3& p0 = mesh->vertices[tri[0]].pos;
+			//Cross product length is twice the area
+			ew::Vec3 n = ew::Cross(mesh->vertices[tri[1]].pos - p0, mesh->vertices[tri[2]].pos - p0);
+			for (int k = 0; k < 3; k++) {
+				if (missing[tri[k]])
+					sums[tri[k]] += n;
+			}
+		}
+		for (size_t v = 0; v < mesh->vertices.size(); v++) {
+			if (!missing[v])
+				continue;
+			float length = ew::Magnitude(sums[v]);
+			mesh->vertices[v].normal = length > 0.0f ? sums[v] / length : ew::Vec3(0.0f, 1.0f, 0.0f);
+		}
+	}
+
+	/// <summary>
+	/// Four passes. Chunks are parsed in parallel, then each chunk fixes up its relative indices and
+	/// deduplicates its own corners in parallel. Only each chunk's unique corners go through the global
+	/// table, on one thread, which fixes vertex order. Finally vertices and indices are written in parallel
+	/// </summary>
+	MeshData parseObj(const char* text, size_t size, unsigned int numThreads)
+	{
+		MeshData mesh;
+		if (numThreads == 0)
+			numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		size_t numChunks = std::min<size_t>(numThreads, std::max<size_t>(size / MIN_BYTES_PER_THREAD, 1));
+
+		//Chunk boundaries fall just after a line break
+		std::vector<ObjChunk> chunks(numChunks);
+		const char* textEnd = text + size;
+		const char* cursor = text;
+		for (size_t c = 0; c < numChunks; c++) {
+			const char* chunkEnd = c + 1 == numChunks ? textEnd : std::max(cursor, text + size / numChunks * (c + 1));
+			if (chunkEnd < textEnd) {
+				const char* lineEnd = (const char*)memchr(chunkEnd, '\n', textEnd - chunkEnd);
+				chunkEnd = lineEnd ? lineEnd + 1 : textEnd;
+			}
+			chunks[c].begin = cursor;
+			chunks[c].end = chunkEnd;
+			cursor = chunkEnd;
+		}
+		runOnThreads(numChunks, [&](size_t c) {
+			parseChunk(&chunks[c]);
+		});
+
+		//Each chunk's first element in the combined attribute arrays
+		std::vector<size_t> bases(numChunks * 3);
+		size_t totals[3] = { 0, 0, 0 };
+		for (size_t c = 0; c < numChunks; c++) {
+			const size_t counts[3] = { chunks[c].positions.size() / 3, chunks[c].uvs.size() / 2, chunks[c].normals.size() / 3 };
+			for (int k = 0; k < 3; k++) {
+				bases[c * 3 + k] = totals[k];
+				totals[k] += counts[k];
+			}
+		}
+		std::vector<float> positions(totals[0] * 3), uvs(totals[1] * 2), normals(totals[2] * 3);
+		runOnThreads(numChunks, [&](size_t c) {
+			ObjChunk& chunk = chunks[c];
+			std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + bases[c * 3] * 3);
+			std::copy(chunk.uvs.begin(), chunk.uvs.end(), uvs.begin() + bases[c * 3 + 1] * 2);
+			std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + bases[c * 3 + 2] * 3);
+			std::vector<float>().swap(chunk.positions);
+			std::vector<float>().swap(chunk.uvs);
+			std::vector<float>().swap(chunk.normals);
+			resolveChunk(&chunk, &bases[c * 3], totals);
+		});
+
+		//Chunk unique corner -> mesh vertex
+		std::vector<std::vector<unsigned int>> remaps(numChunks);
+		std::vector<CornerKey> vertexKeys;
+		size_t numUnique = 0, numIndices = 0;
+		for (const ObjChunk& chunk : chunks) {
+			numUnique += chunk.uniqueCorners.size();
+			numIndices += chunk.indices.size();
+		}
+		CornerTable table(numUnique);
+		vertexKeys.reserve(numUnique);
+		for (size_t c = 0; c < numChunks; c++) {
+			remaps[c].resize(chunks[c].uniqueCorners.size());
+			for (size_t i = 0; i < chunks[c].uniqueCorners.size(); i++) {
+				remaps[c][i] = table.insert(chunks[c].uniqueCorners[i], &vertexKeys);
+			}
+		}
+
+		std::vector<size_t> indexOffsets(numChunks, 0);
+		for (size_t c = 1; c < numChunks; c++) {
+			indexOffsets[c] = indexOffsets[c - 1] + chunks[c - 1].indices.size();
+		}
+		mesh.vertices.resize(vertexKeys.size());
+		mesh.indices.resize(numIndices);
+		std::vector<bool> missingNormals(vertexKeys.size(), false);
+		bool anyMissingNormals = false;
+		for (size_t v = 0; v < vertexKeys.size(); v++) {
+			if (vertexKeys[v].n == NONE) {
+				missingNormals[v] = true;
+				anyMissingNormals = true;
+			}
+		}
+		const size_t verticesPerChunk = (vertexKeys.size() + numChunks - 1) / numChunks;
+		runOnThreads(numChunks, [&](size_t c) {
+			const ObjChunk& chunk = chunks[c];
+			unsigned int* out = mesh.indices.data() + indexOffsets[c];
+			for (size_t i = 0; i < chunk.indices.size(); i++) {
+				out[i] = remaps[c][chunk.indices[i]];
+			}
+			size_t first = std::min(c * verticesPerChunk, vertexKeys.size());
+			size_t last = std::min(first + verticesPerChunk, vertexKeys.size());
+			for (size_t v = first; v < last; v++) {
+				const CornerKey& key = vertexKeys[v];
+				Vertex& vertex = mesh.vertices[v];
+				const float* position = &positions[(size_t)key.p * 3];
+				vertex.pos = ew::Vec3(position[0], position[1], position[2]);
+				if (key.n != NONE) {
+					const float* normal = &normals[(size_t)key.n * 3];
+					vertex.normal = ew::Vec3(normal[0], normal[1], normal[2]);
+				}
+				if (key.t != NONE) {
+					const float* uv = &uvs[(size_t)key.t * 2];
+					vertex.uv = ew::Vec2(uv[0], uv[1]);
+				}
+			}
+		});
+		if (anyMissingNormals)
+			generateMissingNormals(&mesh, missingNormals);
+		computeBounds(&mesh);
+		return mesh;
+	}
+
+	MeshData loadObj(const std::string& filePath, unsigned int numThreads)
+	{
+		MappedFile file;
+		if (!file.open(filePath)) {
+			printf("Failed to load OBJ %s\n", filePath.c_str());
+			return {};
+		}
+		return parseObj((const char*)file.data(), file.size(), numThreads);
+	}
+}
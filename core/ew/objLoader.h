@@ -0,0 +1,16 @@
+#pragma once
+#include <string>
+#include "mesh.h"
+
+namespace ew {
+	/// <summary>
+	/// Loads a Wavefront OBJ file (v, vt, vn and f lines, everything else is ignored) into a single MeshData.
+	/// The file is memory mapped and parsed in chunks on numThreads threads, 0 meaning one per hardware thread.
+	/// Each unique position/uv/normal combination becomes one vertex, in order of first use.
+	/// Polygons are triangulated as fans. Vertices without a normal get the area weighted normal of their triangles.
+	/// Returns an empty MeshData on failure
+	/// </summary>
+	MeshData loadObj(const std::string& filePath, unsigned int numThreads = 0);
+	//Same as loadObj, for OBJ text already in memory
+	MeshData parseObj(const char* text, size_t size, unsigned int numThreads = 0);
+}
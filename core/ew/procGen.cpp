@@ -4,6 +4,7 @@
 
 
 #include "procGen.h"
+#include "meshBounds.h"
 #include <stdlib.h>
 
 namespace ew {
@@ -55,6 +56,7 @@ namespace ew {
 		createCubeFace(ew::Vec3{ -1.0f,+0.0f,+0.0f }, size, &mesh); //Left
 		createCubeFace(ew::Vec3{ +0.0f,-1.0f,+0.0f }, size, &mesh); //Bottom
 		createCubeFace(ew::Vec3{ +0.0f,+0.0f,-1.0f }, size, &mesh); //Back
+		computeBounds(&mesh);
 		return mesh;
 	}
 	MeshData createPlane(float width, float height, int subdivisions)
@@ -90,6 +92,7 @@ namespace ew {
 				mesh.indices.push_back(start);
 			}
 		}
+		computeBounds(&mesh);
 		return mesh;
 	}
 	MeshData createSphere(float radius, int subdivisions)
@@ -149,6 +152,7 @@ namespace ew {
 			mesh.indices.push_back(sideStart + i + 1);
 			mesh.indices.push_back(poleStart + i);
 		}
+		computeBounds(&mesh);
 		return mesh;
 	}
 	void createCylinderRing(MeshData* meshData, float radius, int subdivisions, float y, bool sideFacing) {
@@ -232,6 +236,7 @@ namespace ew {
 				mesh.indices.push_back(sideStart + i + 1);
 			}
 		}
+		computeBounds(&mesh);
 		return mesh;
 	}
 }
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include "programCache.h"
+#include "external/glad.h"
+#include <stdio.h>
+#include <fstream>
+#include <vector>
+#include <filesystem>
+
+namespace ew {
+	const uint64_t FNV64_OFFSET = 14695981039346656037ull;
+	const uint64_t FNV64_PRIME = 1099511628211ull;
+
+	//64 bit FNV-1a, continued from hash. The length is mixed in too, so "ab"+"c" and "a"+"bc" differ
+	static uint64_t hashBytes(uint64_t hash, std::string_view s)
+	{
+		for (char c : s) {
+			hash ^= (unsigned char)c;
+			hash *= FNV64_PRIME;
+		}
+		for (size_t i = 0, length = s.size(); i < sizeof(length); i++, length >>= 8) {
+			hash ^= length & 0xff;
+			hash *= FNV64_PRIME;
+		}
+		return hash;
+	}
+
+	static std::string_view getDriverString(GLenum name)
+	{
+		const char* s = (const char*)glGetString(name);
+		return s ? std::string_view(s) : std::string_view();
+	}
+
+	ProgramCache::ProgramCache(const std::string& directory)
+	{
+		setDirectory(directory);
+	}
+
+	void ProgramCache::setDirectory(const std::string& directory)
+	{
+		m_directory = directory;
+	}
+
+	void ProgramCache::queryDriver()
+	{
+		if (m_queried)
+			return;
+		m_queried = true;
+		GLint numFormats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+		m_supported = numFormats > 0;
+		m_driverHash = FNV64_OFFSET;
+		m_driverHash = hashBytes(m_driverHash, getDriverString(GL_VENDOR));
+		m_driverHash = hashBytes(m_driverHash, getDriverString(GL_RENDERER));
+		m_driverHash = hashBytes(m_driverHash, getDriverString(GL_VERSION));
+		m_driverHash = hashBytes(m_driverHash, getDriverString(GL_SHADING_LANGUAGE_VERSION));
+	}
+
+	bool ProgramCache::isSupported()
+	{
+		queryDriver();
+		return m_supported;
+	}
+
+	uint64_t ProgramCache::computeKey(std::string_view vertexSource, std::string_view fragmentSource)
+	{
+		queryDriver();
+		uint64_t hash = hashBytes(m_driverHash, vertexSource);
+		hash = hashBytes(hash, fragmentSource);
+		//0 is never a valid key
+		return hash ? hash : 1;
+	}
+
+	std::string ProgramCache::getEntryPath(uint64_t key) const
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+		return (std::filesystem::path(m_directory) / name).string();
+	}
+
+	/// <summary>
+	/// A missing file is a miss. A file that is unreadable, from another version or rejected by glProgramBinary
+	/// (e.g. the driver changed without changing its version string) is evicted and also counts as a miss
+	/// </summary>
+	unsigned int ProgramCache::load(uint64_t key)
+	{
+		if (!isSupported() || key == 0) {
+			m_numMisses++;
+			return 0;
+		}
+		std::ifstream file(getEntryPath(key), std::ios::binary);
+		if (!file.is_open()) {
+			m_numMisses++;
+			return 0;
+		}
+		ProgramCacheHeader header;
+		std::vector<char> binary;
+		file.read((char*)&header, sizeof(ProgramCacheHeader));
+		bool valid = file.gcount() == sizeof(ProgramCacheHeader) && header.magic == PROGRAM_CACHE_MAGIC
+			&& header.version == PROGRAM_CACHE_VERSION && header.key == key && header.binarySize > 0;
+		if (valid) {
+			binary.resize(header.binarySize);
+			file.read(binary.data(), (std::streamsize)binary.size());
+			valid = file.gcount() == (std::streamsize)binary.size();
+		}
+		file.close();
+
+		unsigned int program = 0;
+		if (valid) {
+			program = glCreateProgram();
+			glProgramBinary(program, header.binaryFormat, binary.data(), (GLsizei)binary.size());
+			GLint success = 0;
+			glGetProgramiv(program, GL_LINK_STATUS, &success);
+			if (!success) {
+				glDeleteProgram(program);
+				program = 0;
+			}
+		}
+		if (program == 0) {
+			printf("Evicting invalid program cache entry %s\n", getEntryPath(key).c_str());
+			evict(key);
+			m_numMisses++;
+			return 0;
+		}
+		m_numHits++;
+		return program;
+	}
+
+	/// <summary>
+	/// Written to a temporary file first and renamed, so a crash mid write never leaves a truncated entry behind
+	/// </summary>
+	bool ProgramCache::store(uint64_t key, unsigned int program)
+	{
+		if (!isSupported() || key == 0 || program == 0)
+			return false;
+		GLint linked = 0, binarySize = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+		if (!linked || binarySize <= 0)
+			return false;
+		std::vector<char> binary(binarySize);
+		GLenum binaryFormat = 0;
+		GLsizei length = 0;
+		glGetProgramBinary(program, binarySize, &length, &binaryFormat, binary.data());
+		if (length <= 0)
+			return false;
+
+		std::error_code error;
+		std::filesystem::create_directories(m_directory, error);
+		const std::string path = getEntryPath(key);
+		const std::string tempPath = path + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) {
+				printf("Failed to write program cache entry %s\n", path.c_str());
+				return false;
+			}
+			ProgramCacheHeader header;
+			header.key = key;
+			header.binaryFormat = binaryFormat;
+			header.binarySize = (uint32_t)length;
+			file.write((const char*)&header, sizeof(ProgramCacheHeader));
+			file.write(binary.data(), length);
+			if (!file.good()) {
+				file.close();
+				std::filesystem::remove(tempPath, error);
+				printf("Failed to write program cache entry %s\n", path.c_str());
+				return false;
+			}
+		}
+		std::filesystem::rename(tempPath, path, error);
+		if (error) {
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+		return true;
+	}
+
+	void ProgramCache::evict(uint64_t key)
+	{
+		std::error_code error;
+		if (std::filesystem::remove(getEntryPath(key), error))
+			m_numEvictions++;
+	}
+
+	void ProgramCache::clear()
+	{
+		std::error_code error;
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(m_directory, error)) {
+			const std::filesystem::path& path = entry.path();
+			if (path.extension() == ".bin" || path.extension() == ".tmp")
+				std::filesystem::remove(path, error);
+		}
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <stdint.h>
+
+namespace ew {
+	/*
+		<directory>/<key as 16 hex digits>.bin layout:
+		ProgramCacheHeader
+		Driver specific program binary, binarySize bytes
+	*/
+	const uint32_t PROGRAM_CACHE_MAGIC = 0x50435745; //"EWCP"
+	const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+	struct ProgramCacheHeader {
+		uint32_t magic = PROGRAM_CACHE_MAGIC;
+		uint32_t version = PROGRAM_CACHE_VERSION;
+		uint64_t key = 0; //Must match the file name, guards against renamed or truncated files
+		uint32_t binaryFormat = 0; //From glGetProgramBinary
+		uint32_t binarySize = 0;
+	};
+
+	/// <summary>
+	/// On disk cache of linked program binaries (glGetProgramBinary/glProgramBinary).
+	/// Entries are keyed by the GLSL sources and the driver's vendor, renderer and version strings,
+	/// so a driver update or an edited shader never loads a stale binary.
+	/// A binary the driver rejects anyway is deleted and the program is compiled from source again
+	/// </summary>
+	class ProgramCache {
+	public:
+		ProgramCache() {};
+		ProgramCache(const std::string& directory);
+		//Created on the first store
+		void setDirectory(const std::string& directory);
+		inline const std::string& getDirectory()const { return m_directory; }
+		//False if the driver exposes no binary formats. Needs a current context
+		bool isSupported();
+		//Needs a current context, the driver strings are part of the key
+		uint64_t computeKey(std::string_view vertexSource, std::string_view fragmentSource);
+		//Linked program, or 0 if there is no valid entry. Entries the driver rejects are evicted
+		unsigned int load(uint64_t key);
+		//The program should be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT, see createShaderProgram
+		bool store(uint64_t key, unsigned int program);
+		void evict(uint64_t key);
+		//Deletes every entry in the directory
+		void clear();
+		inline unsigned int getNumHits()const { return m_numHits; }
+		inline unsigned int getNumMisses()const { return m_numMisses; }
+		inline unsigned int getNumEvictions()const { return m_numEvictions; }
+	private:
+		std::string getEntryPath(uint64_t key)const;
+		void queryDriver();
+		std::string m_directory = "shaderCache";
+		bool m_queried = false;
+		bool m_supported = false;
+		uint64_t m_driverHash = 0;
+		unsigned int m_numHits = 0;
+		unsigned int m_numMisses = 0;
+		unsigned int m_numEvictions = 0;
+	};
+}
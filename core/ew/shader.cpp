@@ -2,6 +2,8 @@
 #include <fstream>
 #include <sstream>
 #include "external/glad.h"
+#include "uniformBlocks.h"
+#include "shaderPreprocessor.h"
 
 namespace ew {
 	/// <summary>
@@ -45,12 +47,11 @@ namespace ew {
 	}
 
 	/// <summary>
-	/// Creates a shader program with a vertex and fragment shader
+	/// Compiles both stages and links them into a program
 	/// </summary>
-	/// <param name="vertexShaderSource">GLSL source code for the vertex shader</param>
-	/// <param name="fragmentShaderSource">GLSL source code for the fragment shader</param>
+	/// <param name="retrievable">Asks the driver to keep the binary around for glGetProgramBinary</param>
 	/// <returns></returns>
-	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource) {
+	static unsigned int linkShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource, bool retrievable) {
 		unsigned int vertexShader = createShader(GL_VERTEX_SHADER, vertexShaderSource);
 		unsigned int fragmentShader = createShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
 
@@ -58,6 +59,8 @@ namespace ew {
 		//Attach each stage
 		glAttachShader(shaderProgram, vertexShader);
 		glAttachShader(shaderProgram, fragmentShader);
+		if (retrievable)
+			glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 		//Link all the stages together
 		glLinkProgram(shaderProgram);
 		int success;
@@ -72,56 +75,99 @@ namespace ew {
 		glDeleteShader(fragmentShader);
 		return shaderProgram;
 	}
+
+	/// <summary>
+	/// Creates a shader program with a vertex and fragment shader
+	/// </summary>
+	/// <param name="vertexShaderSource">GLSL source code for the vertex shader</param>
+	/// <param name="fragmentShaderSource">GLSL source code for the fragment shader</param>
+	/// <returns></returns>
+	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource) {
+		return linkShaderProgram(vertexShaderSource, fragmentShaderSource, false);
+	}
+
 	/// <summary>
-	/// Creates a shader instance with vertex + fragment stages
+	/// Loads the program from the cache if it holds a binary for these sources on this driver.
+	/// Otherwise compiles it from source and stores the binary for the next launch
+	/// </summary>
+	/// <param name="cache">May be null, then this is the same as createShaderProgram without a cache</param>
+	/// <returns></returns>
+	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource, ProgramCache* cache) {
+		if (!cache || !cache->isSupported())
+			return linkShaderProgram(vertexShaderSource, fragmentShaderSource, false);
+		uint64_t key = cache->computeKey(vertexShaderSource, fragmentShaderSource);
+		unsigned int program = cache->load(key);
+		if (program != 0)
+			return program;
+		program = linkShaderProgram(vertexShaderSource, fragmentShaderSource, true);
+		cache->store(key, program);
+		return program;
+	}
+	/// <summary>
+	/// Creates a shader instance with vertex + fragment stages.
+	/// Both stages go through preprocessShader, so they may #include shared files
 	/// </summary>
 	/// <param name="vertexShader">File path to vertex shader</param>
 	/// <param name="fragmentShader">File path to fragment shader</param>
-	Shader::Shader(const std::string& vertexShader, const std::string& fragmentShader)
+	/// <param name="cache">Optional program binary cache</param>
+	Shader::Shader(const std::string& vertexShader, const std::string& fragmentShader, ProgramCache* cache)
+	{
+		std::string vertexShaderSource = ew::preprocessShader(vertexShader);
+		std::string fragmentShaderSource = ew::preprocessShader(fragmentShader);
+		setProgram(ew::createShaderProgram(vertexShaderSource.c_str(), fragmentShaderSource.c_str(), cache));
+	}
+	void Shader::setProgram(unsigned int program)
 	{
-		std::string vertexShaderSource = ew::loadShaderSourceFromFile(vertexShader.c_str());
-		std::string fragmentShaderSource = ew::loadShaderSourceFromFile(fragmentShader.c_str());
-		m_id = ew::createShaderProgram(vertexShaderSource.c_str(), fragmentShaderSource.c_str());
+		m_id = program;
+		m_uniforms.build(m_id);
+		ew::bindUniformBlocks(m_id);
 	}
 	void Shader::use()const
 	{
-		glUseProgram(m_id);
+		if (m_id == 0 && m_fallback)
+			glUseProgram(m_fallback->m_id);
+		else
+			glUseProgram(m_id);
+	}
+	void Shader::setInt(UniformHandle uniform, int v) const
+	{
+		glUniform1i(uniform.location, v);
 	}
-	void Shader::setInt(const std::string& name, int v) const
+	void Shader::setFloat(UniformHandle uniform, float v) const
 	{
-		glUniform1i(glGetUniformLocation(m_id, name.c_str()), v);
+		glUniform1f(uniform.location, v);
 	}
-	void Shader::setFloat(const std::string& name, float v) const
+	void Shader::setVec2(UniformHandle uniform, float x, float y) const
 	{
-		glUniform1f(glGetUniformLocation(m_id, name.c_str()), v);
+		glUniform2f(uniform.location, x, y);
 	}
-	void Shader::setVec2(const std::string& name, float x, float y) const
+	void Shader::setVec2(UniformHandle uniform, const ew::Vec2& v) const
 	{
-		glUniform2f(glGetUniformLocation(m_id, name.c_str()), x, y);
+		setVec2(uniform, v.x, v.y);
 	}
-	void Shader::setVec2(const std::string& name, const ew::Vec2& v) const
+	void Shader::setVec3(UniformHandle uniform, float x, float y, float z) const
 	{
-		setVec2(name, v.x, v.y);
+		glUniform3f(uniform.location, x, y, z);
 	}
-	void Shader::setVec3(const std::string& name, float x, float y, float z) const
+	void Shader::setVec3(UniformHandle uniform, const ew::Vec3& v) const
 	{
-		glUniform3f(glGetUniformLocation(m_id, name.c_str()), x, y, z);
+		setVec3(uniform, v.x, v.y, v.z);
 	}
-	void Shader::setVec3(const std::string& name, const ew::Vec3& v) const
+	void Shader::setVec4(UniformHandle uniform, float x, float y, float z, float w) const
 	{
-		setVec3(name, v.x, v.y, v.z);
+		glUniform4f(uniform.location, x, y, z, w);
 	}
-	void Shader::setVec4(const std::string& name, float x, float y, float z, float w) const
+	void Shader::setVec4(UniformHandle uniform, const ew::Vec4& v) const
 	{
-		glUniform4f(glGetUniformLocation(m_id, name.c_str()), x, y, z, w);
+		setVec4(uniform, v.x, v.y, v.z, v.w);
 	}
-	void Shader::setVec4(const std::string& name, const ew::Vec4& v) const
+	void Shader::setMat3(UniformHandle uniform, const ew::Mat3& m) const
 	{
-		setVec4(name, v.x, v.y, v.z, v.w);
+		glUniformMatrix3fv(uniform.location, 1, GL_FALSE, &m[0].x);
 	}
-	void Shader::setMat4(const std::string& name, const ew::Mat4& m) const
+	void Shader::setMat4(UniformHandle uniform, const ew::Mat4& m) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(m_id, name.c_str()), 1, GL_FALSE, &m[0][0]);
+		glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &m[0][0]);
 	}
 }
 
@@ -1,24 +1,61 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include "ewMath/ewMath.h"
+#include "uniformTable.h"
+#include "programCache.h"
 
 namespace ew {
 	std::string loadShaderSourceFromFile(const std::string& filePath);
 	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource);
+	//Loads a cached binary of the program if there is one, otherwise compiles it and caches the binary
+	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource, ProgramCache* cache);
+	class ShaderCompiler;
+
+	/// <summary>
+	/// Uniform locations are read from the program once, when it is linked. Setters taking a name look it up in that table,
+	/// so they make no glGetUniformLocation calls and no allocations. Handles from getUniform skip the lookup too.
+	/// A default constructed shader is filled in later by a ShaderCompiler. Until then use() binds its fallback and
+	/// uniforms are looked up in the fallback's table, so handles should be resolved again once isReady()
+	/// </summary>
 	class Shader {
 	public:
-		Shader(const std::string& vertexShader, const std::string& fragmentShader);
+		Shader() {};
+		Shader(const std::string& vertexShader, const std::string& fragmentShader, ProgramCache* cache = nullptr);
 		void use()const;
-		void setInt(const std::string& name, int v) const;
-		void setFloat(const std::string& name, float v) const;
-		void setVec2(const std::string& name, float x, float y) const;
-		void setVec2(const std::string& name, const ew::Vec2& v) const;
-		void setVec3(const std::string& name, float x, float y, float z) const;
-		void setVec3(const std::string& name, const ew::Vec3& v) const;
-		void setVec4(const std::string& name, float x, float y, float z, float w) const;
-		void setVec4(const std::string& name, const ew::Vec4& v) const;
-		void setMat4(const std::string& name, const ew::Mat4& m) const;
+		inline bool isReady()const { return m_id != 0; }
+		//Bound by use() and used for uniform lookups while this shader is not ready. May be null
+		inline void setFallback(const Shader* fallback) { m_fallback = fallback; }
+		inline UniformHandle getUniform(std::string_view name)const { return UniformHandle{ getActiveUniforms().find(name) }; }
+		inline const UniformTable& getUniforms()const { return m_uniforms; }
+		void setInt(UniformHandle uniform, int v) const;
+		void setFloat(UniformHandle uniform, float v) const;
+		void setVec2(UniformHandle uniform, float x, float y) const;
+		void setVec2(UniformHandle uniform, const ew::Vec2& v) const;
+		void setVec3(UniformHandle uniform, float x, float y, float z) const;
+		void setVec3(UniformHandle uniform, const ew::Vec3& v) const;
+		void setVec4(UniformHandle uniform, float x, float y, float z, float w) const;
+		void setVec4(UniformHandle uniform, const ew::Vec4& v) const;
+		void setMat3(UniformHandle uniform, const ew::Mat3& m) const;
+		void setMat4(UniformHandle uniform, const ew::Mat4& m) const;
+		//Inline, so the names of literals are hashed at compile time
+		inline void setInt(std::string_view name, int v) const { setInt(getUniform(name), v); }
+		inline void setFloat(std::string_view name, float v) const { setFloat(getUniform(name), v); }
+		inline void setVec2(std::string_view name, float x, float y) const { setVec2(getUniform(name), x, y); }
+		inline void setVec2(std::string_view name, const ew::Vec2& v) const { setVec2(getUniform(name), v); }
+		inline void setVec3(std::string_view name, float x, float y, float z) const { setVec3(getUniform(name), x, y, z); }
+		inline void setVec3(std::string_view name, const ew::Vec3& v) const { setVec3(getUniform(name), v); }
+		inline void setVec4(std::string_view name, float x, float y, float z, float w) const { setVec4(getUniform(name), x, y, z, w); }
+		inline void setVec4(std::string_view name, const ew::Vec4& v) const { setVec4(getUniform(name), v); }
+		inline void setMat3(std::string_view name, const ew::Mat3& m) const { setMat3(getUniform(name), m); }
+		inline void setMat4(std::string_view name, const ew::Mat4& m) const { setMat4(getUniform(name), m); }
 	private:
-		unsigned int m_id; //Shader program handle
+		friend class ShaderCompiler;
+		//Takes ownership of a linked program
+		void setProgram(unsigned int program);
+		inline const UniformTable& getActiveUniforms()const { return (m_id == 0 && m_fallback) ? m_fallback->m_uniforms : m_uniforms; }
+		unsigned int m_id = 0; //Shader program handle, 0 until ready
+		UniformTable m_uniforms;
+		const Shader* m_fallback = nullptr;
 	};
 }
\ No newline at end of file
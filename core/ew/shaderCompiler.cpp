@@ -0,0 +1,156 @@
+#include "shaderCompiler.h"
+#include "shaderPreprocessor.h"
+#include "external/glad.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace ew {
+	typedef void (GLAD_API_PTR* PFNMAXSHADERCOMPILERTHREADSPROC)(GLuint count);
+
+	static bool hasExtension(const char* name)
+	{
+		GLint numExtensions = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+		for (GLint i = 0; i < numExtensions; i++) {
+			const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+			if (extension && strcmp(extension, name) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	static void printShaderLog(unsigned int shader)
+	{
+		GLint success = 0;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+		if (success)
+			return;
+		char infoLog[512];
+		glGetShaderInfoLog(shader, 512, NULL, infoLog);
+		printf("Failed to compile shader: %s", infoLog);
+	}
+
+	static unsigned int startCompile(GLenum shaderType, const std::string& sourceCode)
+	{
+		unsigned int shader = glCreateShader(shaderType);
+		const char* source = sourceCode.c_str();
+		glShaderSource(shader, 1, &source, NULL);
+		glCompileShader(shader);
+		return shader;
+	}
+
+	/// <summary>
+	/// The KHR and ARB extensions share their enums and differ only in the entry point's suffix.
+	/// Letting the driver pick the thread count (0xFFFFFFFF) is what the extension recommends
+	/// </summary>
+	void ShaderCompiler::init(ProcAddressLoader load, ProgramCache* cache)
+	{
+		m_cache = cache;
+		m_parallel = false;
+		PFNMAXSHADERCOMPILERTHREADSPROC maxShaderCompilerThreads = nullptr;
+		if (load && hasExtension("GL_KHR_parallel_shader_compile"))
+			maxShaderCompilerThreads = (PFNMAXSHADERCOMPILERTHREADSPROC)load("glMaxShaderCompilerThreadsKHR");
+		else if (load && hasExtension("GL_ARB_parallel_shader_compile"))
+			maxShaderCompilerThreads = (PFNMAXSHADERCOMPILERTHREADSPROC)load("glMaxShaderCompilerThreadsARB");
+		if (maxShaderCompilerThreads) {
+			maxShaderCompilerThreads(0xFFFFFFFF);
+			m_parallel = true;
+		}
+	}
+
+	void ShaderCompiler::add(Shader* shader, const std::string& vertexShader, const std::string& fragmentShader, const Shader* fallback)
+	{
+		addSource(shader, ew::preprocessShader(vertexShader), ew::preprocessShader(fragmentShader), fallback);
+	}
+
+	/// <summary>
+	/// Nothing here queries a status, so the driver is free to defer the work
+	/// </summary>
+	void ShaderCompiler::addSource(Shader* shader, const std::string& vertexShaderSource, const std::string& fragmentShaderSource, const Shader* fallback)
+	{
+		if (!shader)
+			return;
+		shader->setFallback(fallback ? fallback : m_fallback);
+
+		Pending pending;
+		pending.shader = shader;
+		if (m_cache && m_cache->isSupported()) {
+			pending.cacheKey = m_cache->computeKey(vertexShaderSource, fragmentShaderSource);
+			unsigned int program = m_cache->load(pending.cacheKey);
+			if (program != 0) {
+				shader->setProgram(program);
+				return;
+			}
+		}
+		pending.vertexShader = startCompile(GL_VERTEX_SHADER, vertexShaderSource);
+		pending.fragmentShader = startCompile(GL_FRAGMENT_SHADER, fragmentShaderSource);
+		pending.program = glCreateProgram();
+		glAttachShader(pending.program, pending.vertexShader);
+		glAttachShader(pending.program, pending.fragmentShader);
+		if (pending.cacheKey != 0)
+			glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glLinkProgram(pending.program);
+		m_pending.push_back(pending);
+	}
+
+	bool ShaderCompiler::isComplete(const Pending& pending) const
+	{
+		if (!m_parallel)
+			return true;
+		GLint complete = 0;
+		glGetProgramiv(pending.program, COMPLETION_STATUS, &complete);
+		return complete != 0;
+	}
+
+	void ShaderCompiler::complete(const Pending& pending)
+	{
+		GLint success = 0;
+		glGetProgramiv(pending.program, GL_LINK_STATUS, &success);
+		if (success) {
+			if (m_cache && pending.cacheKey != 0)
+				m_cache->store(pending.cacheKey, pending.program);
+			pending.shader->setProgram(pending.program);
+		}
+		else {
+			printShaderLog(pending.vertexShader);
+			printShaderLog(pending.fragmentShader);
+			char infoLog[512];
+			glGetProgramInfoLog(pending.program, 512, NULL, infoLog);
+			printf("Failed to link shader program: %s", infoLog);
+			glDeleteProgram(pending.program);
+			m_numFailed++;
+		}
+		glDeleteShader(pending.vertexShader);
+		glDeleteShader(pending.fragmentShader);
+	}
+
+	size_t ShaderCompiler::poll()
+	{
+		size_t numCompleted = 0;
+		size_t numPending = 0;
+		for (size_t i = 0; i < m_pending.size(); i++) {
+			const Pending& pending = m_pending[i];
+			//Without the extension every status query waits, so only one program is finished per poll
+			if (!m_parallel && numCompleted > 0) {
+				m_pending[numPending++] = pending;
+				continue;
+			}
+			if (!isComplete(pending)) {
+				m_pending[numPending++] = pending;
+				continue;
+			}
+			complete(pending);
+			numCompleted++;
+		}
+		m_pending.resize(numPending);
+		return m_pending.size();
+	}
+
+	void ShaderCompiler::finish()
+	{
+		for (const Pending& pending : m_pending) {
+			complete(pending);
+		}
+		m_pending.clear();
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "shader.h"
+#include "programCache.h"
+
+namespace ew {
+	//GL_KHR_parallel_shader_compile / GL_ARB_parallel_shader_compile, not part of the generated loader
+	const unsigned int COMPLETION_STATUS = 0x91B1; //GL_COMPLETION_STATUS_KHR
+	const unsigned int MAX_SHADER_COMPILER_THREADS = 0x91B0; //GL_MAX_SHADER_COMPILER_THREADS_KHR
+
+	//Same signature as GLADloadfunc and glfwGetProcAddress
+	typedef void (*ProcAddress)(void);
+	typedef ProcAddress(*ProcAddressLoader)(const char* name);
+
+	/// <summary>
+	/// Compiles many programs without waiting on any of them. add() issues the compile and link calls and returns,
+	/// poll() hands the programs the driver has finished to their Shader. Unfinished shaders draw with their fallback.
+	/// With GL_KHR_parallel_shader_compile the driver compiles on its own threads and poll() never blocks.
+	/// Without it, querying a status waits for that program, so poll() finishes at most one program per call
+	/// </summary>
+	class ShaderCompiler {
+	public:
+		ShaderCompiler() {};
+		//Needs a current context. load is the function given to gladLoadGL, used to find the extension's entry point
+		void init(ProcAddressLoader load, ProgramCache* cache = nullptr);
+		//Used by shaders added without their own fallback
+		inline void setFallback(const Shader* fallback) { m_fallback = fallback; }
+		/// <summary>
+		/// Starts compiling the program. shader must stay at the same address until it is ready.
+		/// If the cache holds a binary for these sources, the shader is ready when this returns
+		/// </summary>
+		void add(Shader* shader, const std::string& vertexShader, const std::string& fragmentShader, const Shader* fallback = nullptr);
+		//Same as add, with GLSL sources rather than file paths
+		void addSource(Shader* shader, const std::string& vertexShaderSource, const std::string& fragmentShaderSource, const Shader* fallback = nullptr);
+		//Gives finished programs to their shaders. Returns the number still compiling
+		size_t poll();
+		//Blocks until every program is finished
+		void finish();
+		inline bool isParallel()const { return m_parallel; }
+		inline size_t getNumPending()const { return m_pending.size(); }
+		//Programs that failed to compile or link. Their shaders keep drawing with the fallback
+		inline unsigned int getNumFailed()const { return m_numFailed; }
+	private:
+		struct Pending {
+			Shader* shader = nullptr;
+			unsigned int program = 0;
+			unsigned int vertexShader = 0;
+			unsigned int fragmentShader = 0;
+			uint64_t cacheKey = 0;
+		};
+		bool isComplete(const Pending& pending)const;
+		void complete(const Pending& pending);
+		std::vector<Pending> m_pending;
+		const Shader* m_fallback = nullptr;
+		ProgramCache* m_cache = nullptr;
+		bool m_parallel = false;
+		unsigned int m_numFailed = 0;
+	};
+}
@@ -0,0 +1,179 @@
+#include "shaderPreprocessor.h"
+#include "shader.h"
+#include <stdio.h>
+#include <algorithm>
+#include <filesystem>
+
+namespace ew {
+	//Maximum #include nesting, deeper includes are dropped with an error
+	const int MAX_INCLUDE_DEPTH = 32;
+
+	static std::string_view trim(std::string_view s)
+	{
+		size_t first = s.find_first_not_of(" \t\r");
+		if (first == std::string_view::npos)
+			return {};
+		size_t last = s.find_last_not_of(" \t\r");
+		return s.substr(first, last - first + 1);
+	}
+
+	//Directive name after '#', e.g. "include" for "  #  include "a.glsl"". Empty if the line is not a directive
+	static std::string_view getDirective(std::string_view line, std::string_view* arguments)
+	{
+		line = trim(line);
+		if (line.empty() || line[0] != '#')
+			return {};
+		line = trim(line.substr(1));
+		size_t end = line.find_first_of(" \t");
+		std::string_view directive = line.substr(0, end);
+		*arguments = end == std::string_view::npos ? std::string_view() : trim(line.substr(end));
+		return directive;
+	}
+
+	struct PreprocessState {
+		const std::vector<ShaderDefine>* defines = nullptr;
+		std::vector<std::string> files;
+		std::string output;
+		bool insertedDefines = false;
+	};
+
+	static void appendLine(std::string& output, int line, size_t sourceIndex)
+	{
+		output += "#line " + std::to_string(line) + " " + std::to_string(sourceIndex) + "\n";
+	}
+
+	static bool preprocessFile(PreprocessState& state, const std::filesystem::path& path, int depth)
+	{
+		std::string source = ew::loadShaderSourceFromFile(path.string());
+		if (source.empty())
+			return false;
+		const size_t sourceIndex = state.files.size();
+		state.files.push_back(path.string());
+		const bool isRoot = sourceIndex == 0;
+		//Included files start on their own line numbering
+		if (!isRoot)
+			appendLine(state.output, 1, sourceIndex);
+
+		std::string_view text(source);
+		int lineNumber = 0;
+		for (size_t start = 0; start < text.size();) {
+			size_t end = text.find('\n', start);
+			std::string_view line = text.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+			start = end == std::string_view::npos ? text.size() : end + 1;
+			lineNumber++;
+
+			std::string_view arguments;
+			std::string_view directive = getDirective(line, &arguments);
+			if (directive == "version") {
+				//Only the root's #version counts, the defines go right after it.
+				//Skipped lines are left blank, so line numbers don't shift
+				if (!isRoot) {
+					state.output += '\n';
+					continue;
+				}
+				state.output.append(line);
+				state.output += '\n';
+				state.insertedDefines = true;
+				if (!state.defines->empty()) {
+					for (const ShaderDefine& define : *state.defines) {
+						state.output += "#define " + define.name + " " + define.value + "\n";
+					}
+					appendLine(state.output, lineNumber + 1, sourceIndex);
+				}
+				continue;
+			}
+			if (directive == "include") {
+				if (arguments.size() < 2 || !((arguments.front() == '"' && arguments.back() == '"') || (arguments.front() == '<' && arguments.back() == '>'))) {
+					printf("Malformed #include in %s(%d)\n", path.string().c_str(), lineNumber);
+					state.output += '\n';
+					continue;
+				}
+				std::filesystem::path includePath = (path.parent_path() / std::string(arguments.substr(1, arguments.size() - 2))).lexically_normal();
+				if (std::find(state.files.begin(), state.files.end(), includePath.string()) != state.files.end()) {
+					state.output += '\n';
+					continue;
+				}
+				if (depth + 1 >= MAX_INCLUDE_DEPTH) {
+					printf("#include nested too deep in %s(%d)\n", path.string().c_str(), lineNumber);
+					state.output += '\n';
+					continue;
+				}
+				if (!preprocessFile(state, includePath, depth + 1))
+					printf("Failed to include %s from %s(%d)\n", includePath.string().c_str(), path.string().c_str(), lineNumber);
+				appendLine(state.output, lineNumber + 1, sourceIndex);
+				continue;
+			}
+			state.output.append(line);
+			state.output += '\n';
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Sources without #include and without defines come back unchanged, apart from line endings
+	/// </summary>
+	std::string preprocessShader(const std::string& filePath, const std::vector<ShaderDefine>& defines, std::vector<std::string>* files)
+	{
+		PreprocessState state;
+		state.defines = &defines;
+		if (!preprocessFile(state, std::filesystem::path(filePath).lexically_normal(), 0))
+			return {};
+		//No #version, so nothing has to stay in front of the defines
+		if (!state.insertedDefines && !defines.empty()) {
+			std::string prefix;
+			for (const ShaderDefine& define : defines) {
+				prefix += "#define " + define.name + " " + define.value + "\n";
+			}
+			appendLine(prefix, 1, 0);
+			state.output.insert(0, prefix);
+		}
+		if (files)
+			*files = std::move(state.files);
+		return state.output;
+	}
+
+	std::string makeVariantKey(std::string_view name, std::vector<ShaderDefine> defines)
+	{
+		std::string key(name);
+		if (defines.empty())
+			return key;
+		std::sort(defines.begin(), defines.end(), [](const ShaderDefine& a, const ShaderDefine& b) { return a.name < b.name; });
+		key += '{';
+		for (size_t i = 0; i < defines.size(); i++) {
+			if (i > 0)
+				key += ',';
+			key += defines[i].name;
+			if (!defines[i].value.empty())
+				key += "=" + defines[i].value;
+		}
+		key += '}';
+		return key;
+	}
+
+	bool parseVariantKey(std::string_view key, std::string* name, std::vector<ShaderDefine>* defines)
+	{
+		defines->clear();
+		size_t open = key.find('{');
+		*name = std::string(trim(key.substr(0, open)));
+		if (open == std::string_view::npos)
+			return key.find('}') == std::string_view::npos;
+		if (key.back() != '}' || key.find('}') != key.size() - 1)
+			return false;
+		std::string_view list = key.substr(open + 1, key.size() - open - 2);
+		for (size_t start = 0; start <= list.size();) {
+			size_t end = list.find(',', start);
+			std::string_view entry = trim(list.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start));
+			start = end == std::string_view::npos ? list.size() + 1 : end + 1;
+			if (entry.empty())
+				continue;
+			size_t equals = entry.find('=');
+			ShaderDefine define;
+			define.name = std::string(trim(entry.substr(0, equals)));
+			if (equals != std::string_view::npos)
+				define.value = std::string(trim(entry.substr(equals + 1)));
+			defines->push_back(define);
+		}
+		std::sort(defines->begin(), defines->end(), [](const ShaderDefine& a, const ShaderDefine& b) { return a.name < b.name; });
+		return true;
+	}
+}
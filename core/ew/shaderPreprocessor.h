@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ew {
+	struct ShaderDefine {
+		std::string name;
+		std::string value; //Empty for a plain #define NAME
+	};
+
+	/// <summary>
+	/// Loads a shader and resolves #include "file" directives, relative to the including file.
+	/// Every file is included at most once, so shared declarations need no guards and cycles end.
+	/// The defines are inserted right after #version, so #ifdef/#if in the sources specialize on them.
+	/// #line directives keep driver errors pointing at the right line: source string 0 is filePath,
+	/// n is files[n] if files is given. Empty if filePath can't be read
+	/// </summary>
+	std::string preprocessShader(const std::string& filePath, const std::vector<ShaderDefine>& defines = {}, std::vector<std::string>* files = nullptr);
+
+	/// <summary>
+	/// "name{A=1,B}" for a program and its defines. Defines are sorted by name, so any order of the same set gives the same key.
+	/// Just "name" without defines
+	/// </summary>
+	std::string makeVariantKey(std::string_view name, std::vector<ShaderDefine> defines);
+	//Inverse of makeVariantKey, also accepts unsorted defines and spaces. False if the braces don't match
+	bool parseVariantKey(std::string_view key, std::string* name, std::vector<ShaderDefine>* defines);
+}
@@ -0,0 +1,60 @@
+#include "shaderVariants.h"
+#include <stdio.h>
+
+namespace ew {
+	ShaderVariantCache::ShaderVariantCache(const std::string& directory)
+	{
+		setDirectory(directory);
+	}
+
+	void ShaderVariantCache::addProgram(const std::string& name, const std::string& vertexShader, const std::string& fragmentShader)
+	{
+		m_programs[name] = { vertexShader, fragmentShader };
+	}
+
+	Shader* ShaderVariantCache::get(std::string_view key)
+	{
+		std::string name;
+		std::vector<ShaderDefine> defines;
+		if (!parseVariantKey(key, &name, &defines) || name.empty()) {
+			printf("Malformed shader variant key %.*s\n", (int)key.size(), key.data());
+			return nullptr;
+		}
+		return get(name, defines);
+	}
+
+	/// <summary>
+	/// Without a compiler the variant is compiled right away, through a local ShaderCompiler
+	/// so both paths share the cache handling
+	/// </summary>
+	Shader* ShaderVariantCache::get(std::string_view name, const std::vector<ShaderDefine>& defines)
+	{
+		std::string key = makeVariantKey(name, defines);
+		std::unique_ptr<Shader>& variant = m_variants[key];
+		if (variant)
+			return variant.get();
+		variant = std::make_unique<Shader>();
+
+		Program program;
+		auto it = m_programs.find(std::string(name));
+		if (it != m_programs.end()) {
+			program = it->second;
+		}
+		else {
+			program.vertexShader = m_directory + "/" + std::string(name) + ".vert";
+			program.fragmentShader = m_directory + "/" + std::string(name) + ".frag";
+		}
+		std::string vertexShaderSource = preprocessShader(program.vertexShader, defines);
+		std::string fragmentShaderSource = preprocessShader(program.fragmentShader, defines);
+		if (m_compiler) {
+			m_compiler->addSource(variant.get(), vertexShaderSource, fragmentShaderSource);
+		}
+		else {
+			ShaderCompiler compiler;
+			compiler.init(nullptr, m_programCache);
+			compiler.addSource(variant.get(), vertexShaderSource, fragmentShaderSource);
+			compiler.finish();
+		}
+		return variant.get();
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "shader.h"
+#include "shaderPreprocessor.h"
+#include "shaderCompiler.h"
+
+namespace ew {
+	/// <summary>
+	/// Programs specialized by a set of defines, e.g. "defaultLit{LIGHTS=1,TEXTURED=0}", compiled the first time they are requested.
+	/// The defines are injected into both stages, so #if branches on them are removed and loops bounded by them
+	/// have a trip count known at compile time. Keep the returned pointers rather than looking variants up every frame
+	/// </summary>
+	class ShaderVariantCache {
+	public:
+		ShaderVariantCache() {};
+		//Programs that are not added are read from <directory>/<name>.vert and <directory>/<name>.frag
+		ShaderVariantCache(const std::string& directory);
+		inline void setDirectory(const std::string& directory) { m_directory = directory; }
+		//Binaries of compiled variants are stored in and loaded from cache. A compiler uses the cache it was given instead
+		inline void setProgramCache(ProgramCache* cache) { m_programCache = cache; }
+		//Variants are compiled in the background by compiler, and are not ready until it finishes them
+		inline void setCompiler(ShaderCompiler* compiler) { m_compiler = compiler; }
+		//Sources of a program whose stages don't share its name
+		void addProgram(const std::string& name, const std::string& vertexShader, const std::string& fragmentShader);
+		//Null if the key is malformed
+		Shader* get(std::string_view key);
+		Shader* get(std::string_view name, const std::vector<ShaderDefine>& defines);
+		inline size_t getNumVariants()const { return m_variants.size(); }
+	private:
+		struct Program {
+			std::string vertexShader;
+			std::string fragmentShader;
+		};
+		std::string m_directory = "assets";
+		ProgramCache* m_programCache = nullptr;
+		ShaderCompiler* m_compiler = nullptr;
+		std::unordered_map<std::string, Program> m_programs;
+		std::unordered_map<std::string, std::unique_ptr<Shader>> m_variants; //By makeVariantKey
+	};
+}
@@ -0,0 +1,68 @@
+#include "streamBuffer.h"
+#include "external/glad.h"
+
+namespace ew {
+	void StreamBuffer::create(size_t sectionSize, unsigned int numSections)
+	{
+		destroy();
+		m_sectionSize = sectionSize;
+		m_numSections = numSections > 0 ? numSections : 1;
+		m_section = 0;
+		m_started = false;
+		m_fences.assign(m_numSections, nullptr);
+
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		GLsizeiptr size = (GLsizeiptr)(m_sectionSize * m_numSections);
+		glGenBuffers(1, &m_buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+		glBufferStorage(GL_COPY_WRITE_BUFFER, size, NULL, flags);
+		m_mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	void StreamBuffer::destroy()
+	{
+		for (void*& fence : m_fences) {
+			if (fence) {
+				glDeleteSync((GLsync)fence);
+				fence = nullptr;
+			}
+		}
+		if (m_buffer) {
+			glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			glDeleteBuffers(1, &m_buffer);
+			m_buffer = 0;
+		}
+		m_mapped = nullptr;
+	}
+
+	void* StreamBuffer::nextSection()
+	{
+		if (!m_mapped)
+			return nullptr;
+		if (m_started) {
+			m_fences[m_section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			m_section = (m_section + 1) % m_numSections;
+		}
+		m_started = true;
+
+		GLsync fence = (GLsync)m_fences[m_section];
+		if (fence) {
+			GLenum result = glClientWaitSync(fence, 0, 0);
+			if (result == GL_TIMEOUT_EXPIRED) {
+				m_stallCount++;
+				//Flush on the first wait, otherwise the fence may never reach the GPU
+				GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+				do {
+					result = glClientWaitSync(fence, waitFlags, 1000000); //1ms
+					waitFlags = 0;
+				} while (result == GL_TIMEOUT_EXPIRED);
+			}
+			glDeleteSync(fence);
+			m_fences[m_section] = nullptr;
+		}
+		return m_mapped + getSectionOffset();
+	}
+}
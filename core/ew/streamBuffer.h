@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include <stddef.h>
+
+namespace ew {
+	/// <summary>
+	/// Persistently mapped ring of buffer sections (glBufferStorage, coherent mapping) for data rewritten every frame.
+	/// The CPU writes one section while the GPU reads the previous ones. Each section is fenced once the CPU moves on,
+	/// and is only handed out again after the GPU has passed its fence, so writes never cause implicit synchronization
+	/// </summary>
+	class StreamBuffer {
+	public:
+		StreamBuffer() {};
+		//Creates (or recreates) numSections sections of sectionSize bytes each
+		void create(size_t sectionSize, unsigned int numSections = 3);
+		void destroy();
+		//Fences the current section, moves to the next one and waits until the GPU is done with it.
+		//Returns the section's mapped memory. Draws reading the current section must be submitted before calling
+		void* nextSection();
+		inline unsigned int getBuffer()const { return m_buffer; }
+		inline size_t getSectionSize()const { return m_sectionSize; }
+		inline unsigned int getSectionIndex()const { return m_section; }
+		inline size_t getSectionOffset()const { return m_section * m_sectionSize; }
+		//Number of times nextSection had to wait on the GPU
+		inline unsigned int getStallCount()const { return m_stallCount; }
+	private:
+		unsigned int m_buffer = 0;
+		unsigned char* m_mapped = nullptr;
+		size_t m_sectionSize = 0;
+		unsigned int m_numSections = 0;
+		unsigned int m_section = 0;
+		bool m_started = false;
+		std::vector<void*> m_fences; //GLsync per section
+		unsigned int m_stallCount = 0;
+	};
+}
@@ -14,5 +14,9 @@ namespace ew {
 				* ew::RotateZ(ew::Radians(rotation.z))
 				* ew::Scale(scale);
 		}
+		//transpose(inverse(mat3(model))), for the _NormalMatrix uniform
+		ew::Mat3 getNormalMatrix() const {
+			return ew::NormalMatrix(getModelMatrix());
+		}
 	};
 }
@@ -0,0 +1,196 @@
+#include "transformArray.h"
+#include <thread>
+#include <algorithm>
+
+namespace ew {
+	//Below this many elements per thread, spawning workers costs more than it saves
+	static const size_t MIN_ELEMENTS_PER_THREAD = 4096;
+
+	TransformArray::TransformArray(size_t count)
+	{
+		resize(count);
+	}
+	size_t TransformArray::add(const Transform& transform)
+	{
+		size_t i = size();
+		resize(i + 1);
+		set(i, transform);
+		return i;
+	}
+	void TransformArray::resize(size_t count)
+	{
+		m_posX.resize(count, 0.0f); m_posY.resize(count, 0.0f); m_posZ.resize(count, 0.0f);
+		m_rotX.resize(count, 0.0f); m_rotY.resize(count, 0.0f); m_rotZ.resize(count, 0.0f);
+		m_scaleX.resize(count, 1.0f); m_scaleY.resize(count, 1.0f); m_scaleZ.resize(count, 1.0f);
+		m_modelMatrices.resize(count, ew::IdentityMatrix());
+	}
+	void TransformArray::reserve(size_t count)
+	{
+		m_posX.reserve(count); m_posY.reserve(count); m_posZ.reserve(count);
+		m_rotX.reserve(count); m_rotY.reserve(count); m_rotZ.reserve(count);
+		m_scaleX.reserve(count); m_scaleY.reserve(count); m_scaleZ.reserve(count);
+		m_modelMatrices.reserve(count);
+	}
+	void TransformArray::clear()
+	{
+		resize(0);
+	}
+	void TransformArray::set(size_t i, const Transform& transform)
+	{
+		setPosition(i, transform.position);
+		setRotation(i, transform.rotation);
+		setScale(i, transform.scale);
+	}
+	Transform TransformArray::get(size_t i) const
+	{
+		Transform t;
+		t.position = ew::Vec3(m_posX[i], m_posY[i], m_posZ[i]);
+		t.rotation = ew::Vec3(m_rotX[i], m_rotY[i], m_rotZ[i]);
+		t.scale = ew::Vec3(m_scaleX[i], m_scaleY[i], m_scaleZ[i]);
+		return t;
+	}
+
+	void TransformArray::computeModelMatrices(unsigned int numThreads)
+	{
+		const size_t count = size();
+		size_t maxThreads = std::max<size_t>(count / MIN_ELEMENTS_PER_THREAD, 1);
+		size_t threadCount = std::min<size_t>(std::max(numThreads, 1u), maxThreads);
+		if (threadCount <= 1) {
+			computeModelMatrices(0, count);
+			return;
+		}
+		//Chunks are multiples of 4 so every thread but the last stays on the SIMD path
+		size_t chunk = ((count + threadCount - 1) / threadCount + 3) & ~size_t(3);
+		std::vector<std::thread> workers;
+		workers.reserve(threadCount - 1);
+		for (size_t t = 1; t < threadCount; t++)
+		{
+			size_t first = t * chunk;
+			if (first >= count)
+				break;
+			workers.emplace_back([this, first, chunk, count]() {
+				computeModelMatrices(first, std::min(chunk, count - first));
+			});
+		}
+		computeModelMatrices(0, std::min(chunk, count));
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+	}
+
+#if defined(EW_MATH_SSE)
+	/// <summary>
+	/// Sine and cosine of 4 angles (radians) at once.
+	/// Cody-Waite reduction to [-PI/4,PI/4] followed by the Cephes minimax polynomials. Max error is around 1e-7 for |x| < 8192
+	/// </summary>
+	static inline void sinCos4(__m128 x, __m128* s, __m128* c) {
+		const __m128i q = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.63661977236f))); //round(x * 2/PI)
+		const __m128 j = _mm_cvtepi32_ps(q);
+		__m128 r = _mm_sub_ps(x, _mm_mul_ps(j, _mm_set1_ps(1.5703125f)));
+		r = _mm_sub_ps(r, _mm_mul_ps(j, _mm_set1_ps(4.837512969970703125e-4f)));
+		r = _mm_sub_ps(r, _mm_mul_ps(j, _mm_set1_ps(7.54978995489188216e-8f)));
+		const __m128 z = _mm_mul_ps(r, r);
+
+		__m128 sp = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.9515295891e-4f), z), _mm_set1_ps(8.3321608736e-3f));
+		sp = _mm_add_ps(_mm_mul_ps(sp, z), _mm_set1_ps(-1.6666654611e-1f));
+		sp = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sp, z), r), r);
+
+		__m128 cp = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.443315711809948e-5f), z), _mm_set1_ps(-1.388731625493765e-3f));
+		cp = _mm_add_ps(_mm_mul_ps(cp, z), _mm_set1_ps(4.166664568298827e-2f));
+		cp = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(cp, z), z), _mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(z, _mm_set1_ps(0.5f))));
+
+		//Odd quadrants swap sin and cos, quadrant signs come from bit 1 of q and q+1
+		const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+		const __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, _mm_set1_epi32(2)), 30));
+		const __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+		*s = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, cp), _mm_andnot_ps(swap, sp)), sinSign);
+		*c = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, sp), _mm_andnot_ps(swap, cp)), cosSign);
+	}
+#endif
+
+	void TransformArray::computeModelMatrices(size_t first, size_t count)
+	{
+		if (count == 0)
+			return;
+		size_t i = first;
+		const size_t end = first + count;
+		float* out = &m_modelMatrices[0][0][0];
+#if defined(EW_MATH_SSE)
+		const __m128 deg2Rad = _mm_set1_ps(ew::DEG2RAD);
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 sx, cx, sy, cy, sz, cz;
+			sinCos4(_mm_mul_ps(_mm_loadu_ps(&m_rotX[i]), deg2Rad), &sx, &cx);
+			sinCos4(_mm_mul_ps(_mm_loadu_ps(&m_rotY[i]), deg2Rad), &sy, &cy);
+			sinCos4(_mm_mul_ps(_mm_loadu_ps(&m_rotZ[i]), deg2Rad), &sz, &cz);
+			const __m128 scX = _mm_loadu_ps(&m_scaleX[i]);
+			const __m128 scY = _mm_loadu_ps(&m_scaleY[i]);
+			const __m128 scZ = _mm_loadu_ps(&m_scaleZ[i]);
+			const __m128 sysx = _mm_mul_ps(sy, sx);
+			const __m128 cysx = _mm_mul_ps(cy, sx);
+
+			//Closed form of Ry * Rx * Rz, one register per matrix entry, scaled per column
+			__m128 c0r0 = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cy, cz), _mm_mul_ps(sysx, sz)), scX);
+			__m128 c0r1 = _mm_mul_ps(_mm_mul_ps(cx, sz), scX);
+			__m128 c0r2 = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cysx, sz), _mm_mul_ps(sy, cz)), scX);
+			__m128 c0r3 = _mm_setzero_ps();
+			__m128 c1r0 = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sysx, cz), _mm_mul_ps(cy, sz)), scY);
+			__m128 c1r1 = _mm_mul_ps(_mm_mul_ps(cx, cz), scY);
+			__m128 c1r2 = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sy, sz), _mm_mul_ps(cysx, cz)), scY);
+			__m128 c1r3 = _mm_setzero_ps();
+			__m128 c2r0 = _mm_mul_ps(_mm_mul_ps(sy, cx), scZ);
+			__m128 c2r1 = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), sx), scZ);
+			__m128 c2r2 = _mm_mul_ps(_mm_mul_ps(cy, cx), scZ);
+			__m128 c2r3 = _mm_setzero_ps();
+			__m128 c3r0 = _mm_loadu_ps(&m_posX[i]);
+			__m128 c3r1 = _mm_loadu_ps(&m_posY[i]);
+			__m128 c3r2 = _mm_loadu_ps(&m_posZ[i]);
+			__m128 c3r3 = _mm_set1_ps(1.0f);
+
+			//Transpose lanes (elements) into columns
+			_MM_TRANSPOSE4_PS(c0r0, c0r1, c0r2, c0r3);
+			_MM_TRANSPOSE4_PS(c1r0, c1r1, c1r2, c1r3);
+			_MM_TRANSPOSE4_PS(c2r0, c2r1, c2r2, c2r3);
+			_MM_TRANSPOSE4_PS(c3r0, c3r1, c3r2, c3r3);
+			const __m128 columns[4][4] = {
+				{ c0r0, c1r0, c2r0, c3r0 },
+				{ c0r1, c1r1, c2r1, c3r1 },
+				{ c0r2, c1r2, c2r2, c3r2 },
+				{ c0r3, c1r3, c2r3, c3r3 }
+			};
+			for (int e = 0; e < 4; e++)
+			{
+				float* m = out + (i + e) * 16;
+				_mm_storeu_ps(m + 0, columns[e][0]);
+				_mm_storeu_ps(m + 4, columns[e][1]);
+				_mm_storeu_ps(m + 8, columns[e][2]);
+				_mm_storeu_ps(m + 12, columns[e][3]);
+			}
+		}
+#endif
+		for (; i < end; i++)
+		{
+			const float rx = ew::Radians(m_rotX[i]), ry = ew::Radians(m_rotY[i]), rz = ew::Radians(m_rotZ[i]);
+			const float sx = sinf(rx), cx = cosf(rx);
+			const float sy = sinf(ry), cy = cosf(ry);
+			const float sz = sinf(rz), cz = cosf(rz);
+			float* m = out + i * 16;
+			m[0] = (cy * cz + sy * sx * sz) * m_scaleX[i];
+			m[1] = (cx * sz) * m_scaleX[i];
+			m[2] = (cy * sx * sz - sy * cz) * m_scaleX[i];
+			m[3] = 0.0f;
+			m[4] = (sy * sx * cz - cy * sz) * m_scaleY[i];
+			m[5] = (cx * cz) * m_scaleY[i];
+			m[6] = (sy * sz + cy * sx * cz) * m_scaleY[i];
+			m[7] = 0.0f;
+			m[8] = (sy * cx) * m_scaleZ[i];
+			m[9] = -sx * m_scaleZ[i];
+			m[10] = (cy * cx) * m_scaleZ[i];
+			m[11] = 0.0f;
+			m[12] = m_posX[i];
+			m[13] = m_posY[i];
+			m[14] = m_posZ[i];
+			m[15] = 1.0f;
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include "transform.h"
+
+namespace ew {
+	/// <summary>
+	/// Structure of arrays storage for large numbers of transforms.
+	/// Model matrices for every element are composed in a single pass into one contiguous buffer
+	/// that can be handed straight to glBufferData / glBufferSubData.
+	/// Produces the same matrices as ew::Transform::getModelMatrix (T * Ry * Rx * Rz * S)
+	/// </summary>
+	class TransformArray {
+	public:
+		TransformArray() {};
+		TransformArray(size_t count);
+		size_t add(const Transform& transform); //Returns the index of the new element
+		void resize(size_t count);
+		void reserve(size_t count);
+		void clear();
+		inline size_t size()const { return m_posX.size(); }
+
+		void set(size_t i, const Transform& transform);
+		Transform get(size_t i)const;
+		void setPosition(size_t i, const ew::Vec3& p) { m_posX[i] = p.x; m_posY[i] = p.y; m_posZ[i] = p.z; }
+		void setRotation(size_t i, const ew::Vec3& r) { m_rotX[i] = r.x; m_rotY[i] = r.y; m_rotZ[i] = r.z; } //Euler angles (Degrees)
+		void setScale(size_t i, const ew::Vec3& s) { m_scaleX[i] = s.x; m_scaleY[i] = s.y; m_scaleZ[i] = s.z; }
+
+		//Raw component streams, for systems that update many elements at once
+		inline float* positionX() { return m_posX.data(); }
+		inline float* positionY() { return m_posY.data(); }
+		inline float* positionZ() { return m_posZ.data(); }
+		inline float* rotationX() { return m_rotX.data(); }
+		inline float* rotationY() { return m_rotY.data(); }
+		inline float* rotationZ() { return m_rotZ.data(); }
+		inline float* scaleX() { return m_scaleX.data(); }
+		inline float* scaleY() { return m_scaleY.data(); }
+		inline float* scaleZ() { return m_scaleZ.data(); }
+
+		/// <summary>
+		/// Recomputes all model matrices. numThreads <= 1 runs on the calling thread.
+		/// Small arrays are always processed on the calling thread
+		/// </summary>
+		void computeModelMatrices(unsigned int numThreads = 1);
+		void computeModelMatrices(size_t first, size_t count);
+
+		inline const ew::Mat4* modelMatrices()const { return m_modelMatrices.data(); }
+		inline const ew::Mat4& modelMatrix(size_t i)const { return m_modelMatrices[i]; }
+		inline size_t modelMatricesSizeBytes()const { return m_modelMatrices.size() * sizeof(ew::Mat4); }
+	private:
+		std::vector<float> m_posX, m_posY, m_posZ;
+		std::vector<float> m_rotX, m_rotY, m_rotZ;
+		std::vector<float> m_scaleX, m_scaleY, m_scaleZ;
+		std::vector<ew::Mat4> m_modelMatrices;
+	};
+}
@@ -0,0 +1,59 @@
+#include "uniformBlocks.h"
+#include "external/glad.h"
+#include <string.h>
+
+namespace ew {
+	void bindUniformBlocks(unsigned int program)
+	{
+		GLuint frameIndex = glGetUniformBlockIndex(program, "FrameBlock");
+		if (frameIndex != GL_INVALID_INDEX)
+			glUniformBlockBinding(program, frameIndex, FRAME_BLOCK_BINDING);
+		GLuint lightIndex = glGetUniformBlockIndex(program, "LightBlock");
+		if (lightIndex != GL_INVALID_INDEX)
+			glUniformBlockBinding(program, lightIndex, LIGHT_BLOCK_BINDING);
+	}
+
+	static size_t alignUp(size_t size, size_t alignment)
+	{
+		return (size + alignment - 1) / alignment * alignment;
+	}
+
+	/// <summary>
+	/// Each section holds the frame block followed by the light block. Both start on offsets
+	/// glBindBufferRange accepts, so sections are padded to the uniform buffer offset alignment
+	/// </summary>
+	void SharedUniforms::create(unsigned int numSections)
+	{
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		if (alignment < 1)
+			alignment = 256;
+		m_lightOffset = alignUp(sizeof(FrameBlock), alignment);
+		m_ring.create(alignUp(m_lightOffset + sizeof(LightBlock), alignment), numSections);
+	}
+
+	void SharedUniforms::destroy()
+	{
+		m_ring.destroy();
+	}
+
+	void SharedUniforms::setCamera(const Camera& camera)
+	{
+		m_frame.view = camera.ViewMatrix();
+		m_frame.projection = camera.ProjectionMatrix();
+		m_frame.viewProjection = m_frame.projection * m_frame.view;
+		m_frame.cameraPosition = camera.position;
+	}
+
+	void SharedUniforms::upload()
+	{
+		unsigned char* section = (unsigned char*)m_ring.nextSection();
+		if (!section)
+			return;
+		memcpy(section, &m_frame, sizeof(FrameBlock));
+		memcpy(section + m_lightOffset, &m_lights, sizeof(LightBlock));
+		const size_t offset = m_ring.getSectionOffset();
+		glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, m_ring.getBuffer(), (GLintptr)offset, sizeof(FrameBlock));
+		glBindBufferRange(GL_UNIFORM_BUFFER, LIGHT_BLOCK_BINDING, m_ring.getBuffer(), (GLintptr)(offset + m_lightOffset), sizeof(LightBlock));
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <stddef.h>
+#include "ewMath/ewMath.h"
+#include "camera.h"
+#include "streamBuffer.h"
+
+namespace ew {
+	//Uniform buffer binding points. Shaders declare the blocks by name and are bound to these when created
+	const unsigned int FRAME_BLOCK_BINDING = 0;
+	const unsigned int LIGHT_BLOCK_BINDING = 1;
+	const unsigned int MAX_BLOCK_LIGHTS = 16;
+
+	/// <summary>
+	/// std140 mirror of
+	/// layout(std140) uniform FrameBlock { mat4 _View; mat4 _Projection; mat4 _ViewProjection; vec3 _CameraPosition; vec2 _Resolution; float _Time; float _DeltaTime; };
+	/// </summary>
+	struct FrameBlock {
+		ew::Mat4 view;
+		ew::Mat4 projection;
+		ew::Mat4 viewProjection;
+		ew::Vec3 cameraPosition;
+		float padding0 = 0;
+		ew::Vec2 resolution; //Pixels
+		float time = 0; //Seconds
+		float deltaTime = 0;
+	};
+
+	//std140 mirror of struct Light { vec3 position; vec3 color; }
+	struct BlockLight {
+		ew::Vec3 position; //World space
+		float padding0 = 0;
+		ew::Vec3 color; //RGB
+		float padding1 = 0;
+	};
+
+	/// <summary>
+	/// std140 mirror of
+	/// layout(std140) uniform LightBlock { Light _Lights[MAX_BLOCK_LIGHTS]; int _NumLights; };
+	/// </summary>
+	struct LightBlock {
+		BlockLight lights[MAX_BLOCK_LIGHTS];
+		int numLights = 0;
+		int padding[3] = {};
+	};
+
+	static_assert(offsetof(FrameBlock, cameraPosition) == 192 && offsetof(FrameBlock, resolution) == 208 && sizeof(FrameBlock) == 224, "FrameBlock does not match std140");
+	static_assert(sizeof(BlockLight) == 32 && offsetof(LightBlock, numLights) == 32 * MAX_BLOCK_LIGHTS, "LightBlock does not match std140");
+
+	//Points the program's FrameBlock and LightBlock, if it declares them, at their binding points. ew::Shader calls this after linking
+	void bindUniformBlocks(unsigned int program);
+
+	/// <summary>
+	/// CPU copies of the shared blocks, uploaded together once per frame through a persistently mapped ring (StreamBuffer).
+	/// Every program declaring the blocks reads the same copy, however many there are
+	/// </summary>
+	class SharedUniforms {
+	public:
+		SharedUniforms() {};
+		void create(unsigned int numSections = 3);
+		void destroy();
+		inline FrameBlock& getFrame() { return m_frame; }
+		inline LightBlock& getLights() { return m_lights; }
+		//View, projection and camera position of the frame block
+		void setCamera(const Camera& camera);
+		/// <summary>
+		/// Copies both blocks into the next ring section and binds them to their binding points.
+		/// Call once per frame before the draws. Waits only if the GPU is still reading that section
+		/// </summary>
+		void upload();
+		inline unsigned int getStallCount()const { return m_ring.getStallCount(); }
+	private:
+		FrameBlock m_frame;
+		LightBlock m_lights;
+		StreamBuffer m_ring;
+		size_t m_lightOffset = 0; //Within a section, aligned to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	};
+}
@@ -0,0 +1,105 @@
+#include "uniformTable.h"
+#include "external/glad.h"
+
+namespace ew {
+	//Entries allocated for the first insert. The table stays at most half full
+	const size_t MIN_UNIFORM_TABLE_SIZE = 16;
+
+	/// <summary>
+	/// glGetActiveUniform reports arrays of basic types once, as "name[0]" with their size. Structs and arrays
+	/// of structs are reported member by member. Block members have no location and are skipped
+	/// </summary>
+	void UniformTable::build(unsigned int program)
+	{
+		clear();
+		GLint numUniforms = 0, maxNameLength = 0;
+		glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &numUniforms);
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+		std::vector<char> nameBuffer(maxNameLength + 1);
+		std::string elementName;
+		for (GLint i = 0; i < numUniforms; i++) {
+			GLsizei length = 0;
+			GLint arraySize = 0;
+			GLenum type;
+			glGetActiveUniform(program, (GLuint)i, (GLsizei)nameBuffer.size(), &length, &arraySize, &type, nameBuffer.data());
+			int location = glGetUniformLocation(program, nameBuffer.data());
+			if (location < 0)
+				continue;
+			std::string_view name(nameBuffer.data(), length);
+			insert(name, location);
+			if (name.size() < 3 || name.substr(name.size() - 3) != "[0]")
+				continue;
+			std::string_view baseName = name.substr(0, name.size() - 3);
+			insert(baseName, location);
+			for (GLint element = 1; element < arraySize; element++) {
+				elementName.assign(baseName);
+				elementName += "[" + std::to_string(element) + "]";
+				insert(elementName, glGetUniformLocation(program, elementName.c_str()));
+			}
+		}
+	}
+
+	void UniformTable::insert(std::string_view name, int location)
+	{
+		if (name.empty())
+			return;
+		if ((m_size + 1) * 2 > m_entries.size())
+			grow();
+		const unsigned int hash = HashString(name);
+		const size_t mask = m_entries.size() - 1;
+		for (size_t i = hash & mask;; i = (i + 1) & mask) {
+			Entry& entry = m_entries[i];
+			if (entry.nameLength == 0) {
+				entry.hash = hash;
+				entry.location = location;
+				entry.nameOffset = (unsigned int)m_names.size();
+				entry.nameLength = (unsigned int)name.size();
+				m_names.append(name);
+				m_size++;
+				return;
+			}
+			if (entry.hash == hash && std::string_view(m_names).substr(entry.nameOffset, entry.nameLength) == name) {
+				entry.location = location;
+				return;
+			}
+		}
+	}
+
+	void UniformTable::grow()
+	{
+		std::vector<Entry> old;
+		old.swap(m_entries);
+		m_entries.resize(old.empty() ? MIN_UNIFORM_TABLE_SIZE : old.size() * 2);
+		const size_t mask = m_entries.size() - 1;
+		for (const Entry& entry : old) {
+			if (entry.nameLength == 0)
+				continue;
+			size_t i = entry.hash & mask;
+			while (m_entries[i].nameLength != 0) {
+				i = (i + 1) & mask;
+			}
+			m_entries[i] = entry;
+		}
+	}
+
+	void UniformTable::clear()
+	{
+		m_entries.clear();
+		m_names.clear();
+		m_size = 0;
+	}
+
+	int UniformTable::find(unsigned int hash, std::string_view name) const
+	{
+		if (m_entries.empty())
+			return -1;
+		const size_t mask = m_entries.size() - 1;
+		for (size_t i = hash & mask;; i = (i + 1) & mask) {
+			const Entry& entry = m_entries[i];
+			if (entry.nameLength == 0)
+				return -1;
+			if (entry.hash == hash && entry.nameLength == name.size() && m_names.compare(entry.nameOffset, entry.nameLength, name.data(), name.size()) == 0)
+				return entry.location;
+		}
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <string_view>
+
+namespace ew {
+	//32 bit FNV-1a. constexpr, so names known at compile time are hashed by the compiler
+	constexpr unsigned int HashString(std::string_view s)
+	{
+		unsigned int hash = 2166136261u;
+		for (char c : s) {
+			hash ^= (unsigned char)c;
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	//A uniform location resolved once, e.g. before the render loop. Setters ignore invalid handles like glUniform ignores -1
+	struct UniformHandle {
+		int location = -1;
+		inline bool isValid()const { return location >= 0; }
+	};
+
+	/// <summary>
+	/// Flat open addressing table from uniform name to location, filled once by introspecting a linked program.
+	/// Lookups hash the name and compare it against one stored copy, with no allocation and no GL calls.
+	/// Array uniforms are found by their base name, "name[0]" and every "name[i]"
+	/// </summary>
+	class UniformTable {
+	public:
+		UniformTable() {};
+		//Replaces the contents with every active uniform of the program that has a location
+		void build(unsigned int program);
+		void insert(std::string_view name, int location);
+		void clear();
+		//-1 if the program has no such uniform
+		int find(unsigned int hash, std::string_view name)const;
+		inline int find(std::string_view name)const { return find(HashString(name), name); }
+		inline size_t size()const { return m_size; }
+	private:
+		struct Entry {
+			unsigned int hash = 0;
+			int location = -1;
+			unsigned int nameOffset = 0;
+			unsigned int nameLength = 0; //0 for empty entries
+		};
+		void grow();
+		std::vector<Entry> m_entries; //Power of two size
+		std::string m_names; //Every name, back to back
+		size_t m_size = 0;
+	};
+}
@@ -0,0 +1,353 @@
+#include "vertexPacking.h"
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include "ewMath/transformations.h"
+#include "external/glad.h"
+
+namespace ew {
+	/// <summary>
+	/// IEEE half from float with round to nearest even
+	/// </summary>
+	static uint16_t floatToHalf(float f) {
+		uint32_t x;
+		memcpy(&x, &f, sizeof(x));
+		uint32_t sign = (x >> 16) & 0x8000;
+		uint32_t rawExp = (x >> 23) & 0xff;
+		uint32_t mant = x & 0x7fffff;
+		if (rawExp == 0xff) {
+			return (uint16_t)(sign | 0x7c00 | (mant ? 0x200 : 0)); //Inf / NaN
+		}
+		int32_t exp = (int32_t)rawExp - 127 + 15;
+		if (exp >= 31) {
+			return (uint16_t)(sign | 0x7c00); //Overflow to inf
+		}
+		if (exp <= 0) {
+			//Subnormal half
+			if (exp < -10)
+				return (uint16_t)sign;
+			mant |= 0x800000;
+			uint32_t shift = (uint32_t)(14 - exp);
+			uint32_t half = mant >> shift;
+			uint32_t rem = mant & ((1u << shift) - 1);
+			uint32_t mid = 1u << (shift - 1);
+			if (rem > mid || (rem == mid && (half & 1)))
+				half++;
+			return (uint16_t)(sign | half);
+		}
+		uint32_t half = sign | ((uint32_t)exp << 10) | (mant >> 13);
+		uint32_t rem = mant & 0x1fff;
+		//A carry out of the mantissa correctly bumps the exponent
+		if (rem > 0x1000 || (rem == 0x1000 && (half & 1)))
+			half++;
+		return (uint16_t)half;
+	}
+	static float halfToFloat(uint16_t h) {
+		uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+		uint32_t exp = (h >> 10) & 0x1f;
+		uint32_t mant = h & 0x3ff;
+		uint32_t x;
+		if (exp == 0) {
+			if (mant == 0) {
+				x = sign;
+			}
+			else {
+				//Renormalize subnormal
+				int e = -1;
+				do {
+					e++;
+					mant <<= 1;
+				} while ((mant & 0x400) == 0);
+				x = sign | ((uint32_t)(127 - 15 - e) << 23) | ((mant & 0x3ff) << 13);
+			}
+		}
+		else if (exp == 31) {
+			x = sign | 0x7f800000 | (mant << 13);
+		}
+		else {
+			x = sign | ((exp - 15 + 127) << 23) | (mant << 13);
+		}
+		float f;
+		memcpy(&f, &x, sizeof(f));
+		return f;
+	}
+
+	static float fromSnorm16(int16_t v) {
+		return std::max(v / 32767.0f, -1.0f);
+	}
+	static uint16_t toUnorm16(float v) {
+		return (uint16_t)lroundf(ew::Clamp(v, 0.0f, 1.0f) * 65535.0f);
+	}
+	static float fromUnorm16(uint16_t v) {
+		return v / 65535.0f;
+	}
+	static uint32_t toSnorm10(float v) {
+		int32_t i = (int32_t)lroundf(ew::Clamp(v, -1.0f, 1.0f) * 511.0f);
+		return (uint32_t)i & 0x3ff;
+	}
+	static float fromSnorm10(uint32_t bits) {
+		int32_t i = (int32_t)(bits << 22) >> 22; //Sign extend
+		return std::max(i / 511.0f, -1.0f);
+	}
+
+	//Octahedral mapping of a unit vector to [-1,1]^2
+	static ew::Vec2 octEncode(const ew::Vec3& n) {
+		float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+		if (l1 == 0.0f)
+			return ew::Vec2(0.0f);
+		ew::Vec2 e = ew::Vec2(n.x / l1, n.y / l1);
+		if (n.z < 0.0f) {
+			e = ew::Vec2((1.0f - fabsf(e.y)) * ew::Sign(e.x), (1.0f - fabsf(e.x)) * ew::Sign(e.y));
+		}
+		return e;
+	}
+	static ew::Vec3 octDecode(const ew::Vec2& e) {
+		ew::Vec3 n = ew::Vec3(e.x, e.y, 1.0f - fabsf(e.x) - fabsf(e.y));
+		if (n.z < 0.0f) {
+			float x = (1.0f - fabsf(n.y)) * ew::Sign(n.x);
+			float y = (1.0f - fabsf(n.x)) * ew::Sign(n.y);
+			n.x = x;
+			n.y = y;
+		}
+		return ew::Normalize(n);
+	}
+	/// <summary>
+	/// Octahedral encoding that tries the 4 neighbouring snorm16 values and keeps the most accurate one
+	/// </summary>
+	static void octEncodeSnorm16(const ew::Vec3& n, int16_t* out) {
+		ew::Vec2 e = octEncode(n);
+		int16_t bx = (int16_t)floorf(ew::Clamp(e.x, -1.0f, 1.0f) * 32767.0f);
+		int16_t by = (int16_t)floorf(ew::Clamp(e.y, -1.0f, 1.0f) * 32767.0f);
+		float best = -2.0f;
+		for (int i = 0; i < 4; i++) {
+			int16_t cx = (int16_t)std::min(bx + (i & 1), 32767);
+			int16_t cy = (int16_t)std::min(by + (i >> 1), 32767);
+			float d = ew::Dot(octDecode(ew::Vec2(fromSnorm16(cx), fromSnorm16(cy))), n);
+			if (d > best) {
+				best = d;
+				out[0] = cx;
+				out[1] = cy;
+			}
+		}
+	}
+
+	static unsigned int align4(unsigned int v) {
+		return (v + 3) & ~3u;
+	}
+
+	//Fills attribute descriptions and returns the stride
+	static unsigned int describeLayout(const VertexLayout& layout, VertexAttribute* attributes) {
+		unsigned int offset = 0;
+		VertexAttribute& pos = attributes[0];
+		pos.location = 0;
+		pos.components = 3;
+		pos.offset = offset;
+		switch (layout.position) {
+		case PositionFormat::FLOAT32: pos.glType = GL_FLOAT; pos.normalized = false; offset += 12; break;
+		case PositionFormat::HALF_FLOAT: pos.glType = GL_HALF_FLOAT; pos.normalized = false; offset += 8; break;
+		case PositionFormat::UNORM16_BOUNDS: pos.glType = GL_UNSIGNED_SHORT; pos.normalized = true; offset += 8; break;
+		}
+		VertexAttribute& normal = attributes[1];
+		normal.location = 1;
+		normal.offset = offset;
+		switch (layout.normal) {
+		case NormalFormat::FLOAT32: normal.components = 3; normal.glType = GL_FLOAT; normal.normalized = false; offset += 12; break;
+		case NormalFormat::SNORM_10_10_10_2: normal.components = 4; normal.glType = GL_INT_2_10_10_10_REV; normal.normalized = true; offset += 4; break;
+		case NormalFormat::OCTAHEDRAL_16: normal.components = 2; normal.glType = GL_SHORT; normal.normalized = true; offset += 4; break;
+		}
+		VertexAttribute& uv = attributes[2];
+		uv.location = 2;
+		uv.components = 2;
+		uv.offset = offset;
+		switch (layout.uv) {
+		case UVFormat::FLOAT32: uv.glType = GL_FLOAT; uv.normalized = false; offset += 8; break;
+		case UVFormat::UNORM16: uv.glType = GL_UNSIGNED_SHORT; uv.normalized = true; offset += 4; break;
+		}
+		return align4(offset);
+	}
+
+	unsigned int vertexStride(const VertexLayout& layout)
+	{
+		VertexAttribute attributes[3];
+		return describeLayout(layout, attributes);
+	}
+
+	PackedMeshData packMeshData(const MeshData& meshData, const VertexLayout& layout)
+	{
+		PackedMeshData packed;
+		packed.layout = layout;
+		packed.stride = describeLayout(layout, packed.attributes);
+		packed.numVertices = (unsigned int)meshData.vertices.size();
+		packed.vertices.resize((size_t)packed.stride * packed.numVertices, 0);
+		packed.indices = meshData.indices;
+
+		//Cube shaped bounds, so the decode matrix has uniform scale
+		ew::Vec3 boundsMin = ew::Vec3(0.0f);
+		float boundsSize = 1.0f;
+		if (layout.position == PositionFormat::UNORM16_BOUNDS && !meshData.vertices.empty()) {
+			ew::Vec3 mn = meshData.vertices[0].pos, mx = mn;
+			for (const Vertex& v : meshData.vertices) {
+				mn = ew::Vec3(std::min(mn.x, v.pos.x), std::min(mn.y, v.pos.y), std::min(mn.z, v.pos.z));
+				mx = ew::Vec3(std::max(mx.x, v.pos.x), std::max(mx.y, v.pos.y), std::max(mx.z, v.pos.z));
+			}
+			boundsMin = mn;
+			boundsSize = std::max(std::max(mx.x - mn.x, mx.y - mn.y), mx.z - mn.z);
+			if (boundsSize <= 0.0f)
+				boundsSize = 1.0f;
+			packed.positionDecode = ew::Translate(boundsMin) * ew::Scale(ew::Vec3(boundsSize));
+		}
+		const float invBoundsSize = 1.0f / boundsSize;
+
+		for (unsigned int i = 0; i < packed.numVertices; i++)
+		{
+			const Vertex& v = meshData.vertices[i];
+			uint8_t* dst = packed.vertices.data() + (size_t)i * packed.stride;
+
+			uint8_t* p = dst + packed.attributes[0].offset;
+			switch (layout.position) {
+			case PositionFormat::FLOAT32:
+				memcpy(p, &v.pos, sizeof(ew::Vec3));
+				break;
+			case PositionFormat::HALF_FLOAT: {
+				uint16_t h[3] = { floatToHalf(v.pos.x), floatToHalf(v.pos.y), floatToHalf(v.pos.z) };
+				memcpy(p, h, sizeof(h));
+				break;
+			}
+			case PositionFormat::UNORM16_BOUNDS: {
+				ew::Vec3 t = (v.pos - boundsMin) * invBoundsSize;
+				uint16_t q[3] = { toUnorm16(t.x), toUnorm16(t.y), toUnorm16(t.z) };
+				memcpy(p, q, sizeof(q));
+				break;
+			}
+			}
+
+			uint8_t* n = dst + packed.attributes[1].offset;
+			switch (layout.normal) {
+			case NormalFormat::FLOAT32:
+				memcpy(n, &v.normal, sizeof(ew::Vec3));
+				break;
+			case NormalFormat::SNORM_10_10_10_2: {
+				uint32_t bits = toSnorm10(v.normal.x) | (toSnorm10(v.normal.y) << 10) | (toSnorm10(v.normal.z) << 20);
+				memcpy(n, &bits, sizeof(bits));
+				break;
+			}
+			case NormalFormat::OCTAHEDRAL_16: {
+				int16_t e[2];
+				octEncodeSnorm16(ew::Normalize(v.normal), e);
+				memcpy(n, e, sizeof(e));
+				break;
+			}
+			}
+
+			uint8_t* uv = dst + packed.attributes[2].offset;
+			switch (layout.uv) {
+			case UVFormat::FLOAT32:
+				memcpy(uv, &v.uv, sizeof(ew::Vec2));
+				break;
+			case UVFormat::UNORM16: {
+				uint16_t q[2] = { toUnorm16(v.uv.x), toUnorm16(v.uv.y) };
+				memcpy(uv, q, sizeof(q));
+				break;
+			}
+			}
+		}
+		packed.bounds = meshData.bounds;
+		packed.boundingSphere = meshData.boundingSphere;
+		return packed;
+	}
+
+	MeshData unpackMeshData(const PackedMeshData& packed)
+	{
+		MeshData meshData;
+		meshData.indices = packed.indices;
+		meshData.vertices.resize(packed.numVertices);
+		for (unsigned int i = 0; i < packed.numVertices; i++)
+		{
+			const uint8_t* src = packed.vertices.data() + (size_t)i * packed.stride;
+			Vertex& v = meshData.vertices[i];
+
+			const uint8_t* p = src + packed.attributes[0].offset;
+			switch (packed.layout.position) {
+			case PositionFormat::FLOAT32:
+				memcpy(&v.pos, p, sizeof(ew::Vec3));
+				break;
+			case PositionFormat::HALF_FLOAT: {
+				uint16_t h[3];
+				memcpy(h, p, sizeof(h));
+				v.pos = ew::Vec3(halfToFloat(h[0]), halfToFloat(h[1]), halfToFloat(h[2]));
+				break;
+			}
+			case PositionFormat::UNORM16_BOUNDS: {
+				uint16_t q[3];
+				memcpy(q, p, sizeof(q));
+				v.pos = (packed.positionDecode * ew::Vec4(fromUnorm16(q[0]), fromUnorm16(q[1]), fromUnorm16(q[2]), 1.0f)).toVec3();
+				break;
+			}
+			}
+
+			const uint8_t* n = src + packed.attributes[1].offset;
+			switch (packed.layout.normal) {
+			case NormalFormat::FLOAT32:
+				memcpy(&v.normal, n, sizeof(ew::Vec3));
+				break;
+			case NormalFormat::SNORM_10_10_10_2: {
+				uint32_t bits;
+				memcpy(&bits, n, sizeof(bits));
+				v.normal = ew::Vec3(fromSnorm10(bits & 0x3ff), fromSnorm10((bits >> 10) & 0x3ff), fromSnorm10((bits >> 20) & 0x3ff));
+				break;
+			}
+			case NormalFormat::OCTAHEDRAL_16: {
+				int16_t e[2];
+				memcpy(e, n, sizeof(e));
+				v.normal = octDecode(ew::Vec2(fromSnorm16(e[0]), fromSnorm16(e[1])));
+				break;
+			}
+			}
+
+			const uint8_t* uv = src + packed.attributes[2].offset;
+			switch (packed.layout.uv) {
+			case UVFormat::FLOAT32:
+				memcpy(&v.uv, uv, sizeof(ew::Vec2));
+				break;
+			case UVFormat::UNORM16: {
+				uint16_t q[2];
+				memcpy(q, uv, sizeof(q));
+				v.uv = ew::Vec2(fromUnorm16(q[0]), fromUnorm16(q[1]));
+				break;
+			}
+			}
+		}
+		meshData.bounds = packed.bounds;
+		meshData.boundingSphere = packed.boundingSphere;
+		return meshData;
+	}
+
+	PackingError measurePackingError(const MeshData& source, const PackedMeshData& packed)
+	{
+		PackingError error;
+		error.bytesPerVertex = packed.stride;
+		MeshData decoded = unpackMeshData(packed);
+		size_t count = std::min(source.vertices.size(), decoded.vertices.size());
+		double posSum = 0, normalSum = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			const Vertex& a = source.vertices[i];
+			const Vertex& b = decoded.vertices[i];
+			float posErr = ew::Magnitude(a.pos - b.pos);
+			//Shaders renormalize, so compare directions
+			float cosAngle = ew::Clamp(ew::Dot(ew::Normalize(a.normal), ew::Normalize(b.normal)), -1.0f, 1.0f);
+			float normalErr = ew::Degrees(acosf(cosAngle));
+			float uvErr = std::max(fabsf(a.uv.x - b.uv.x), fabsf(a.uv.y - b.uv.y));
+			error.maxPositionError = std::max(error.maxPositionError, posErr);
+			error.maxNormalErrorDegrees = std::max(error.maxNormalErrorDegrees, normalErr);
+			error.maxUVError = std::max(error.maxUVError, uvErr);
+			posSum += posErr;
+			normalSum += normalErr;
+		}
+		if (count > 0) {
+			error.meanPositionError = (float)(posSum / count);
+			error.meanNormalErrorDegrees = (float)(normalSum / count);
+		}
+		return error;
+	}
+}
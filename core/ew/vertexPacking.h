@@ -0,0 +1,76 @@
+#pragma once
+#include <vector>
+#include <stdint.h>
+#include "mesh.h"
+
+namespace ew {
+	enum class PositionFormat {
+		FLOAT32 = 0, //12 bytes
+		HALF_FLOAT = 1, //6 bytes (+2 padding)
+		UNORM16_BOUNDS = 2 //6 bytes (+2 padding), normalized to the mesh bounds. Needs PackedMeshData::positionDecode
+	};
+	enum class NormalFormat {
+		FLOAT32 = 0, //12 bytes
+		SNORM_10_10_10_2 = 1, //4 bytes
+		OCTAHEDRAL_16 = 2 //4 bytes. Vertex shader must decode it, see below
+	};
+	enum class UVFormat {
+		FLOAT32 = 0, //8 bytes
+		UNORM16 = 1 //4 bytes, UVs must be in [0,1]
+	};
+
+	struct VertexLayout {
+		PositionFormat position = PositionFormat::FLOAT32;
+		NormalFormat normal = NormalFormat::FLOAT32;
+		UVFormat uv = UVFormat::FLOAT32;
+	};
+
+	//One vertex attribute as passed to glVertexAttribPointer
+	struct VertexAttribute {
+		unsigned int location = 0;
+		int components = 0;
+		unsigned int glType = 0;
+		bool normalized = false;
+		unsigned int offset = 0;
+	};
+
+	/// <summary>
+	/// Vertex data converted to a compact layout. Load it with Mesh::load(const PackedMeshData&).
+	/// Locations match ew::Vertex (0 = position, 1 = normal, 2 = uv), so shaders keep working, except:
+	///  - UNORM16_BOUNDS positions are in [0,1] mesh space. Multiply the model matrix by positionDecode.
+	///    The decode scale is uniform so the normal matrix is unaffected.
+	///  - OCTAHEDRAL_16 normals arrive as vec2 and must be decoded:
+	///    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	///    if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	///    n = normalize(n);
+	/// </summary>
+	struct PackedMeshData {
+		VertexLayout layout;
+		unsigned int stride = 0; //Bytes per vertex
+		unsigned int numVertices = 0;
+		std::vector<uint8_t> vertices;
+		std::vector<unsigned int> indices;
+		VertexAttribute attributes[3];
+		ew::Mat4 positionDecode = ew::IdentityMatrix();
+		ew::AABB bounds; //Of the unpacked positions
+		ew::BoundingSphere boundingSphere;
+	};
+
+	PackedMeshData packMeshData(const MeshData& meshData, const VertexLayout& layout);
+	//Decodes back to full floats
+	MeshData unpackMeshData(const PackedMeshData& packed);
+
+	struct PackingError {
+		unsigned int bytesPerVertex = 0;
+		float maxPositionError = 0; //Object space units
+		float meanPositionError = 0;
+		float maxNormalErrorDegrees = 0;
+		float meanNormalErrorDegrees = 0;
+		float maxUVError = 0;
+	};
+	//Compares a packed mesh against the source it was packed from
+	PackingError measurePackingError(const MeshData& source, const PackedMeshData& packed);
+
+	//Bytes per vertex of a layout without packing anything
+	unsigned int vertexStride(const VertexLayout& layout);
+}
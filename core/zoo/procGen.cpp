@@ -1,5 +1,6 @@
 #pragma once
 #include "../zoo/procGen.h"
+#include "../ew/meshBounds.h"
 
 namespace zoo {
     struct Vertex {
@@ -50,6 +51,7 @@ namespace zoo {
             }
         }
 
+        ew::computeBounds(&meshData);
         return meshData;
 
     }
@@ -94,6 +96,7 @@ namespace zoo {
             }
         }
 
+        ew::computeBounds(&meshData);
         return meshData;
     }
 
@@ -173,6 +176,7 @@ namespace zoo {
             meshData.indices.push_back(bottomRingStart + i + 1);
         }
 
+        ew::computeBounds(&meshData);
         return meshData;
     }
 
@@ -1,5 +1,6 @@
 #include "shader.h"
 #include "../ew/external/glad.h"
+#include "../ew/shader.h"
 
 namespace zoo 
 {
@@ -57,44 +58,48 @@ namespace zoo
 	};
 
 	//Shader class
-	Shader::Shader(const std::string& vertexShader, const std::string& fragmentShader)
+	Shader::Shader(const std::string& vertexShader, const std::string& fragmentShader, ew::ProgramCache* cache)
 	{
 		std::string vertexShaderSource = loadShaderSourceFromFile(vertexShader.c_str());
 		std::string fragmentShaderSource = loadShaderSourceFromFile(fragmentShader.c_str());
-		m_id = createShaderProgram(vertexShaderSource.c_str(), fragmentShaderSource.c_str());
+		if (cache)
+			m_id = ew::createShaderProgram(vertexShaderSource.c_str(), fragmentShaderSource.c_str(), cache);
+		else
+			m_id = createShaderProgram(vertexShaderSource.c_str(), fragmentShaderSource.c_str());
+		m_uniforms.build(m_id);
 	}
 	void Shader::use()
 	{
 		glUseProgram(m_id);
 	}
 
-	void Shader::setInt(const std::string& name, int v) const
+	void Shader::setInt(ew::UniformHandle uniform, int v) const
 	{
-		glUniform1i(glGetUniformLocation(m_id, name.c_str()), v);
+		glUniform1i(uniform.location, v);
 	}
 
-	void Shader::setFloat(const std::string& name, float v) const
+	void Shader::setFloat(ew::UniformHandle uniform, float v) const
 	{
-		glUniform1f(glGetUniformLocation(m_id, name.c_str()), v);
+		glUniform1f(uniform.location, v);
 	}
 
-	void Shader::setVec2(const std::string& name, float x, float y) const
+	void Shader::setVec2(ew::UniformHandle uniform, float x, float y) const
 	{
-		glUniform2f(glGetUniformLocation(m_id, name.c_str()), x, y);
+		glUniform2f(uniform.location, x, y);
 	}
 
-	void Shader::setVec3(const std::string& name, float x, float y, float z) const
+	void Shader::setVec3(ew::UniformHandle uniform, float x, float y, float z) const
 	{
-		glUniform3f(glGetUniformLocation(m_id, name.c_str()), x, y, z);
+		glUniform3f(uniform.location, x, y, z);
 	}
 
-	void Shader::setVec4(const std::string& name, float x, float y, float z, float w) const
+	void Shader::setVec4(ew::UniformHandle uniform, float x, float y, float z, float w) const
 	{
-		glUniform4f(glGetUniformLocation(m_id, name.c_str()), x, y, z, w);
+		glUniform4f(uniform.location, x, y, z, w);
 	}
 
-	void Shader::setMat4(const std::string& name, const ew::Mat4& v) const
+	void Shader::setMat4(ew::UniformHandle uniform, const ew::Mat4& v) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(m_id, name.c_str()), 1, GL_FALSE, &v[0][0]);
+		glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &v[0][0]);
 	}
 }
@@ -1,7 +1,10 @@
 #pragma once
 #include <sstream>
 #include <fstream>
+#include <string_view>
 #include "../ew/ewMath/mat4.h"
+#include "../ew/uniformTable.h"
+#include "../ew/programCache.h"
 
 namespace zoo 
 {
@@ -10,17 +13,27 @@ namespace zoo
 
 	class Shader {
 	public:
-		Shader(const std::string& vertexShader, const std::string& fragmentShader);
+		//With a cache, the program is created by ew::createShaderProgram and its binary reused on later launches
+		Shader(const std::string& vertexShader, const std::string& fragmentShader, ew::ProgramCache* cache = nullptr);
 		void use();
-		void setInt(const std::string& name, int v) const;
-		void setFloat(const std::string& name, float v) const;
-		void setVec2(const std::string& name, float x, float y) const;
-		void setVec3(const std::string& name, float x, float y, float z) const;
-		void setVec4(const std::string& name, float x, float y, float z, float w) const;
-		void setMat4(const std::string& name, const ew::Mat4& v) const;
+		//Locations come from the table filled at link time, see ew::UniformTable
+		inline ew::UniformHandle getUniform(std::string_view name) const { return ew::UniformHandle{ m_uniforms.find(name) }; }
+		void setInt(ew::UniformHandle uniform, int v) const;
+		void setFloat(ew::UniformHandle uniform, float v) const;
+		void setVec2(ew::UniformHandle uniform, float x, float y) const;
+		void setVec3(ew::UniformHandle uniform, float x, float y, float z) const;
+		void setVec4(ew::UniformHandle uniform, float x, float y, float z, float w) const;
+		void setMat4(ew::UniformHandle uniform, const ew::Mat4& v) const;
+		inline void setInt(std::string_view name, int v) const { setInt(getUniform(name), v); }
+		inline void setFloat(std::string_view name, float v) const { setFloat(getUniform(name), v); }
+		inline void setVec2(std::string_view name, float x, float y) const { setVec2(getUniform(name), x, y); }
+		inline void setVec3(std::string_view name, float x, float y, float z) const { setVec3(getUniform(name), x, y, z); }
+		inline void setVec4(std::string_view name, float x, float y, float z, float w) const { setVec4(getUniform(name), x, y, z, w); }
+		inline void setMat4(std::string_view name, const ew::Mat4& v) const { setMat4(getUniform(name), v); }
 
 	private:
 		unsigned int m_id;
+		ew::UniformTable m_uniforms;
 	};
 
 }
\ No newline at end of file
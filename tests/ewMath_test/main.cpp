@@ -0,0 +1,276 @@
+//ewMath checks. Every result is compared against a double precision reference computed here,
+//so the SIMD build (ewMath_test) and the EW_MATH_SCALAR build (ewMath_test_scalar) must agree within the same tolerance
+
+#include <stdio.h>
+#include <math.h>
+#include <stdint.h>
+#include <ew/ewMath/ewMath.h>
+#include <ew/ewMath/transformations.h>
+#include <ew/transform.h>
+#include <ew/cachedTransform.h>
+#include <ew/transformArray.h>
+
+static int numFailed = 0;
+static int numChecked = 0;
+
+static void check(bool passed, const char* name, int index, float error)
+{
+	numChecked++;
+	if (passed)
+		return;
+	numFailed++;
+	printf("FAILED %s [%d], error %g\n", name, index, error);
+}
+
+//Deterministic, so failures reproduce
+static uint32_t rngState = 12345;
+static float randomFloat(float min, float max)
+{
+	rngState = rngState * 1664525u + 1013904223u;
+	return min + (max - min) * ((rngState >> 8) * (1.0f / 16777216.0f));
+}
+
+static ew::Mat4 randomMatrix()
+{
+	ew::Mat4 m;
+	for (int c = 0; c < 4; c++) {
+		for (int r = 0; r < 4; r++) {
+			m[c][r] = randomFloat(-2.0f, 2.0f);
+		}
+	}
+	return m;
+}
+
+//Rotation, non uniform scale and translation, always invertible
+static ew::Mat4 randomTransform()
+{
+	return ew::Translate(ew::Vec3(randomFloat(-10, 10), randomFloat(-10, 10), randomFloat(-10, 10)))
+		* ew::RotateY(randomFloat(-3.14f, 3.14f))
+		* ew::RotateX(randomFloat(-3.14f, 3.14f))
+		* ew::RotateZ(randomFloat(-3.14f, 3.14f))
+		* ew::Scale(ew::Vec3(randomFloat(0.2f, 4.0f), randomFloat(0.2f, 4.0f), randomFloat(0.2f, 4.0f)));
+}
+
+//Largest absolute difference, relative to the reference's largest element
+static float relativeError(const ew::Mat4& m, const double reference[4][4])
+{
+	double maxError = 0.0, maxValue = 1e-30;
+	for (int c = 0; c < 4; c++) {
+		for (int r = 0; r < 4; r++) {
+			maxError = fmax(maxError, fabs(m[c][r] - reference[c][r]));
+			maxValue = fmax(maxValue, fabs(reference[c][r]));
+		}
+	}
+	return (float)(maxError / maxValue);
+}
+
+static void testMultiply()
+{
+	for (int i = 0; i < 1000; i++) {
+		ew::Mat4 a = randomMatrix(), b = randomMatrix();
+		ew::Mat4 m = a * b;
+		double reference[4][4];
+		for (int c = 0; c < 4; c++) {
+			for (int r = 0; r < 4; r++) {
+				reference[c][r] = 0.0;
+				for (int k = 0; k < 4; k++) {
+					reference[c][r] += (double)a[k][r] * b[c][k];
+				}
+			}
+		}
+		float error = relativeError(m, reference);
+		check(error < 1e-6f, "Mat4 * Mat4", i, error);
+
+		ew::Vec4 v(randomFloat(-2, 2), randomFloat(-2, 2), randomFloat(-2, 2), randomFloat(-2, 2));
+		ew::Vec4 mv = a * v;
+		const float* mvp = &mv.x;
+		const float* vp = &v.x;
+		float vectorError = 0.0f;
+		for (int r = 0; r < 4; r++) {
+			double expected = 0.0;
+			for (int k = 0; k < 4; k++) {
+				expected += (double)a[k][r] * vp[k];
+			}
+			vectorError = fmaxf(vectorError, (float)fabs(mvp[r] - expected));
+		}
+		check(vectorError < 1e-5f, "Mat4 * Vec4", i, vectorError);
+	}
+}
+
+//Exact, it only moves elements
+static void testTranspose()
+{
+	for (int i = 0; i < 100; i++) {
+		ew::Mat4 m = randomMatrix();
+		ew::Mat4 t = ew::Transpose(m);
+		bool exact = true;
+		for (int c = 0; c < 4; c++) {
+			for (int r = 0; r < 4; r++) {
+				exact = exact && t[c][r] == m[r][c];
+			}
+		}
+		check(exact, "Transpose(Mat4)", i, 0.0f);
+	}
+}
+
+static void testInverse()
+{
+	for (int i = 0; i < 1000; i++) {
+		ew::Mat4 m = randomTransform();
+		ew::Mat4 product = m * ew::Inverse(m);
+		double identity[4][4] = {};
+		for (int d = 0; d < 4; d++) {
+			identity[d][d] = 1.0;
+		}
+		float error = relativeError(product, identity);
+		check(error < 1e-4f, "M * Inverse(M)", i, error);
+	}
+}
+
+//Inverse transpose of the upper 3x3 in double precision, from its cofactors
+static void referenceNormalMatrix(const ew::Mat4& m, double out[3][3])
+{
+	double a[3][3];
+	for (int c = 0; c < 3; c++) {
+		for (int r = 0; r < 3; r++) {
+			a[c][r] = m[c][r];
+		}
+	}
+	double det = 0.0;
+	for (int c = 0; c < 3; c++) {
+		for (int r = 0; r < 3; r++) {
+			//Cofactor of element (c, r), a[c][r] is column c, row r
+			int c0 = (c + 1) % 3, c1 = (c + 2) % 3, r0 = (r + 1) % 3, r1 = (r + 2) % 3;
+			out[c][r] = a[c0][r0] * a[c1][r1] - a[c1][r0] * a[c0][r1];
+		}
+		det += a[c][0] * out[c][0];
+	}
+	for (int c = 0; c < 3; c++) {
+		for (int r = 0; r < 3; r++) {
+			out[c][r] /= det;
+		}
+	}
+}
+
+static float relativeError(const ew::Mat3& m, const double reference[3][3])
+{
+	double maxError = 0.0, maxValue = 1e-30;
+	for (int c = 0; c < 3; c++) {
+		const float* column = &m[c].x;
+		for (int r = 0; r < 3; r++) {
+			maxError = fmax(maxError, fabs(column[r] - reference[c][r]));
+			maxValue = fmax(maxValue, fabs(reference[c][r]));
+		}
+	}
+	return (float)(maxError / maxValue);
+}
+
+static void testMat3()
+{
+	for (int i = 0; i < 1000; i++) {
+		ew::Mat4 model = randomTransform();
+		double reference[3][3];
+		referenceNormalMatrix(model, reference);
+		float error = relativeError(ew::NormalMatrix(model), reference);
+		check(error < 1e-5f, "NormalMatrix", i, error);
+
+		ew::Mat3 m = ew::Mat3(model);
+		ew::Mat3 product = m * ew::Inverse(m);
+		double identity[3][3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+		error = relativeError(product, identity);
+		check(error < 1e-5f, "Mat3 * Inverse(Mat3)", i, error);
+
+		ew::Mat3 t = ew::Transpose(m);
+		bool exact = true;
+		for (int c = 0; c < 3; c++) {
+			for (int r = 0; r < 3; r++) {
+				exact = exact && (&t[c].x)[r] == (&m[r].x)[c];
+			}
+		}
+		check(exact, "Transpose(Mat3)", i, 0.0f);
+	}
+}
+
+//CachedTransform composes its matrices from a quaternion, ew::Transform from Euler matrices. Both must agree
+static void testCachedTransform()
+{
+	for (int i = 0; i < 1000; i++) {
+		ew::Transform transform;
+		transform.position = ew::Vec3(randomFloat(-10, 10), randomFloat(-10, 10), randomFloat(-10, 10));
+		transform.rotation = ew::Vec3(randomFloat(-180, 180), randomFloat(-180, 180), randomFloat(-180, 180));
+		transform.scale = ew::Vec3(randomFloat(0.2f, 4.0f), randomFloat(0.2f, 4.0f), randomFloat(0.2f, 4.0f));
+		ew::CachedTransform cached(transform.position);
+		cached.setRotationEuler(transform.rotation);
+		cached.setScale(transform.scale);
+
+		ew::Mat4 model = transform.getModelMatrix();
+		double reference[4][4];
+		for (int c = 0; c < 4; c++) {
+			for (int r = 0; r < 4; r++) {
+				reference[c][r] = model[c][r];
+			}
+		}
+		float error = relativeError(*cached.getModelMatrix(), reference);
+		check(error < 1e-5f, "CachedTransform model matrix", i, error);
+
+		double normalReference[3][3];
+		referenceNormalMatrix(model, normalReference);
+		error = relativeError(*cached.getNormalMatrix(), normalReference);
+		check(error < 1e-4f, "CachedTransform normal matrix", i, error);
+	}
+}
+
+//TransformArray composes its matrices four at a time. Counts that leave a remainder exercise the scalar tail,
+//and counts past the per thread minimum exercise the chunk split between threads
+static void testTransformArray()
+{
+	const size_t counts[] = { 1, 3, 5, 7, 1001, 4096 * 3 + 5 };
+	const unsigned int threadCounts[] = { 1, 4 };
+	for (size_t count : counts) {
+		ew::TransformArray transforms(count);
+		std::vector<ew::Mat4> expected(count);
+		for (size_t i = 0; i < count; i++) {
+			ew::Transform transform;
+			transform.position = ew::Vec3(randomFloat(-10, 10), randomFloat(-10, 10), randomFloat(-10, 10));
+			transform.rotation = ew::Vec3(randomFloat(-180, 180), randomFloat(-180, 180), randomFloat(-180, 180));
+			transform.scale = ew::Vec3(randomFloat(0.2f, 4.0f), randomFloat(0.2f, 4.0f), randomFloat(0.2f, 4.0f));
+			transforms.set(i, transform);
+			expected[i] = transform.getModelMatrix();
+		}
+		for (unsigned int numThreads : threadCounts) {
+			transforms.computeModelMatrices(numThreads);
+			float maxError = 0.0f;
+			for (size_t i = 0; i < count; i++) {
+				double reference[4][4];
+				for (int c = 0; c < 4; c++) {
+					for (int r = 0; r < 4; r++) {
+						reference[c][r] = expected[i][c][r];
+					}
+				}
+				maxError = fmaxf(maxError, relativeError(transforms.modelMatrix(i), reference));
+			}
+			char name[64];
+			snprintf(name, sizeof(name), "TransformArray %u thread(s)", numThreads);
+			check(maxError < 1e-5f, name, (int)count, maxError);
+		}
+	}
+}
+
+int main()
+{
+#if defined(EW_MATH_AVX)
+	printf("ewMath backend: AVX\n");
+#elif defined(EW_MATH_SSE)
+	printf("ewMath backend: SSE\n");
+#else
+	printf("ewMath backend: scalar\n");
+#endif
+	testMultiply();
+	testTranspose();
+	testInverse();
+	testMat3();
+	testCachedTransform();
+	testTransformArray();
+	printf("%d of %d checks passed\n", numChecked - numFailed, numChecked);
+	return numFailed == 0 ? 0 : 1;
+}
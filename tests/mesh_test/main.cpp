@@ -0,0 +1,89 @@
+//Mesh processing checks. splitMeshData's parts are narrowed to 16 bit indices the same way Mesh and MeshPool
+//upload them, then every triangle is rebuilt from its part and compared with the source triangle
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <ew/mesh.h>
+#include <ew/procGen.h>
+
+static int numFailed = 0;
+static int numChecked = 0;
+
+static void check(bool passed, const char* name, const char* detail)
+{
+	numChecked++;
+	if (passed)
+		return;
+	numFailed++;
+	printf("FAILED %s: %s\n", name, detail);
+}
+
+static bool sameVertex(const ew::Vertex& a, const ew::Vertex& b)
+{
+	return memcmp(&a, &b, sizeof(ew::Vertex)) == 0;
+}
+
+/// <summary>
+/// Parts must fit in 16 bit indices, and together hold the source's triangles in their original order
+/// </summary>
+static void testSplit(const char* name, const ew::MeshData& meshData, unsigned int maxVertices, size_t minParts)
+{
+	std::vector<ew::MeshData> parts = ew::splitMeshData(meshData, maxVertices);
+	char detail[256];
+	snprintf(detail, sizeof(detail), "%zu vertices split into %zu parts, expected at least %zu", meshData.vertices.size(), parts.size(), minParts);
+	check(parts.size() >= minParts, name, detail);
+
+	size_t sourceIndex = 0;
+	bool trianglesMatch = true;
+	for (size_t p = 0; p < parts.size() && trianglesMatch; p++) {
+		const ew::MeshData& part = parts[p];
+		snprintf(detail, sizeof(detail), "part %zu has %zu vertices, more than %u", p, part.vertices.size(), maxVertices);
+		check(part.vertices.size() <= maxVertices && part.vertices.size() <= ew::MAX_SHORT_INDEX_VERTICES, name, detail);
+
+		std::vector<unsigned short> shortIndices(part.indices.begin(), part.indices.end());
+		for (size_t i = 0; i < shortIndices.size(); i++, sourceIndex++) {
+			if (sourceIndex >= meshData.indices.size() || shortIndices[i] >= part.vertices.size()
+				|| !sameVertex(part.vertices[shortIndices[i]], meshData.vertices[meshData.indices[sourceIndex]])) {
+				snprintf(detail, sizeof(detail), "part %zu index %zu does not match source index %zu", p, i, sourceIndex);
+				check(false, name, detail);
+				trianglesMatch = false;
+				break;
+			}
+		}
+	}
+	if (trianglesMatch) {
+		snprintf(detail, sizeof(detail), "parts hold %zu indices, source has %zu", sourceIndex, meshData.indices.size());
+		check(sourceIndex == meshData.indices.size(), name, detail);
+	}
+}
+
+int main()
+{
+	ew::MeshData sphere = ew::createSphere(0.5f, 64);
+	testSplit("sphere 64, fits", sphere, ew::MAX_SHORT_INDEX_VERTICES, 1);
+	testSplit("sphere 64, small parts", sphere, 500, 8);
+
+	ew::MeshData largeSphere = ew::createSphere(0.5f, 400);
+	if (largeSphere.vertices.size() <= ew::MAX_SHORT_INDEX_VERTICES) {
+		printf("FAILED: sphere 400 has only %zu vertices, too few to need splitting\n", largeSphere.vertices.size());
+		return 1;
+	}
+	testSplit("sphere 400", largeSphere, ew::MAX_SHORT_INDEX_VERTICES, 2);
+
+	//Triangles that share no vertices, so parts fill up to the limit exactly
+	ew::MeshData soup;
+	for (unsigned int i = 0; i < 3 * 70000; i++) {
+		ew::Vertex vertex;
+		vertex.pos = ew::Vec3((float)i, (float)(i % 7), (float)(i % 13));
+		vertex.normal = ew::Vec3(0.0f, 1.0f, 0.0f);
+		vertex.uv = ew::Vec2((float)(i % 3), 0.0f);
+		soup.vertices.push_back(vertex);
+		soup.indices.push_back(i);
+	}
+	testSplit("triangle soup", soup, 3 * 1000, 70);
+	testSplit("triangle soup, 16 bit limit", soup, ew::MAX_SHORT_INDEX_VERTICES, 4);
+
+	printf("%d of %d checks passed\n", numChecked - numFailed, numChecked);
+	return numFailed == 0 ? 0 : 1;
+}